@@ -7,12 +7,18 @@ struct CPUStateElement
     char *m_data;
 };
 
+// A range of contiguous bytes to be synced
 struct MemoryElement
 {
-    uint8_t m_value;
     uint64_t m_static_addr;
+    uint32_t m_size;
+    const uint8_t *m_data;
 };
 
+// Granularity of the address translation done by crete_get_dynamic_addr()
+#define CRETE_SYNC_PAGE_BITS (12)
+#define CRETE_SYNC_PAGE_SIZE (1ULL << CRETE_SYNC_PAGE_BITS)
+
 extern uint64_t crete_get_dynamic_addr(uint64_t);
 
 __attribute__((noinline)) static void internal_sync_cpu_state(uint8_t *cpu_state, uint32_t cs_size,
@@ -32,6 +38,9 @@ __attribute__((noinline)) static void internal_sync_cpu_state(uint8_t *cpu_state
     }
 }
 
+// Addresses are translated once for each part of a range within a page.
+// Bytes are only written if their values are changed, so that unchanged
+// bytes keep their symbolic values.
 __attribute__((noinline)) static void internal_crete_sync_memory(const struct MemoryElement *sync_table, uint32_t st_size)
 {
     const struct MemoryElement *current_element;
@@ -39,14 +48,26 @@ __attribute__((noinline)) static void internal_crete_sync_memory(const struct Me
     {
         current_element = sync_table + i;
         uint64_t static_addr = current_element->m_static_addr;
-        uint8_t value = current_element->m_value;
-
-        uint64_t dynamic_addr = crete_get_dynamic_addr(static_addr);
-        uint8_t *ptr_current_value = (uint8_t *)dynamic_addr;
+        uint32_t size = current_element->m_size;
+        const uint8_t *data = current_element->m_data;
 
-        if(*ptr_current_value != value)
+        uint32_t j = 0;
+        while(j < size)
         {
-            *ptr_current_value = value;
+            uint64_t page_left = CRETE_SYNC_PAGE_SIZE -
+                    ((static_addr + j) & (CRETE_SYNC_PAGE_SIZE - 1));
+            uint32_t chunk_size = (size - j < page_left) ? size - j : (uint32_t)page_left;
+
+            uint8_t *ptr_current_value = (uint8_t *)crete_get_dynamic_addr(static_addr + j);
+            for(uint32_t k = 0; k < chunk_size; ++k)
+            {
+                if(ptr_current_value[k] != data[j + k])
+                {
+                    ptr_current_value[k] = data[j + k];
+                }
+            }
+
+            j += chunk_size;
         }
     }
 }
@@ -1,6 +1,5 @@
 #include <stdint.h>
 #include <stdlib.h>
-#include <map>
 
 //#define USE_UTHASH
 
@@ -15,20 +14,105 @@ uint64_t crete_get_dynamic_addr(uint64_t);
 #define PAGE_OFFSET_MASK    (~PAGE_ADDRESS_MASK)
 
 #ifndef USE_UTHASH
-uint64_t crete_get_dynamic_addr(uint64_t static_addr)
+// Open-addressed (linear probing) table of <static_page_addr, dynamic_page_addr>.
+// Page 0 is kept aside, as static_page_addr 0 denotes an empty slot.
+struct page_addr_entry_t
+{
+    uint64_t static_page_addr;
+    uint64_t dynamic_page_addr;
+};
+
+static page_addr_entry_t *page_addr_table = NULL;
+static uint64_t page_addr_table_size = 0; // power of 2
+static uint64_t page_addr_table_count = 0;
+static uint64_t zero_page_dynamic_addr = 0;
+
+// The last page being translated, as consecutive accesses mostly hit the same page
+static uint64_t last_static_page_addr = 1; // Not page aligned, never matches
+static uint64_t last_dynamic_page_addr = 0;
+
+static inline uint64_t page_addr_hash(uint64_t static_page_addr)
+{
+    uint64_t h = (static_page_addr >> PAGE_ALIGN_BITS) * 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 32);
+}
+
+static void page_addr_table_insert(page_addr_entry_t *table, uint64_t size,
+        uint64_t static_page_addr, uint64_t dynamic_page_addr)
+{
+    uint64_t i = page_addr_hash(static_page_addr) & (size - 1);
+    while(table[i].static_page_addr != 0)
+        i = (i + 1) & (size - 1);
+
+    table[i].static_page_addr = static_page_addr;
+    table[i].dynamic_page_addr = dynamic_page_addr;
+}
+
+static void page_addr_table_grow()
+{
+    uint64_t new_size = page_addr_table_size ? page_addr_table_size * 2 : 1024;
+    page_addr_entry_t *new_table =
+            (page_addr_entry_t *)calloc(new_size, sizeof(page_addr_entry_t));
+
+    for(uint64_t i = 0; i < page_addr_table_size; ++i)
+    {
+        if(page_addr_table[i].static_page_addr != 0)
+            page_addr_table_insert(new_table, new_size,
+                    page_addr_table[i].static_page_addr,
+                    page_addr_table[i].dynamic_page_addr);
+    }
+
+    free(page_addr_table);
+    page_addr_table = new_table;
+    page_addr_table_size = new_size;
+}
+
+static uint64_t find_dynamic_page_addr(uint64_t static_page_addr)
 {
-    // <static_page_addr, dynamic_page_addr>
-    static std::map<uint64_t, uint64_t> page_addr_map;
+    if(static_page_addr == 0)
+    {
+        if(!zero_page_dynamic_addr)
+            zero_page_dynamic_addr = (uint64_t)malloc(PAGE_SIZE);
+
+        return zero_page_dynamic_addr;
+    }
 
+    if(page_addr_table_size)
+    {
+        uint64_t i = page_addr_hash(static_page_addr) & (page_addr_table_size - 1);
+        while(page_addr_table[i].static_page_addr != 0)
+        {
+            if(page_addr_table[i].static_page_addr == static_page_addr)
+                return page_addr_table[i].dynamic_page_addr;
+
+            i = (i + 1) & (page_addr_table_size - 1);
+        }
+    }
+
+    // Keep the load factor below 1/2
+    if((page_addr_table_count + 1) * 2 > page_addr_table_size)
+        page_addr_table_grow();
+
+    uint64_t dynamic_page_addr = (uint64_t)malloc(PAGE_SIZE);
+    page_addr_table_insert(page_addr_table, page_addr_table_size,
+            static_page_addr, dynamic_page_addr);
+    ++page_addr_table_count;
+
+    return dynamic_page_addr;
+}
+
+uint64_t crete_get_dynamic_addr(uint64_t static_addr)
+{
     uint64_t static_page_addr = static_addr & PAGE_ADDRESS_MASK;
     uint64_t in_page_offest = static_addr & PAGE_OFFSET_MASK;
 
-    if(page_addr_map.find(static_page_addr) == page_addr_map.end())
+    if(static_page_addr != last_static_page_addr)
     {
-        page_addr_map[static_page_addr] = (uint64_t)malloc(PAGE_SIZE);
+        last_dynamic_page_addr = find_dynamic_page_addr(static_page_addr);
+        last_static_page_addr = static_page_addr;
     }
 
-    return page_addr_map[static_page_addr] + in_page_offest;
+    return last_dynamic_page_addr + in_page_offest;
 }
 
 #else // #ifndef USE_UTHASH
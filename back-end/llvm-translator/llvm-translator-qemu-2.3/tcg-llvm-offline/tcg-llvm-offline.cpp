@@ -143,6 +143,20 @@ uint64_t TCGLLVMOfflineContext::get_size()
     return (uint64_t)m_tlo_tb_pc.size();
 }
 
+void TCGLLVMOfflineContext::swap(TCGLLVMOfflineContext& other)
+{
+    m_tlo_tb_pc.swap(other.m_tlo_tb_pc);
+
+    m_tcg_ctx.swap(other.m_tcg_ctx);
+    m_tcg_temps.swap(other.m_tcg_temps);
+    m_helper_names.swap(other.m_helper_names);
+
+    m_tlo_tb_inst_count.swap(other.m_tlo_tb_inst_count);
+
+    m_tbExecSequ.swap(other.m_tbExecSequ);
+    std::swap(m_cpuState_size, other.m_cpuState_size);
+}
+
 #if defined(TCG_LLVM_OFFLINE)
 
 extern "C" {
@@ -152,9 +166,12 @@ extern "C" {
 
 #include <boost/exception/all.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <sstream>
 
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #define CRETE_DEBUG
 
@@ -171,6 +188,8 @@ uint16_t gen_opc_icount[OPC_BUF_SIZE];
 uint8_t gen_opc_instr_start[OPC_BUF_SIZE];
 
 std::string crete_data_dir;
+// Translation cache shared by the traces of a target (optional, the first argument)
+std::string crete_translation_cache_dir;
 
 enum CreteFileType {
     CRETE_FILE_TYPE_LLVM_LIB,
@@ -224,6 +243,70 @@ static std::string crete_find_file(CreteFileType type, const char *name)
     return fpath.string();
 }
 
+// Identifies the set of helper libraries being linked, so that translations
+// cached with a different set of helpers are never reused
+static std::string crete_get_helper_set_version(const vector<string>& helper_libs)
+{
+    size_t seed = 0;
+    for(vector<string>::const_iterator it = helper_libs.begin();
+            it != helper_libs.end(); ++it) {
+        ifstream ifs(it->c_str(), ios_base::binary);
+        if(!ifs)
+        {
+            throw std::runtime_error("failed to open file: " + *it);
+        }
+
+        string content((std::istreambuf_iterator<char>(ifs)),
+                std::istreambuf_iterator<char>());
+        boost::hash_combine(seed, content);
+    }
+
+    stringstream ss;
+    ss << "helpers-" << hex << seed;
+
+    return ss.str();
+}
+
+static void crete_link_helpers(const vector<string>& helper_libs)
+{
+    namespace fs = boost::filesystem;
+
+    if(crete_translation_cache_dir.empty())
+    {
+        for(vector<string>::const_iterator it = helper_libs.begin();
+                it != helper_libs.end(); ++it)
+            tcg_linkWithLibrary(tcg_llvm_ctx, it->c_str());
+
+        return;
+    }
+
+    fs::path cache_dir = fs::path(crete_translation_cache_dir) /
+            crete_get_helper_set_version(helper_libs);
+    fs::create_directories(cache_dir);
+
+    // The helper libraries are linked once and loaded as a whole by later traces
+    fs::path linked_helpers = cache_dir / "crete-helpers.bc";
+    if(fs::exists(linked_helpers))
+    {
+        tcg_linkWithLibrary(tcg_llvm_ctx, linked_helpers.string().c_str());
+    }
+    else
+    {
+        for(vector<string>::const_iterator it = helper_libs.begin();
+                it != helper_libs.end(); ++it)
+            tcg_linkWithLibrary(tcg_llvm_ctx, it->c_str());
+
+        stringstream tmp;
+        tmp << linked_helpers.string() << "." << getpid() << ".tmp";
+        tcg_llvm_ctx->writeBitCodeToFile(tmp.str());
+        fs::rename(tmp.str(), linked_helpers);
+    }
+
+    tcg_llvm_ctx->crete_set_translation_cache((cache_dir / "tb").string());
+
+    cerr << "translation cache: " << cache_dir.string() << endl;
+}
+
 static void dump_tcg_op_defs()
 {
     char file_name[] = "translator-op-def.txt";
@@ -251,6 +334,172 @@ const char * get_helper_name(uint64_t func_addr)
     return ret;
 }
 
+static string crete_window_file(const char *prefix, uint64_t index, const char *ext)
+{
+    stringstream ss;
+    ss << prefix << "." << index << ext;
+
+    return ss.str();
+}
+
+static void crete_read_window(uint64_t index, TCGLLVMOfflineContext& tcg_llvm_offline_ctx)
+{
+    string file_name = crete_window_file("dump_tcg_llvm_offline", index, ".bin");
+
+    ifstream ifs(file_name.c_str());
+    boost::archive::binary_iarchive ia(ifs);
+    ia >> tcg_llvm_offline_ctx;
+    tcg_llvm_offline_ctx.dump_verify();
+
+#if defined(CRETE_DEBUG)
+    tcg_llvm_offline_ctx.print_info();
+#endif
+}
+
+// Generates llvm functions for the TBs of a window, with their qemu-ir
+// appended to tbir_file
+static void crete_translate_window(const TCGLLVMOfflineContext& temp_tcg_llvm_offline_ctx,
+        const string& tbir_file)
+{
+    TranslationBlock temp_tb = {};
+    TCGContext *s = &tcg_ctx;
+
+    for(uint64_t i = 0; i < temp_tcg_llvm_offline_ctx.get_size(); ++i) {
+        //3.1 update temp_tb
+        temp_tb.pc = (target_long)temp_tcg_llvm_offline_ctx.get_tlo_tb_pc(i);
+
+        //3.2 update tcg_ctx
+        const TCGContext temp_tcg_ctx = temp_tcg_llvm_offline_ctx.get_tcg_ctx(i);
+        memcpy((void *)s, (void *)&temp_tcg_ctx, sizeof(TCGContext));
+
+        //3.3 update gen_opc_buf and gen_opparam_buf
+
+        for(uint64_t j = 0; j < OPC_BUF_SIZE; ++j) {
+            gen_opc_buf[j] = (uint16_t)temp_tcg_ctx.gen_op_buf[j].opc;
+        }
+
+        for(uint64_t j = 0; j < OPPARAM_BUF_SIZE; ++j) {
+            gen_opparam_buf[j] = (TCGArg)temp_tcg_ctx.gen_opparam_buf[j];
+        }
+
+        // 3.4 update tcg-temp
+        const vector<TCGTemp> temp_tcg_temp = temp_tcg_llvm_offline_ctx.get_tcg_temp(i);
+        assert( temp_tcg_temp.size() == s->nb_temps);
+        for(uint64_t j = 0; j < s->nb_temps; ++j)
+            s->temps[j].assign(temp_tcg_temp[j]);
+
+        // generate offline-tbir.txt
+        uint64_t tb_inst_count = temp_tcg_llvm_offline_ctx.get_tlo_tb_inst_count(i);
+
+        static unsigned long long  tbir_count = 0;
+        FILE *f = fopen(tbir_file.c_str(), "a");
+        assert(f);
+
+        fprintf(f, "qemu-ir-tb-%llu-%llu: tb_inst_count = %llu\n",
+                tbir_count++, temp_tb.pc, tb_inst_count);
+        tcg_dump_ops_file(s, f);
+        fprintf(f, "\n");
+
+        fclose(f);
+
+        //3.5 generate llvm bitcode
+
+        cerr << "tcg_llvm_ctx->generateCode(s, &temp_tb) will be invoked." << endl;
+        temp_tb.tcg_llvm_context = NULL;
+        temp_tb.llvm_function = NULL;
+
+        tcg_llvm_ctx->generateCode(s, &temp_tb);
+
+        cerr<< "tcg_llvm_ctx->generateCode(s, &temp_tb) is done." << endl;
+
+        assert(temp_tb.tcg_llvm_context != NULL);
+        assert(temp_tb.llvm_function != NULL);
+    }
+}
+
+// Number of worker processes translating windows in parallel (optional, "-j <jobs>")
+static uint64_t crete_translator_jobs = 1;
+
+// Worker: translates windows worker_index, worker_index + jobs, ... in its own
+// copy of tcg_llvm_ctx, and writes each of them to dump_llvm_offline.<N>.window.bc
+static void crete_translation_worker(uint64_t worker_index, uint64_t jobs,
+        uint64_t window_count)
+{
+    for(uint64_t index = worker_index; index < window_count; index += jobs) {
+        TCGLLVMOfflineContext temp_tcg_llvm_offline_ctx;
+        crete_read_window(index, temp_tcg_llvm_offline_ctx);
+
+        uint64_t first_tb = tcg_llvm_ctx->getTbCount();
+        crete_translate_window(temp_tcg_llvm_offline_ctx,
+                crete_window_file("offline-tbir", index, ".txt"));
+
+        string window_file = crete_window_file("dump_llvm_offline", index, ".window.bc");
+        stringstream tmp;
+        tmp << window_file << "." << getpid() << ".tmp";
+        tcg_llvm_ctx->crete_write_tb_functions(tmp.str(), first_tb,
+                temp_tcg_llvm_offline_ctx.get_tbExecSequ());
+        boost::filesystem::rename(tmp.str(), window_file);
+    }
+}
+
+// Forks the workers and waits for all of them. Windows a worker failed to
+// translate are left to the sequential pass.
+static void crete_translate_windows_parallel(uint64_t jobs, uint64_t window_count)
+{
+    cerr << "translating " << dec << window_count << " windows with "
+            << jobs << " workers\n";
+
+    vector<pid_t> workers;
+    for(uint64_t w = 0; w < jobs; ++w) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            int ret = 0;
+            try {
+                crete_translation_worker(w, jobs, window_count);
+            }
+            catch(...)
+            {
+                cerr << "[CRETE Warning] translation worker " << w << " failed: \n"
+                        << boost::current_exception_diagnostic_information() << endl;
+                ret = 1;
+            }
+
+            cerr.flush();
+            _exit(ret);
+        }
+
+        if(pid < 0) {
+            cerr << "[CRETE Warning] fork() failed, translating sequentially\n";
+            break;
+        }
+
+        workers.push_back(pid);
+    }
+
+    for(vector<pid_t>::const_iterator it = workers.begin(); it != workers.end(); ++it) {
+        int status;
+        if(waitpid(*it, &status, 0) != *it ||
+                !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "[CRETE Warning] translation worker " << *it << " did not finish\n";
+        }
+    }
+}
+
+// Appends the qemu-ir of a window translated by a worker to offline-tbir.txt
+static void crete_merge_window_tbir(uint64_t index)
+{
+    string window_tbir = crete_window_file("offline-tbir", index, ".txt");
+
+    {
+        ifstream ifs(window_tbir.c_str(), ios_base::binary);
+        ofstream ofs("offline-tbir.txt", ios_base::binary | ios_base::app);
+        if(ifs && ifs.peek() != EOF)
+            ofs << ifs.rdbuf();
+    }
+
+    boost::filesystem::remove(window_tbir);
+}
+
 void x86_llvm_translator()
 {
     namespace fs = boost::filesystem;
@@ -271,122 +520,77 @@ void x86_llvm_translator()
     tcg_llvm_ctx = tcg_llvm_initialize();
     assert(tcg_llvm_ctx);
 
-    tcg_linkWithLibrary(tcg_llvm_ctx,
-            crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "bc_crete_ops.bc").c_str());
+    vector<string> helper_libs;
+    helper_libs.push_back(crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "bc_crete_ops.bc"));
 
 #if defined(TARGET_X86_64)
-    tcg_linkWithLibrary(tcg_llvm_ctx,
-            crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "crete-qemu-2.3-op-helper-x86_64.bc").c_str());
+    helper_libs.push_back(
+            crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "crete-qemu-2.3-op-helper-x86_64.bc"));
 #elif defined(TARGET_I386)
-    tcg_linkWithLibrary(tcg_llvm_ctx,
-            crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "crete-qemu-2.3-op-helper-i386.bc").c_str());
+    helper_libs.push_back(
+            crete_find_file(CRETE_FILE_TYPE_LLVM_LIB, "crete-qemu-2.3-op-helper-i386.bc"));
 #else
     #error CRETE: Only I386 and x64 supported!
 #endif // defined(TARGET_X86_64) || defined(TARGET_I386)
 
+    crete_link_helpers(helper_libs);
 
+    uint64_t window_count = 0;
+    while(fs::exists(crete_window_file("dump_tcg_llvm_offline", window_count, ".bin")))
+        ++window_count;
 
-    stringstream ss;
-    uint64_t streamed_count = 0;
-    for(;;) {
-        ss.str(string());
-        ss << "dump_tcg_llvm_offline." << streamed_count++ << ".bin";
-        if(!fs::exists(ss.str())){
-            cerr << ss.str() << " not found\n";
-            break;
-        }
-
-        cerr << ss.str() << " being found\n";
-
-        //2. initialize tcg_llvm_ctx_offline
-        TCGLLVMOfflineContext temp_tcg_llvm_offline_ctx;
-
-        ifstream ifs(ss.str().c_str());
-        boost::archive::binary_iarchive ia(ifs);
-        ia >> temp_tcg_llvm_offline_ctx;
-        temp_tcg_llvm_offline_ctx.dump_verify();
-
-#if defined(CRETE_DEBUG)
-        temp_tcg_llvm_offline_ctx.print_info();
-#endif
-
-        if(streamed_count == 1){
-            tcg_llvm_ctx->crete_init_helper_names(temp_tcg_llvm_offline_ctx.get_helper_names());
-            tcg_llvm_ctx->crete_set_cpuState_size(temp_tcg_llvm_offline_ctx.get_cpuState_size());
-        }
-
-        tcg_llvm_ctx->crete_add_tbExecSequ(temp_tcg_llvm_offline_ctx.get_tbExecSequ());
+    cerr << crete_window_file("dump_tcg_llvm_offline", window_count, ".bin")
+            << " not found\n";
 
-        //3. Translate
-        TranslationBlock temp_tb = {};
-        TCGContext *s = &tcg_ctx;
+    uint64_t jobs = min(crete_translator_jobs, window_count);
+    if(jobs > 1) {
+        // Workers need the helper names, which are captured with the first window
+        TCGLLVMOfflineContext first_tcg_llvm_offline_ctx;
+        crete_read_window(0, first_tcg_llvm_offline_ctx);
+        tcg_llvm_ctx->crete_init_helper_names(first_tcg_llvm_offline_ctx.get_helper_names());
+        tcg_llvm_ctx->crete_set_cpuState_size(first_tcg_llvm_offline_ctx.get_cpuState_size());
 
-        for(uint64_t i = 0; i < temp_tcg_llvm_offline_ctx.get_size(); ++i) {
-            //3.1 update temp_tb
-            temp_tb.pc = (target_long)temp_tcg_llvm_offline_ctx.get_tlo_tb_pc(i);
-
-            //3.2 update tcg_ctx
-            const TCGContext temp_tcg_ctx = temp_tcg_llvm_offline_ctx.get_tcg_ctx(i);
-            memcpy((void *)s, (void *)&temp_tcg_ctx, sizeof(TCGContext));
-
-            //3.3 update gen_opc_buf and gen_opparam_buf
-
-            for(uint64_t j = 0; j < OPC_BUF_SIZE; ++j) {
-                gen_opc_buf[j] = (uint16_t)temp_tcg_ctx.gen_op_buf[j].opc;
-            }
+        cerr.flush();
+        crete_translate_windows_parallel(jobs, window_count);
+    }
 
-            for(uint64_t j = 0; j < OPPARAM_BUF_SIZE; ++j) {
-                gen_opparam_buf[j] = (TCGArg)temp_tcg_ctx.gen_opparam_buf[j];
+    for(uint64_t index = 0; index < window_count; ++index) {
+        cerr << crete_window_file("dump_tcg_llvm_offline", index, ".bin")
+                << " being found\n";
+
+        string window_file = crete_window_file("dump_llvm_offline", index, ".window.bc");
+        if(jobs > 1 && fs::exists(window_file) &&
+                tcg_llvm_ctx->crete_link_tb_functions(window_file)) {
+            crete_merge_window_tbir(index);
+            fs::remove(window_file);
+        } else {
+            if(jobs > 1) {
+                fs::remove(window_file);
+                fs::remove(crete_window_file("offline-tbir", index, ".txt"));
             }
 
-            // 3.4 update tcg-temp
-            const vector<TCGTemp> temp_tcg_temp = temp_tcg_llvm_offline_ctx.get_tcg_temp(i);
-            assert( temp_tcg_temp.size() == s->nb_temps);
-            for(uint64_t j = 0; j < s->nb_temps; ++j)
-                s->temps[j].assign(temp_tcg_temp[j]);
-
-            // generate offline-tbir.txt
-            uint64_t tb_inst_count = temp_tcg_llvm_offline_ctx.get_tlo_tb_inst_count(i);
-
-            static unsigned long long  tbir_count = 0;
-            char file_name[] = "offline-tbir.txt";
-            FILE *f = fopen(file_name, "a");
-            assert(f);
-
-            fprintf(f, "qemu-ir-tb-%llu-%llu: tb_inst_count = %llu\n",
-                    tbir_count++, temp_tb.pc, tb_inst_count);
-            tcg_dump_ops_file(s, f);
-            fprintf(f, "\n");
+            //2. initialize tcg_llvm_ctx_offline
+            TCGLLVMOfflineContext temp_tcg_llvm_offline_ctx;
+            crete_read_window(index, temp_tcg_llvm_offline_ctx);
 
-            fclose(f);
-
-            //3.5 generate llvm bitcode
-
-            cerr << "tcg_llvm_ctx->generateCode(s, &temp_tb) will be invoked." << endl;
-            temp_tb.tcg_llvm_context = NULL;
-            temp_tb.llvm_function = NULL;
-
-            tcg_llvm_ctx->generateCode(s, &temp_tb);
+            if(index == 0){
+                tcg_llvm_ctx->crete_init_helper_names(temp_tcg_llvm_offline_ctx.get_helper_names());
+                tcg_llvm_ctx->crete_set_cpuState_size(temp_tcg_llvm_offline_ctx.get_cpuState_size());
+            }
 
-            cerr<< "tcg_llvm_ctx->generateCode(s, &temp_tb) is done." << endl;
+            tcg_llvm_ctx->crete_add_tbExecSequ(temp_tcg_llvm_offline_ctx.get_tbExecSequ());
 
-            assert(temp_tb.tcg_llvm_context != NULL);
-            assert(temp_tb.llvm_function != NULL);
+            //3. Translate
+            crete_translate_window(temp_tcg_llvm_offline_ctx, "offline-tbir.txt");
         }
 
-        {
-            //process crete_CPUStateSynctable();
-            ss.str(string());
-            ss << "dump_sync_cpu_states." << streamed_count-1 << ".bin";
-            tcg_llvm_ctx->generate_llvm_cpuStateSyncTables(ss.str());
-        }
+        //process crete_CPUStateSynctable();
+        tcg_llvm_ctx->generate_llvm_cpuStateSyncTables(
+                crete_window_file("dump_sync_cpu_states", index, ".bin"));
 
-        {
-            //process dump_new_sync_memos();
-            ss.str(string());
-            ss << "dump_new_sync_memos." << streamed_count-1 << ".bin";
-            tcg_llvm_ctx->generate_llvm_MemorySyncTables(ss.str());
-        }
+        //process dump_new_sync_memos();
+        tcg_llvm_ctx->generate_llvm_MemorySyncTables(
+                crete_window_file("dump_new_sync_memos", index, ".bin"));
     }
 
     //4. generate main function
@@ -401,9 +605,21 @@ void x86_llvm_translator()
     //    delete tcg_llvm_offline_ctx;
 }
 
+// crete-llvm-translator-qemu-2.3-<arch> [-j <jobs>] [<translation-cache-dir>]
 int main(int argc, char **argv) {
     crete_set_data_dir(argv[0]);
 
+    int arg_index = 1;
+    if(argc > arg_index + 1 && string(argv[arg_index]) == "-j") {
+        crete_translator_jobs = strtoull(argv[arg_index + 1], NULL, 10);
+        if(crete_translator_jobs == 0)
+            crete_translator_jobs = 1;
+        arg_index += 2;
+    }
+
+    if(argc > arg_index)
+        crete_translation_cache_dir = argv[arg_index];
+
     try {
         x86_llvm_translator();
     }
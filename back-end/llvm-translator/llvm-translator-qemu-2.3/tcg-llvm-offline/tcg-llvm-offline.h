@@ -48,7 +48,7 @@ private:
     uint64_t m_cpuState_size;
 
 public:
-    TCGLLVMOfflineContext() {};
+    TCGLLVMOfflineContext() : m_cpuState_size(0) {};
     ~TCGLLVMOfflineContext() {};
 
     template <class Archive>
@@ -93,6 +93,9 @@ public:
     void print_info();
     void dump_verify();
     uint64_t get_size();
+
+    // Exchange contents without copying the captured TCGContexts
+    void swap(TCGLLVMOfflineContext& other);
 };
 
 #endif // #ifdef __cplusplus
@@ -71,6 +71,10 @@ extern "C" {
 #include <llvm/Bitcode/ReaderWriter.h>
 #include "llvm/Linker.h"
 #include "llvm/Support/Path.h"
+#if defined(USE_LLVM_3_4)
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#endif
 
 #include "tcg-llvm-offline/tcg-llvm-offline.h"
 
@@ -79,9 +83,13 @@ extern "C" {
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/exception/all.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <exception>
 
 #include <fstream>
+#include <unistd.h>
 #endif // #if defined(TCG_LLVM_OFFLINE)
 
 #include <iostream>
@@ -126,7 +134,9 @@ struct CPUStateElement{
 
 typedef pair<bool, vector<CPUStateElement> > cpuStateSyncTable_ty;
 
-typedef vector<pair<uint64_t, uint8_t> > memoSyncTable_ty;
+// <start address, values of contiguous bytes>
+typedef pair<uint64_t, vector<uint8_t> > memoSyncRange_ty;
+typedef vector<memoSyncRange_ty> memoSyncTable_ty;
 
 struct TCGLLVMContextPrivate {
     LLVMContext& m_context;
@@ -250,6 +260,17 @@ public:
     int generateOperation(TCGOp* op, int opc, const TCGArg *args);
 
     void generateCode(TCGContext *s, TranslationBlock *tb);
+    string getTbContentKey(TCGContext *s) const;
+
+    void crete_set_translation_cache(const string& cache_dir);
+    string getTbCachePath(const string& content_key, uint64_t pc, const char *ext) const;
+    Function* loadCachedTbFunction(const string& content_key, uint64_t pc, const string& fName);
+    void storeCachedTbFunction(const string& content_key, uint64_t pc, Function *f);
+    Function* cloneTbFunction(Function *f, Module *dest, const string& name);
+
+    void crete_write_tb_functions(const string& file_name, uint64_t first_tb,
+            const vector<pair<uint64_t, uint64_t> >& tbExecSequ);
+    bool crete_link_tb_functions(const string& file_name);
 
     Value* new_generateQemuMemOp(bool ld, Value *value,
             Value *addr, TCGArg memop, int mem_index, int bits);
@@ -280,11 +301,24 @@ private:
 
     vector<pair<uint64_t, GlobalVariable *> > m_cpuState_sync_globals;
     vector<pair<uint64_t, GlobalVariable *> > m_memory_sync_globals;
+
+    // Generated llvm function of each captured TB: <unique-tb-number, function>
+    map<uint64_t, Function *> m_tbFunctions;
+    // Captured TBs with identical TCG ops share one llvm function: <content-key, function>
+    boost::unordered_map<string, Function *> m_tbFunctionsByContent;
+    // <pc, content-key> of each captured TB, indexed by unique-tb-number
+    vector<pair<uint64_t, const string *> > m_tbKeys;
+    uint64_t m_tbReusedCount;
+
+    // Persistent translation cache shared by traces of the same target (empty if disabled)
+    string m_tbCacheDir;
+    uint64_t m_tbCachedCount;
 };
 
 TCGLLVMContextPrivate::TCGLLVMContextPrivate()
     : m_context(getGlobalContext()), m_builder(m_context), m_tbCount(0),
-      m_tcgContext(NULL), m_tbFunction(NULL)
+      m_tcgContext(NULL), m_tbFunction(NULL), m_tbReusedCount(0),
+      m_tbCachedCount(0)
 {
     std::memset(m_values, 0, sizeof(m_values));
     std::memset(m_memValuesPtr, 0, sizeof(m_memValuesPtr));
@@ -1339,12 +1373,94 @@ int TCGLLVMContextPrivate::generateOperation(TCGOp* op, int opc, const TCGArg *a
     return nb_args;
 }
 
+// The content of a TB that its llvm code depends on: the layout of the
+// TCG temps and the TCG ops with their arguments (which include the guest pc
+// of each instruction).
+string TCGLLVMContextPrivate::getTbContentKey(TCGContext *s) const
+{
+    std::string key;
+
+    key.append((const char *)&s->nb_globals, sizeof(s->nb_globals));
+    key.append((const char *)&s->nb_temps, sizeof(s->nb_temps));
+    for(int i = 0; i < s->nb_temps; ++i) {
+        const TCGTemp &t = s->temps[i];
+        int64_t fields[] = {t.base_type, t.type, t.fixed_reg, t.fixed_reg ? t.reg : 0,
+                t.mem_reg, (int64_t)t.mem_offset, t.temp_local};
+        key.append((const char *)fields, sizeof(fields));
+    }
+
+    TCGOp *op;
+    for (int oi = s->gen_first_op_idx, opc_index = 0; oi >= 0; oi = op->next, ++opc_index)
+    {
+        op = &s->gen_op_buf[oi];
+
+        int opc = gen_opc_buf[opc_index];
+        if(opc == INDEX_op_end)
+            break;
+
+        const TCGOpDef &def = tcg_op_defs[opc];
+        int nb_args = (opc == INDEX_op_call) ?
+                op->callo + op->calli + def.nb_cargs : def.nb_args;
+
+        int64_t header[] = {opc, op->callo, op->calli, nb_args};
+        key.append((const char *)header, sizeof(header));
+
+        const TCGArg *args = &gen_opparam_buf[op->args];
+        if(opc == INDEX_op_call) {
+            // Helpers are identified by name, as their addresses are
+            // specific to the qemu process the trace was captured from
+            int func_idx = op->callo + op->calli;
+            key.append((const char *)args, func_idx * sizeof(TCGArg));
+            key.append(get_crete_helper_name((uint64_t)args[func_idx]));
+            key.append((const char *)&args[func_idx + 1],
+                    (nb_args - func_idx - 1) * sizeof(TCGArg));
+        } else if(opc == INDEX_op_exit_tb) {
+            // The returned value (tb pointer within qemu) is not used by crete main
+        } else {
+            key.append((const char *)args, nb_args * sizeof(TCGArg));
+        }
+    }
+
+    return key;
+}
+
 void TCGLLVMContextPrivate::generateCode(TCGContext *s, TranslationBlock *tb)
 {
-    /* Create new function for current translation block */
-    /* TODO: compute the checksum of the tb to see if we can reuse some code */
+    uint64_t tb_number = m_tbCount++;
+
     std::ostringstream fName;
-    fName << "tcg-llvm-tb-" << (m_tbCount++) << "-" << std::hex << tb->pc;
+    fName << "tcg-llvm-tb-" << tb_number << "-" << std::hex << tb->pc;
+
+#if defined(TCG_LLVM_OFFLINE)
+    /* Reuse the function of an identical tb translated before */
+    string content_key = getTbContentKey(s);
+    Function *reused_function = NULL;
+
+    boost::unordered_map<string, Function *>::const_iterator reuse_it =
+            m_tbFunctionsByContent.find(content_key);
+    if(reuse_it != m_tbFunctionsByContent.end()) {
+        reused_function = reuse_it->second;
+        ++m_tbReusedCount;
+    } else if(!m_tbCacheDir.empty()) {
+        reused_function = loadCachedTbFunction(content_key, tb->pc, fName.str());
+        if(reused_function) {
+            reuse_it = m_tbFunctionsByContent.insert(make_pair(content_key, reused_function)).first;
+            ++m_tbCachedCount;
+        }
+    }
+
+    if(reused_function) {
+        m_tbFunctions[tb_number] = reused_function;
+        m_tbKeys.push_back(make_pair((uint64_t)tb->pc, &reuse_it->first));
+
+        tb->llvm_function = reused_function;
+        tb->llvm_tc_ptr = 0;
+        tb->llvm_tc_end = 0;
+        return;
+    }
+#endif //#if defined(TCG_LLVM_OFFLINE)
+
+    /* Create new function for current translation block */
 
 
 #if defined(CRETE_DEBUG)
@@ -1447,6 +1563,15 @@ void TCGLLVMContextPrivate::generateCode(TCGContext *s, TranslationBlock *tb)
     tb->llvm_tc_ptr = 0;
     tb->llvm_tc_end = 0;
 
+#if defined(TCG_LLVM_OFFLINE)
+    m_tbFunctions[tb_number] = m_tbFunction;
+    m_tbKeys.push_back(make_pair((uint64_t)tb->pc,
+            &m_tbFunctionsByContent.insert(make_pair(content_key, m_tbFunction)).first->first));
+
+    if(!m_tbCacheDir.empty())
+        storeCachedTbFunction(content_key, tb->pc, m_tbFunction);
+#endif //#if defined(TCG_LLVM_OFFLINE)
+
 #ifdef DEBUG_DISAS
     if (unlikely(qemu_loglevel_mask(CPU_LOG_TB_OP))) {
         qemu_log("OP:\n");
@@ -1466,6 +1591,369 @@ void TCGLLVMContextPrivate::generateCode(TCGContext *s, TranslationBlock *tb)
     }
 }
 
+/* Persistent translation cache:
+ * Each entry holds the llvm function of one TB in a standalone bitcode module
+ * (tb-<pc>-<hash>.bc), with the content key it was generated from
+ * (tb-<pc>-<hash>.key) to rule out hash collisions. The key file is written
+ * last, so an entry is valid only if its key file exists.
+ * cache_dir is expected to be specific to the set of helpers being linked.
+ * */
+void TCGLLVMContextPrivate::crete_set_translation_cache(const string& cache_dir)
+{
+#if defined(USE_LLVM_3_4)
+    boost::filesystem::create_directories(cache_dir);
+    m_tbCacheDir = cache_dir;
+#else
+    cerr << "[CRETE Warning] Translation cache is only supported with llvm 3.4\n";
+#endif
+}
+
+string TCGLLVMContextPrivate::getTbCachePath(const string& content_key, uint64_t pc,
+        const char *ext) const
+{
+    std::ostringstream name;
+    name << "tb-" << std::hex << pc << "-" << boost::hash<string>()(content_key) << ext;
+
+    return (boost::filesystem::path(m_tbCacheDir) / name.str()).string();
+}
+
+#if defined(USE_LLVM_3_4)
+// Declares in the cache module the globals referenced by a cached TB function,
+// which get resolved against the helper modules when the entry is loaded
+class TbCacheMaterializer : public ValueMaterializer
+{
+public:
+    TbCacheMaterializer(Module *cache_module)
+        : m_cache_module(cache_module), m_failed(false) {}
+
+    virtual Value *materializeValueFor(Value *v)
+    {
+        GlobalValue *gv = dyn_cast<GlobalValue>(v);
+        if(!gv)
+            return 0;
+
+        // Globals with local linkage can't be resolved from another module
+        if(gv->hasLocalLinkage())
+            m_failed = true;
+
+        if(Function *f = dyn_cast<Function>(gv)) {
+            Function *decl = m_cache_module->getFunction(f->getName());
+            if(!decl)
+                decl = Function::Create(f->getFunctionType(),
+                        Function::ExternalLinkage, f->getName(), m_cache_module);
+            return decl;
+        }
+
+        if(GlobalVariable *var = dyn_cast<GlobalVariable>(gv)) {
+            GlobalVariable *decl = m_cache_module->getGlobalVariable(var->getName());
+            if(!decl)
+                decl = new GlobalVariable(*m_cache_module, var->getType()->getElementType(),
+                        var->isConstant(), GlobalValue::ExternalLinkage, 0, var->getName(),
+                        0, var->getThreadLocalMode(), var->getType()->getAddressSpace());
+            return decl;
+        }
+
+        m_failed = true;
+        return 0;
+    }
+
+    bool failed() const { return m_failed; }
+
+private:
+    Module *m_cache_module;
+    bool m_failed;
+};
+
+static bool crete_write_file_atomic(const string& path, const string& content)
+{
+    std::ostringstream tmp_path;
+    tmp_path << path << "." << getpid() << ".tmp";
+
+    {
+        std::ofstream ofs(tmp_path.str().c_str(), ios_base::binary);
+        if(!ofs)
+            return false;
+        ofs.write(content.data(), content.size());
+        if(!ofs)
+            return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp_path.str(), path, ec);
+
+    return !ec;
+}
+#endif // defined(USE_LLVM_3_4)
+
+Function* TCGLLVMContextPrivate::loadCachedTbFunction(const string& content_key,
+        uint64_t pc, const string& fName)
+{
+#if defined(USE_LLVM_3_4)
+    std::ifstream key_ifs(getTbCachePath(content_key, pc, ".key").c_str(), ios_base::binary);
+    if(!key_ifs)
+        return NULL;
+
+    string cached_key((std::istreambuf_iterator<char>(key_ifs)),
+            std::istreambuf_iterator<char>());
+    if(cached_key != content_key)
+        return NULL;
+
+    const string bc_path = getTbCachePath(content_key, pc, ".bc");
+    OwningPtr<MemoryBuffer> buffer;
+    if (error_code ec = MemoryBuffer::getFile(bc_path, buffer)) {
+        cerr << "[CRETE Warning] Failed to read translation cache " << bc_path
+                << ": " << ec.message() << endl;
+        return NULL;
+    }
+
+    std::string error;
+    Module *cached = ParseBitcodeFile(buffer.get(), m_context, &error);
+    if(!cached) {
+        cerr << "[CRETE Warning] Failed to parse translation cache " << bc_path
+                << ": " << error << endl;
+        return NULL;
+    }
+
+    Function *cached_function = NULL;
+    for(Module::iterator it = cached->begin(); it != cached->end(); ++it) {
+        if(!it->isDeclaration()) {
+            cached_function = &*it;
+            break;
+        }
+    }
+
+    if(!cached_function) {
+        delete cached;
+        return NULL;
+    }
+
+    cached_function->setName(fName);
+
+    if(Linker::LinkModules(m_module, cached, Linker::DestroySource, &error)) {
+        cerr << "[CRETE Warning] Failed to link translation cache " << bc_path
+                << ": " << error << endl;
+        delete cached;
+        return NULL;
+    }
+
+    delete cached;
+
+    return m_module->getFunction(fName);
+#else
+    return NULL;
+#endif // defined(USE_LLVM_3_4)
+}
+
+void TCGLLVMContextPrivate::storeCachedTbFunction(const string& content_key,
+        uint64_t pc, Function *f)
+{
+#if defined(USE_LLVM_3_4)
+    Module cached("tcg-llvm-tb-cache", m_context);
+    if(!cloneTbFunction(f, &cached, f->getName().str())) {
+        cerr << "[CRETE Warning] " << f->getName().str()
+                << " is not stored in translation cache.\n";
+        return;
+    }
+
+    string bitcode;
+    {
+        llvm::raw_string_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(&cached, os);
+    }
+
+    if(!crete_write_file_atomic(getTbCachePath(content_key, pc, ".bc"), bitcode) ||
+            !crete_write_file_atomic(getTbCachePath(content_key, pc, ".key"), content_key)) {
+        cerr << "[CRETE Warning] Failed to write translation cache for "
+                << f->getName().str() << endl;
+    }
+#endif // defined(USE_LLVM_3_4)
+}
+
+// Copies f into dest as an external function, declaring in dest the globals it
+// references. Returns NULL if f can't be moved to another module.
+Function* TCGLLVMContextPrivate::cloneTbFunction(Function *f, Module *dest,
+        const string& name)
+{
+#if defined(USE_LLVM_3_4)
+    Function *cloned_function = Function::Create(f->getFunctionType(),
+            Function::ExternalLinkage, name, dest);
+
+    ValueToValueMapTy vmap;
+    Function::arg_iterator cloned_arg = cloned_function->arg_begin();
+    for(Function::const_arg_iterator arg = f->arg_begin(); arg != f->arg_end();
+            ++arg, ++cloned_arg) {
+        vmap[&*arg] = &*cloned_arg;
+    }
+
+    SmallVector<ReturnInst*, 8> returns;
+    TbCacheMaterializer materializer(dest);
+    CloneFunctionInto(cloned_function, f, vmap, true, returns, "", 0, 0, &materializer);
+
+    if(materializer.failed()) {
+        cloned_function->eraseFromParent();
+        return NULL;
+    }
+
+    return cloned_function;
+#else
+    return NULL;
+#endif // defined(USE_LLVM_3_4)
+}
+
+/* Parallel translation:
+ * A worker process translates a window of captured TBs on its own, and writes
+ * the functions of the window into a standalone bitcode module, which carries
+ * the <pc, function, content-key> of each TB ("crete.tb_functions") and the
+ * execution sequence of the window ("crete.tb_exec_sequ") as named metadata.
+ * The main process links the windows in order, as if it translated them.
+ * */
+void TCGLLVMContextPrivate::crete_write_tb_functions(const string& file_name,
+        uint64_t first_tb, const vector<pair<uint64_t, uint64_t> >& tbExecSequ)
+{
+#if defined(USE_LLVM_3_4)
+    Module window("tcg-llvm-window", m_context);
+    NamedMDNode *tb_md = window.getOrInsertNamedMetadata("crete.tb_functions");
+    NamedMDNode *sequ_md = window.getOrInsertNamedMetadata("crete.tb_exec_sequ");
+
+    map<Function *, Function *> cloned_functions;
+    for(uint64_t tb_number = first_tb; tb_number < (uint64_t)m_tbCount; ++tb_number) {
+        Function *&cloned = cloned_functions[m_tbFunctions[tb_number]];
+        if(!cloned) {
+            std::ostringstream name;
+            name << "tcg-llvm-window-tb-" << cloned_functions.size();
+
+            cloned = cloneTbFunction(m_tbFunctions[tb_number], &window, name.str());
+            if(!cloned) {
+                BOOST_THROW_EXCEPTION(std::runtime_error("[CRETE Error] "
+                        + m_tbFunctions[tb_number]->getName().str()
+                        + " can not be moved to another module.\n"));
+            }
+        }
+
+        Value *ops[] = {
+                ConstantInt::get(intType(64), m_tbKeys[tb_number].first),
+                MDString::get(m_context, cloned->getName()),
+                MDString::get(m_context, *m_tbKeys[tb_number].second) };
+        tb_md->addOperand(MDNode::get(m_context, ops));
+    }
+
+    for(vector<pair<uint64_t, uint64_t> >::const_iterator it = tbExecSequ.begin();
+            it != tbExecSequ.end(); ++it) {
+        Value *ops[] = {
+                ConstantInt::get(intType(64), it->first),
+                ConstantInt::get(intType(64), it->second) };
+        sequ_md->addOperand(MDNode::get(m_context, ops));
+    }
+
+    std::string error;
+    llvm::raw_fd_ostream o(file_name.c_str(), error, llvm::sys::fs::F_Binary);
+    if(!error.empty()) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("[CRETE Error] Failed to write "
+                + file_name + ": " + error));
+    }
+
+    llvm::WriteBitcodeToFile(&window, o);
+#else
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+            "[CRETE Error] Parallel translation is only supported with llvm 3.4"));
+#endif // defined(USE_LLVM_3_4)
+}
+
+// Returns false if the window can't be loaded, in which case it has to be
+// translated by the calling process
+bool TCGLLVMContextPrivate::crete_link_tb_functions(const string& file_name)
+{
+#if defined(USE_LLVM_3_4)
+    OwningPtr<MemoryBuffer> buffer;
+    if (error_code ec = MemoryBuffer::getFile(file_name, buffer)) {
+        cerr << "[CRETE Warning] Failed to read translated window " << file_name
+                << ": " << ec.message() << endl;
+        return false;
+    }
+
+    std::string error;
+    Module *window = ParseBitcodeFile(buffer.get(), m_context, &error);
+    if(!window) {
+        cerr << "[CRETE Warning] Failed to parse translated window " << file_name
+                << ": " << error << endl;
+        return false;
+    }
+
+    NamedMDNode *tb_md = window->getNamedMetadata("crete.tb_functions");
+    NamedMDNode *sequ_md = window->getNamedMetadata("crete.tb_exec_sequ");
+    if(!tb_md || !sequ_md) {
+        cerr << "[CRETE Warning] Invalid translated window " << file_name << endl;
+        delete window;
+        return false;
+    }
+
+    vector<uint64_t> tb_pcs;
+    vector<string> tb_function_names;
+    vector<string> tb_content_keys;
+    for(unsigned i = 0; i < tb_md->getNumOperands(); ++i) {
+        MDNode *node = tb_md->getOperand(i);
+        tb_pcs.push_back(cast<ConstantInt>(node->getOperand(0))->getZExtValue());
+        tb_function_names.push_back(cast<MDString>(node->getOperand(1))->getString().str());
+        tb_content_keys.push_back(cast<MDString>(node->getOperand(2))->getString().str());
+    }
+
+    vector<pair<uint64_t, uint64_t> > tbExecSequ;
+    for(unsigned i = 0; i < sequ_md->getNumOperands(); ++i) {
+        MDNode *node = sequ_md->getOperand(i);
+        tbExecSequ.push_back(make_pair(
+                cast<ConstantInt>(node->getOperand(0))->getZExtValue(),
+                cast<ConstantInt>(node->getOperand(1))->getZExtValue()));
+    }
+
+    tb_md->eraseFromParent();
+    sequ_md->eraseFromParent();
+
+    if(Linker::LinkModules(m_module, window, Linker::DestroySource, &error)) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("[CRETE Error] Failed to link translated window "
+                + file_name + ": " + error));
+    }
+
+    delete window;
+
+    for(uint64_t i = 0; i < tb_pcs.size(); ++i) {
+        uint64_t tb_number = m_tbCount++;
+
+        boost::unordered_map<string, Function *>::iterator it =
+                m_tbFunctionsByContent.find(tb_content_keys[i]);
+        if(it != m_tbFunctionsByContent.end()) {
+            ++m_tbReusedCount;
+        } else {
+            std::ostringstream fName;
+            fName << "tcg-llvm-tb-" << tb_number << "-" << std::hex << tb_pcs[i];
+
+            Function *f = m_module->getFunction(tb_function_names[i]);
+            assert(f);
+            f->setName(fName.str());
+
+            it = m_tbFunctionsByContent.insert(make_pair(tb_content_keys[i], f)).first;
+        }
+
+        m_tbFunctions[tb_number] = it->second;
+        m_tbKeys.push_back(make_pair(tb_pcs[i], &it->first));
+    }
+
+    // Drop the functions of TBs translated by other windows as well
+    for(vector<string>::const_iterator it = tb_function_names.begin();
+            it != tb_function_names.end(); ++it) {
+        if(Function *f = m_module->getFunction(*it)) {
+            assert(f->use_empty());
+            f->eraseFromParent();
+        }
+    }
+
+    m_tbExecSequ.insert(m_tbExecSequ.end(), tbExecSequ.begin(), tbExecSequ.end());
+
+    return true;
+#else
+    return false;
+#endif // defined(USE_LLVM_3_4)
+}
+
 void TCGLLVMContextPrivate::crete_init_helper_names(const map<uint64_t, string>& helper_names)
 {
     m_crete_helper_names = helper_names;
@@ -1564,9 +2052,10 @@ void TCGLLVMContextPrivate::generate_crete_main()
         generate_crete_tb_prologue(tb_count, it->first, crete_cpu_state);
 
         // 6.   %1 = call i64 @tcg-llvm-tb-0-b7db3f45(i64* %cpu_state_addr)
-        std::ostringstream fName;
-        fName << "tcg-llvm-tb-" << std::dec << it->second << "-" << std::hex << it->first;
-        Function *tcg_llvm_tb = m_module->getFunction(fName.str());
+        //      (the function may be shared by captured TBs with identical content)
+        map<uint64_t, Function *>::const_iterator f_it = m_tbFunctions.find(it->second);
+        assert(f_it != m_tbFunctions.end());
+        Function *tcg_llvm_tb = f_it->second;
 
         assert(tcg_llvm_tb);
 
@@ -1591,6 +2080,11 @@ void TCGLLVMContextPrivate::generate_crete_main()
             std::vector<llvm::Value*>(1, ConstantInt::get(intType(64), tb_count)));
 
     m_builder.CreateRet(0);
+
+    cerr << "[CRETE] generate_crete_main(): " << std::dec << m_tbCount
+            << " captured TBs, " << m_tbReusedCount
+            << " reused the llvm function of an identical TB, " << m_tbCachedCount
+            << " loaded from translation cache.\n";
 }
 
 GlobalVariable* TCGLLVMContextPrivate::generate_crete_init_cpuState()
@@ -1663,6 +2157,7 @@ void TCGLLVMContextPrivate::generate_crete_tb_prologue(uint64_t tb_count, uint64
     }
 
     // 2. call void crete_sync_memory(const struct MemoryElement *sync_table, uint32_t st_size)
+    //    (st_size is the number of ranges within sync_table)
     if(m_memory_sync_globals[tb_count].first != 0)
     {
         uint32_t st_size = m_memory_sync_globals[tb_count].first;
@@ -1829,23 +2324,49 @@ void TCGLLVMContextPrivate::generate_llvm_MemorySyncTable(const memoSyncTable_ty
         BOOST_THROW_EXCEPTION(std::runtime_error( "struct.MemoSyncElement is not defined.\n"));
     }
 
+    // 1. The values of all ranges are stored in one un-named const string
+    string values;
+    for(memoSyncTable_ty::const_iterator it = memost.begin();
+            it != memost.end(); ++it) {
+        values.append(it->second.begin(), it->second.end());
+    }
+
+    GlobalVariable* gvar_array_values = new GlobalVariable(*m_module, /*Module=*/
+                                                           ArrayType::get(IntegerType::get(m_module->getContext(), 8), values.size()), /*Type=*/
+                                                           true, /*isConstant=*/
+                                                           GlobalValue::PrivateLinkage, /*Linkage=*/
+                                                           ConstantDataArray::getString(m_module->getContext(),
+                                                                                        values, false), /*Initializer=*/
+                                                           "memo_sync_values_");
+
     uint64_t syncTable_size = memost.size();
     std::vector<Constant*> const_array_elems; // construct value for syncTable in llvm
     const_array_elems.reserve(syncTable_size);
 
+    uint64_t values_offset = 0;
     for(memoSyncTable_ty::const_iterator it = memost.begin();
             it != memost.end(); ++it) {
-        uint8_t value = it->second;
         uint64_t static_addr = it->first;
+        uint64_t size = it->second.size();
+        assert(size != 0);
 
-        // 1. uint8_t m_value
-        ConstantInt* const_int8_value = ConstantInt::get(m_module->getContext(), APInt(8, value));
-        // 2. uint64_t m_static_addr
+        // 1. uint64_t m_static_addr
         ConstantInt* const_int64_static_addr = ConstantInt::get(m_module->getContext(), APInt(64, static_addr));
+        // 2. uint32_t m_size
+        ConstantInt* const_int32_size = ConstantInt::get(m_module->getContext(), APInt(32, size));
+        // 3. const uint8_t *m_data:
+        //      i8* getelementptr inbounds (gvar_array_values, i32 0, i64 values_offset)
+        std::vector<Constant*> data_indices;
+        data_indices.push_back(ConstantInt::get(m_module->getContext(), APInt(32, 0)));
+        data_indices.push_back(ConstantInt::get(m_module->getContext(), APInt(64, values_offset)));
+        Constant* const_ptr_data = ConstantExpr::getGetElementPtr(gvar_array_values, data_indices);
+
+        values_offset += size;
 
         std::vector<Constant*> const_memoSyncElement_fields;
-        const_memoSyncElement_fields.push_back(const_int8_value);
         const_memoSyncElement_fields.push_back(const_int64_static_addr);
+        const_memoSyncElement_fields.push_back(const_int32_size);
+        const_memoSyncElement_fields.push_back(const_ptr_data);
 
         Constant* const_memoSyncElement = ConstantStruct::get(StructTy_struct_MemoSyncElement, const_memoSyncElement_fields);
 
@@ -1853,6 +2374,7 @@ void TCGLLVMContextPrivate::generate_llvm_MemorySyncTable(const memoSyncTable_ty
     }
 
     assert(const_array_elems.size() == syncTable_size);
+    assert(values_offset == values.size());
 
     // Construct type for syncTable in llvm as "MemoSyncElement[syncTable_size]"
     ArrayType* ArrayTy_syncTable = ArrayType::get(StructTy_struct_MemoSyncElement, syncTable_size);
@@ -1907,6 +2429,22 @@ void TCGLLVMContext::writeBitCodeToFile(const std::string &fileName) {
 	m_private->writeBitCodeToFile(fileName);
 }
 
+void TCGLLVMContext::crete_set_translation_cache(const std::string& cache_dir)
+{
+    m_private->crete_set_translation_cache(cache_dir);
+}
+
+void TCGLLVMContext::crete_write_tb_functions(const string& file_name, uint64_t first_tb,
+        const vector<pair<uint64_t, uint64_t> >& tbExecSequ)
+{
+    m_private->crete_write_tb_functions(file_name, first_tb, tbExecSequ);
+}
+
+bool TCGLLVMContext::crete_link_tb_functions(const string& file_name)
+{
+    return m_private->crete_link_tb_functions(file_name);
+}
+
 // NOTE: Code from KLEE
 void TCGLLVMContext::linkWithLibrary(const std::string& libraryName)
 {
@@ -118,6 +118,10 @@ public:
     int getTbCount();
     void writeBitCodeToFile(const std::string &fileName);
     void linkWithLibrary(const std::string& libraryName);
+    void crete_set_translation_cache(const std::string& cache_dir);
+    void crete_write_tb_functions(const string& file_name, uint64_t first_tb,
+            const vector<pair<uint64_t, uint64_t> >& tbExecSequ);
+    bool crete_link_tb_functions(const string& file_name);
 
     void crete_init_helper_names(const map<uint64_t, string>& helper_names);
     const string get_crete_helper_name(const uint64_t func_addr) const;
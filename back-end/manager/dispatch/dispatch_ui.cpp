@@ -11,6 +11,7 @@
 
 #include <crete/exception.h>
 #include <crete/cluster/node_driver.h>
+#include <crete/test_channel.h>
 
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
@@ -78,6 +79,12 @@ auto DispatchUI::process_config(const pt::ptree& config) -> option::Dispatch
         opts.trace.print_graph_only_branches = trace.get<bool>("print-graph-branches-only", false);
         opts.trace.print_elf_info = trace.get<bool>("print-elf-info", false);
         opts.trace.compress = trace.get<bool>("compress", false);
+        opts.trace.compress_format = trace.get<std::string>("compress-format", opts.trace.compress_format);
+        opts.trace.compress_level = trace.get<uint32_t>("compress-level", opts.trace.compress_level);
+
+        if(opts.trace.compress_format != "zstd" && opts.trace.compress_format != "lz4")
+            throw Exception{} << err::arg_invalid_str{opts.trace.compress_format}
+                              << err::parse{"trace.compress-format"};
 
         if(opts.trace.print_graph && !opts.trace.filter_traces)
             throw Exception{} << err::parse{"trace.print-graph requires trace.filter-traces"};
@@ -95,6 +102,21 @@ auto DispatchUI::process_config(const pt::ptree& config) -> option::Dispatch
         opts.test.interval.tc = test.get<uint64_t>("interval.tc", std::numeric_limits<uint64_t>::max());
         opts.test.interval.time = test.get<uint64_t>("interval.time", std::numeric_limits<uint64_t>::max());
         opts.test.interval.new_inst_wait_time = test.get<uint64_t>("interval.new_inst_wait_time", std::numeric_limits<uint64_t>::max());
+        opts.test.priority = test.get<std::string>("priority", opts.test.priority);
+
+        if(opts.test.priority != "fifo" && opts.test.priority != "bfs" && opts.test.priority != "coverage")
+            throw Exception{} << err::arg_invalid_str{opts.test.priority}
+                              << err::parse{"test.priority"};
+
+        opts.test.concurrent_targets = test.get<uint32_t>("concurrent-targets", opts.test.concurrent_targets);
+
+        if(opts.test.concurrent_targets == 0)
+            throw Exception{} << err::parse{"test.concurrent-targets must be at least 1"};
+
+        opts.test.batch = test.get<uint32_t>("batch", opts.test.batch);
+
+        if(opts.test.batch == 0 || opts.test.batch > test_channel_slot_count)
+            throw Exception{} << err::parse{"test.batch must be between 1 and " + std::to_string(test_channel_slot_count)};
 
         if(opts.mode.distributed)
         {
@@ -234,6 +256,7 @@ auto DispatchUI::make_options() -> po::options_description
             ("help,h", "displays help message")
             ("port,p", po::value<Port>(), "master port")
             ("config,c", po::value<fs::path>(), "[required] configuration file")
+            ("resume,r", po::value<fs::path>(), "resume the run rooted at the given dispatch directory")
         ;
 
     return desc;
@@ -286,6 +309,23 @@ auto DispatchUI::process_options() -> void
 
         BOOST_THROW_EXCEPTION(Exception{});
     }
+    if(var_map_.count("resume"))
+    {
+        auto resume_path = var_map_["resume"].as<fs::path>();
+
+        if(!fs::exists(resume_path))
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file_missing{resume_path.string()});
+        }
+
+        if(options_.mode.distributed)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::msg{"--resume is only supported in developer mode"});
+        }
+
+        // Resolves "dispatch/last", which is replaced by a symlink to the resumed root.
+        options_.resume = fs::canonical(resume_path).string();
+    }
     if(var_map_.count("port"))
     {
         master_port_ = var_map_["port"].as<Port>();
@@ -14,6 +14,7 @@ void crete_send_custom_instr_prime(void);
 void crete_send_target_pid(void);
 void crete_void_target_pid(void);
 void crete_send_custom_instr_dump(void);
+char crete_send_custom_instr_snapshot(void);
 
 // For program under test
 void crete_make_concolic(void* addr, size_t size, const char* name);
@@ -0,0 +1 @@
+../../../../../lib/include/crete/sandbox.h
\ No newline at end of file
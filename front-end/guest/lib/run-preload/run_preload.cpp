@@ -7,6 +7,8 @@
 #include <boost/filesystem.hpp>
 
 #include <dlfcn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <cassert>
 #include <cstdlib>
 
@@ -227,6 +229,45 @@ static inline void update_proc_maps()
     }
 }
 
+// Serves tests until crete-run closes the control pipe. Only returns in a forked child,
+// which goes on to run the test from this already linked and configured process.
+static inline void crete_fork_server()
+{
+    fprintf(stderr, "crete_fork_server() entered\n");
+
+    char c;
+
+    while(read(CRETE_FORK_SERVER_CTL_FD, &c, 1) == 1)
+    {
+        pid_t pid = fork();
+
+        if(pid < 0)
+        {
+            throw runtime_error("fork() failed in fork server");
+        }
+
+        if(pid == 0)
+        {
+            close(CRETE_FORK_SERVER_CTL_FD);
+            close(CRETE_FORK_SERVER_ST_FD);
+            setpgrp();
+
+            return;
+        }
+
+        int status = 0;
+
+        if(write(CRETE_FORK_SERVER_ST_FD, &pid, sizeof(pid)) != sizeof(pid) ||
+           waitpid(pid, &status, 0) < 0 ||
+           write(CRETE_FORK_SERVER_ST_FD, &status, sizeof(status)) != sizeof(status))
+        {
+            break;
+        }
+    }
+
+    _exit(0);
+}
+
 static inline void crete_preload_initialize(int argc, char**& argv)
 {
     fprintf(stderr, "crete_preload_initialize() entered\n");
@@ -240,12 +281,21 @@ static inline void crete_preload_initialize(int argc, char**& argv)
         update_proc_maps();
     }
 
-    // Need to call crete_send_target_pid before make_concolics, or they won't be captured.
-    crete_send_target_pid();
-
-    if(!is_sec_cmd)
+    if(is_sec_cmd)
+    {
+        crete_send_target_pid();
+    }
+    else
     {
         config::HarnessConfiguration hconfig = crete_load_configuration();
+
+        if(std::getenv(CRETE_ENV_FORK_SERVER))
+        {
+            crete_fork_server();
+        }
+
+        // Need to call crete_send_target_pid before make_concolics, or they won't be captured.
+        crete_send_target_pid();
         crete_process_configuration(hconfig, argc, argv);
     }
     fprintf(stderr, "crete_preload_initialize() finished\n");
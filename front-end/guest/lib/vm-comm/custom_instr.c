@@ -55,6 +55,20 @@ void crete_send_custom_instr_dump(void)
     );
 }
 
+// Returns 1 once qemu holds a snapshot of the guest taken here, to which it
+// restores the guest after each trace, with the next test on the test channel.
+char crete_send_custom_instr_snapshot(void)
+{
+    volatile char ret = 0;
+
+    __asm__ __volatile__(
+            CRETE_INSTR_SNAPSHOT()
+            : : "a" (&ret)
+    );
+
+    return ret;
+}
+
 //------ For program under test
 // Function to be captured for replay "crete_make_concolic()":
 // 1. Capture values of concolic variable and its name by touching/reading buffer
@@ -5,6 +5,7 @@
 #include <crete/custom_instr.h>
 #include <crete/exception.h>
 #include <crete/process.h>
+#include <crete/sandbox.h>
 #include <crete/asio/client.h>
 
 #include <boost/process.hpp>
@@ -26,6 +27,7 @@
 
 #include <unistd.h>
 #include <sys/mount.h>
+#include <sys/wait.h>
 
 namespace bp = boost::process;
 namespace fs = boost::filesystem;
@@ -76,8 +78,14 @@ private:
     std::vector<std::string> m_launch_args;
     bp::posix_context m_launch_ctx;
     bp::posix_context m_launch_ctx_secondary;
+    bp::posix_context m_launch_ctx_fork_server;
+    boost::shared_ptr<bp::posix_child> m_fork_server;
+    bool m_fork_server_enabled;
+    uint64_t m_batch_remaining; // Tests left of those announced by the last next_test packet.
+    bool m_snapshot_restore_enabled;
 
     fs::path m_sandbox_dir;
+    boost::shared_ptr<sandbox::PristineDir> m_sandbox_exec;
     fs::path m_environment;
     fs::path m_proc_map;
     fs::path m_guest_config_serialized;
@@ -94,6 +102,8 @@ public:
     void prime_executable();
     void write_configuration() const;
     void launch_executable();
+    void launch_from_fork_server();
+    bool wait_on_snapshot();
     void void_target_pid() const;
     void signal_dump() const;
 
@@ -333,21 +343,30 @@ struct start // Basically, serves as constructor.
     start(const std::string& host_ip,
           const fs::path& config,
           const fs::path& sandbox,
-          const fs::path& environment) :
+          const fs::path& environment,
+          bool fork_server,
+          bool snapshot_restore) :
         host_ip_(host_ip),
         config_(config),
         sandbox_(sandbox),
-        environment_(environment)
+        environment_(environment),
+        fork_server_(fork_server),
+        snapshot_restore_(snapshot_restore)
     {}
 
     const std::string& host_ip_;
     const fs::path& config_;
     const fs::path& sandbox_;
     const fs::path& environment_;
+    bool fork_server_;
+    bool snapshot_restore_;
 };
 
 RunnerFSM_::RunnerFSM_() :
     client_(),
+    m_fork_server_enabled(false),
+    m_batch_remaining(0),
+    m_snapshot_restore_enabled(false),
     pid_(-1),
     is_first_exec_(true),
     proc_maps_hash_(0)
@@ -361,6 +380,8 @@ void RunnerFSM_::init(const start& ev)
 
     m_sandbox_dir = ev.sandbox_;
     m_environment = ev.environment_;
+    m_fork_server_enabled = ev.fork_server_;
+    m_snapshot_restore_enabled = ev.snapshot_restore_;
 }
 
 void RunnerFSM_::verify_env(const poll&)
@@ -544,6 +565,15 @@ void RunnerFSM_::setup_launch_exec()
     m_launch_ctx_secondary = m_launch_ctx;
     m_launch_ctx_secondary.environment.insert(bp::environment::value_type(CRETE_ENV_SEC_CMD, "true"));
 
+    // The fork server outlives each test, so its output can't be read to EOF per test; it's passed through.
+    m_launch_ctx_fork_server = m_launch_ctx;
+    m_launch_ctx_fork_server.output_behavior.clear();
+    m_launch_ctx_fork_server.output_behavior.insert(bp::behavior_map::value_type(STDOUT_FILENO, bp::inherit_stream()));
+    m_launch_ctx_fork_server.output_behavior.insert(bp::behavior_map::value_type(STDERR_FILENO, bp::inherit_stream()));
+    m_launch_ctx_fork_server.output_behavior.insert(bp::behavior_map::value_type(CRETE_FORK_SERVER_ST_FD, bp::capture_stream()));
+    m_launch_ctx_fork_server.input_behavior.insert(bp::behavior_map::value_type(CRETE_FORK_SERVER_CTL_FD, bp::capture_stream()));
+    m_launch_ctx_fork_server.environment.insert(bp::environment::value_type(CRETE_ENV_FORK_SERVER, "true"));
+
     // 5. setup timeout hanlder
     init_timeout_handler();
 }
@@ -683,6 +713,79 @@ void RunnerFSM_::launch_executable()
 #endif
 }
 
+// Reads exactly 'size' bytes from 'fd', carrying on through the SIGALRM of a test timeout
+// (the handler is installed without SA_RESTART). Returns false on EOF or error.
+static bool read_fully(int fd, void* buf, size_t size)
+{
+    char* p = static_cast<char*>(buf);
+
+    while(size > 0)
+    {
+        ssize_t n = ::read(fd, p, size);
+
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            return false;
+        }
+
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+// Has the fork server, started on first use, fork a test from the target as it stood
+// before __libc_start_main. Linking, loading and parsing the harness configuration are
+// thus done once rather than per test.
+void RunnerFSM_::launch_from_fork_server()
+{
+    if(!m_fork_server)
+    {
+        m_fork_server = boost::make_shared<bp::posix_child>(bp::posix_launch(m_exec, m_launch_args, m_launch_ctx_fork_server));
+    }
+
+    bp::postream& ctl = m_fork_server->get_input(CRETE_FORK_SERVER_CTL_FD);
+    // Read from directly: the stream's buffer takes an EINTR for EOF.
+    int st = m_fork_server->get_output(CRETE_FORK_SERVER_ST_FD).handle().get();
+
+    pid_t pid = -1;
+    int status = 0;
+
+    ctl.put(0);
+    ctl.flush();
+
+    if(!read_fully(st, &pid, sizeof(pid)))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::msg("fork server stopped before starting a test"));
+    }
+
+    pid_ = pid;
+    monitored_pid = pid_;
+    assert(monitored_timeout != 0);
+    alarm(monitored_timeout);
+
+    std::cerr << "=== Output from the target executable ===\n";
+
+    if(!read_fully(st, &status, sizeof(status)))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::msg("fork server stopped during a test"));
+    }
+
+    alarm(0);
+
+    int exit_status = WIFSIGNALED(status) ? CRETE_EXIT_CODE_SIG_BASE + WTERMSIG(status)
+                                          : WEXITSTATUS(status);
+
+    process_exit_status(std::cerr, exit_status);
+    std::cerr << "=========================================\n";
+}
+
 static bool execute_command_line(const std::string& cmd, const bp::posix_context& ctx)
  {
     fprintf(stderr, "executing: %s\n", cmd.c_str());
@@ -792,23 +895,66 @@ void RunnerFSM_::update_config(const poll&)
 
 void RunnerFSM_::execute(const next_test&)
 {
-    // Waiting for "next_test", blocking function
+    // Waiting for "next_test", blocking function, unless tests remain of the last batch:
+    // qemu already holds them, and each is traced in turn as its dump is signalled.
     // TODO: should waiting for the command to come in be a guard?
-    PacketInfo pkinfo = client_->read();
-
-    if(pkinfo.type != packet_type::cluster_next_test)
+    if(!wait_on_snapshot())
     {
-        BOOST_THROW_EXCEPTION(Exception() << err::network_type_mismatch(pkinfo.type));
+        if(m_batch_remaining == 0)
+        {
+            PacketInfo pkinfo = client_->read();
+
+            if(pkinfo.type != packet_type::cluster_next_test)
+            {
+                BOOST_THROW_EXCEPTION(Exception() << err::network_type_mismatch(pkinfo.type));
+            }
+
+            m_batch_remaining = std::max<uint64_t>(pkinfo.id, 1);
+        }
+
+        --m_batch_remaining;
     }
 
 #if !defined(CRETE_TEST)
-    launch_executable();
+    if(m_fork_server_enabled)
+    {
+        launch_from_fork_server();
+    }
+    else
+    {
+        launch_executable();
+    }
     void_target_pid();
 
     execute_secondary_cmds();
 #endif // !defined(CRETE_TEST)
 }
 
+// With 'snapshot-restore', qemu snapshots the guest here, once the first iteration has
+// settled the configuration, and restores it after each trace: the sandbox and whatever
+// the test left in memory are rolled back, rather than reset by crete-run.
+// Returns false if the test is to be announced by a next_test packet as usual.
+bool RunnerFSM_::wait_on_snapshot()
+{
+#if !defined(CRETE_TEST)
+    if(!m_snapshot_restore_enabled || is_first_exec_)
+    {
+        return false;
+    }
+
+    if(crete_send_custom_instr_snapshot())
+    {
+        return true;
+    }
+
+    std::cerr << "[crete-run] qemu did not take a snapshot: tests are announced by the host" << std::endl;
+
+    m_snapshot_restore_enabled = false;
+#endif // !defined(CRETE_TEST)
+
+    return false;
+}
+
 // Reference:
 // http://unix.stackexchange.com/questions/128336/why-doesnt-mount-respect-the-read-only-option-for-bind-mounts
 static inline void rdonly_bind_mount(const fs::path src, const fs::path dst)
@@ -870,20 +1016,10 @@ void RunnerFSM_::init_ramdisk()
 
 }
 
-static void reset_folder_permission_recursively(const fs::path& root)
-{
-    for(fs::recursive_directory_iterator it(root), endit;
-            it != endit; ++it) {
-        if(!fs::is_symlink(*it)){
-            fs::permissions(*it, fs::owner_all);
-        }
-    }
-}
-
 // make sure the folder has the right permission within sandbox:
 // 1. "/": the root of sandbox
 // 2. "/tmp"
-// 3. "/tmp/launch-directory"
+// ("/tmp/launch-directory" is seen to by m_sandbox_exec)
 void RunnerFSM_::reset_sandbox_folder_permission()
 {
     {
@@ -901,21 +1037,17 @@ void RunnerFSM_::reset_sandbox_folder_permission()
             fs::permissions(p, fs::perms_mask);
         }
     }
-
-    {
-        fs::path p = fs::path(CRETE_SANDBOX_PATH) / m_exec_launch_dir;
-        if(fs::exists(p))
-        {
-            fs::permissions(p, fs::perms_mask);
-            reset_folder_permission_recursively(p);
-        }
-    }
 }
 // Mount folders to sandbox dir:
 //  "/home, /lib, /lib64, /usr, /dev, /proc" (for executable, dependency libraries, etc)
 // require: "sudo setcap CAP_SYS_ADMIN+ep ./crete-run"
 void RunnerFSM_::init_sandbox()
 {
+    // Also unmounts and removes the launch directory left by a previous run.
+    m_sandbox_exec.reset(new sandbox::PristineDir(m_sandbox_dir,
+                                                  fs::path(CRETE_SANDBOX_PATH) / m_exec_launch_dir,
+                                                  CRETE_SANDBOX_OVERLAY_PATH));
+
     reset_sandbox_folder_permission();
 
     // delete the sandbox folder if it existed
@@ -1001,7 +1133,7 @@ void RunnerFSM_::init_sandbox()
     fs::create_directories(fs::path(CRETE_SANDBOX_PATH) / "tmp");
 }
 
-// reset CRETE_SANDBOX_EXEC folder by copying m_sandbox_dir
+// reset CRETE_SANDBOX_EXEC folder to the contents of m_sandbox_dir
 void RunnerFSM_::reset_sandbox()
 {
     // 1. reset "ramdisk folder" within sandbox
@@ -1014,30 +1146,8 @@ void RunnerFSM_::reset_sandbox()
     }
 
     // 2. reset "sandbox-exec folder" within sandbox
-    fs::path crete_sandbox_exec_path = fs::path(CRETE_SANDBOX_PATH) / m_exec_launch_dir;
-    if(fs::exists(crete_sandbox_exec_path))
-    {
-        fs::remove_all(crete_sandbox_exec_path);
-    }
-    assert(fs::is_directory(fs::path(crete_sandbox_exec_path).parent_path()));
-
-    bp::context ctx;
-    ctx.stdout_behavior = bp::capture_stream();
-    ctx.environment = bp::self::get_environment();
-
-    std::string exec = bp::find_executable_in_path("cp");
-    std::vector<std::string> args;
-    args.push_back(exec);
-    args.push_back("-r");
-    args.push_back(m_sandbox_dir.string());
-    args.push_back(crete_sandbox_exec_path.string());
-
-    bp::child c = bp::launch(exec, args, ctx);
-
-    bp::pistream &is = c.get_stdout();
-
-    // TODO: xxx should check the return status to make sure the "cp" completed successfully
-    bp::status s = c.wait();
+    assert(m_sandbox_exec && "[crete-run] sandbox-exec folder should be set up by \"init_sandbox()\"\n");
+    m_sandbox_exec->reset();
 }
 
 void RunnerFSM_::finished(const poll&)
@@ -1215,6 +1325,8 @@ bool RunnerFSM_::is_not_first_exec(const poll&)
 Runner::Runner(int argc, char* argv[]) :
     ops_descr_(make_options()),
     fsm_(boost::make_shared<RunnerFSM>()),
+    fork_server_(false),
+    snapshot_restore_(false),
     stopped_(false)
 {
     parse_options(argc, argv);
@@ -1235,6 +1347,8 @@ po::options_description Runner::make_options()
             ("ip,i", po::value<std::string>(), "host IP")
             ("sandbox,s", po::value<fs::path>(), "sandbox directory")
             ("environment,v", po::value<fs::path>(), "environment file")
+            ("fork-server,f", "fork each test from a target stopped before main, rather than launching it")
+            ("snapshot-restore,r", "have qemu restore the guest from an in-memory snapshot after each test (requires 'sandbox' and a qemu built with CRETE_SNAPSHOT_RESTORE=y; guest networking is unusable once the snapshot is taken)")
         ;
 
     return desc;
@@ -1306,6 +1420,26 @@ void Runner::process_options()
 
         environment_path_ = p;
     }
+
+    if(var_map_.count("fork-server"))
+    {
+        if(!sandbox_dir_.empty())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::msg("'fork-server' can't be used with 'sandbox': the sandbox is rebuilt between tests"));
+        }
+
+        fork_server_ = true;
+    }
+
+    if(var_map_.count("snapshot-restore"))
+    {
+        if(sandbox_dir_.empty())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::msg("'snapshot-restore' requires 'sandbox': the target's writes must stay in memory to be rolled back"));
+        }
+
+        snapshot_restore_ = true;
+    }
 }
 
 void Runner::start_FSM()
@@ -1323,7 +1457,9 @@ void Runner::run()
     start s(ip_,
             target_config_,
             sandbox_dir_,
-            environment_path_);
+            environment_path_,
+            fork_server_,
+            snapshot_restore_);
 
     fsm_->process_event(s);
 
@@ -14,6 +14,7 @@ extern "C" {
 //#define CRETE_CROSS_CHECK // Enable cross check
 
 //#define CRETE_DBG_TA    // Debug taint-analysis
+//#define CRETE_TCI_ALWAYS_ANALYZE // Disable the taint-free fast path of taint-analysis
 //#define CRETE_DBG_MEM   // Debug memory usage
 //#define CRETE_DBG_MEM_MONI // Debug Memory monitoring
 
@@ -0,0 +1,286 @@
+/*
+ * In-memory snapshot of the guest, for crete-run --snapshot-restore.
+ *
+ * The guest's RAM, cpu and APIC state are copied once, where crete-run waits
+ * for its next test. From then on the pages the guest writes are tracked with
+ * the migration dirty bitmap, so rolling the guest back after a trace costs the
+ * pages the test dirtied, not the whole of RAM.
+ *
+ * The vcpu only asks for the snapshot or the rollback: it stops the vm, and
+ * both are done from the main loop, with the vcpu paused and the block devices
+ * drained, once the next test is on the test channel.
+ *
+ * Writable drives are switched, at the snapshot, onto a throwaway qcow2 overlay
+ * that is emptied at each rollback, so the disk goes back with the RAM that
+ * caches it. Other device state (NIC, timers) is not part of the snapshot.
+ */
+
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/memory.h"
+#include "exec/ram_addr.h"
+#include "block/block.h"
+#include "block/block_int.h"
+#include "hw/qdev-core.h"
+#include "migration/qemu-file.h"
+#include "migration/vmstate.h"
+#include "qemu/bitops.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qmp-commands.h"
+#include "sysemu/sysemu.h"
+
+#include "runtime-dump/crete_snapshot.h"
+
+#include <stddef.h>
+#include <unistd.h>
+
+/* How often the main loop looks for the next test while the guest is paused */
+#define CRETE_SNAPSHOT_POLL_US 100
+
+typedef struct CreteSnapshotBlock {
+    uint8_t *host;
+    ram_addr_t offset;
+    ram_addr_t length;
+    uint8_t *copy;
+} CreteSnapshotBlock;
+
+enum {
+    CRETE_SNAPSHOT_NONE,
+    CRETE_SNAPSHOT_TAKE,
+    CRETE_SNAPSHOT_RESTORE,
+};
+
+static CreteSnapshotBlock *crete_snapshot_blocks;
+static size_t crete_snapshot_block_count;
+
+/* Fields from CPU_COMMON on are qemu's own (tlb) or preserved across resets. */
+static uint8_t crete_snapshot_cpu[offsetof(CPUX86State, tlb_table)];
+
+/* The APIC, through its vmstate: loading it back re-arms its timer. */
+static QEMUSizedBuffer *crete_snapshot_apic;
+
+/* Drives whose writes since the snapshot go to an overlay, emptied at rollback */
+static BlockDriverState **crete_snapshot_drives;
+static size_t crete_snapshot_drive_count;
+
+static QEMUTimer *crete_snapshot_timer;
+static int crete_snapshot_pending = CRETE_SNAPSHOT_NONE;
+static CPUX86State *crete_snapshot_env;
+static CreteSnapshotTestReady crete_snapshot_test_ready;
+
+static void crete_snapshot_save_block(void *host_addr, ram_addr_t offset,
+                                      ram_addr_t length, void *opaque)
+{
+    CreteSnapshotBlock *block;
+
+    crete_snapshot_blocks = g_renew(CreteSnapshotBlock, crete_snapshot_blocks,
+                                    crete_snapshot_block_count + 1);
+    block = &crete_snapshot_blocks[crete_snapshot_block_count++];
+
+    block->host = host_addr;
+    block->offset = offset;
+    block->length = length;
+    block->copy = g_malloc(length);
+
+    memcpy(block->copy, host_addr, length);
+
+    cpu_physical_memory_reset_dirty(offset, length, DIRTY_MEMORY_MIGRATION);
+}
+
+static void crete_snapshot_save_apic(CPUX86State *env)
+{
+    DeviceState *apic = x86_env_get_cpu(env)->apic_state;
+    QEMUFile *f;
+
+    if (!apic) {
+        return;
+    }
+
+    crete_snapshot_apic = qsb_create(NULL, 0);
+    f = qemu_bufopen("w", crete_snapshot_apic);
+    vmstate_save_state(f, qdev_get_vmsd(apic), apic, NULL);
+    qemu_fclose(f);
+}
+
+static void crete_snapshot_load_apic(CPUX86State *env)
+{
+    DeviceState *apic = x86_env_get_cpu(env)->apic_state;
+    const VMStateDescription *vmsd;
+    QEMUFile *f;
+
+    if (!crete_snapshot_apic) {
+        return;
+    }
+
+    vmsd = qdev_get_vmsd(apic);
+    f = qemu_bufopen("r", crete_snapshot_apic);
+    if (vmstate_load_state(f, vmsd, apic, vmsd->version_id) != 0) {
+        fprintf(stderr, "[CRETE ERROR] failed to restore the APIC\n");
+        assert(0);
+    }
+    qemu_fclose(f);
+}
+
+static void crete_snapshot_overlay_drives(void)
+{
+    BlockDriverState *bs = NULL;
+
+    while ((bs = bdrv_next(bs))) {
+        const char *device = bdrv_get_device_name(bs);
+        Error *err = NULL;
+        char *overlay;
+
+        if (!bdrv_is_inserted(bs) || bdrv_is_read_only(bs)) {
+            continue;
+        }
+
+        overlay = g_strdup_printf("%s/crete-snapshot-%d-%s.qcow2",
+                                  g_get_tmp_dir(), (int)getpid(), device);
+        // bs stays the drive's top node: the overlay is swapped in under it.
+        qmp_blockdev_snapshot_sync(true, device, false, NULL, overlay,
+                                   false, NULL, true, "qcow2",
+                                   true, NEW_IMAGE_MODE_ABSOLUTE_PATHS, &err);
+        if (err) {
+            error_report_err(err);
+            assert(0);
+        }
+        // Open for as long as qemu runs; nothing else is to find it.
+        unlink(overlay);
+        g_free(overlay);
+
+        crete_snapshot_drives = g_renew(BlockDriverState *, crete_snapshot_drives,
+                                        crete_snapshot_drive_count + 1);
+        crete_snapshot_drives[crete_snapshot_drive_count++] = bs;
+    }
+}
+
+static void crete_snapshot_empty_drives(void)
+{
+    size_t i;
+
+    for (i = 0; i < crete_snapshot_drive_count; ++i) {
+        BlockDriverState *bs = crete_snapshot_drives[i];
+
+        if (bs->drv->bdrv_make_empty(bs) < 0) {
+            fprintf(stderr, "[CRETE ERROR] failed to roll back drive %s\n",
+                    bdrv_get_device_name(bs));
+            assert(0);
+        }
+        bdrv_flush(bs);
+    }
+}
+
+int crete_snapshot_is_taken(void)
+{
+    return crete_snapshot_block_count != 0;
+}
+
+static void crete_snapshot_take(CPUX86State *env)
+{
+    assert(!crete_snapshot_is_taken());
+
+    memcpy(crete_snapshot_cpu, env, sizeof(crete_snapshot_cpu));
+    crete_snapshot_save_apic(env);
+
+    // Also has the MMU's updates to page table entries (stl_phys_notdirty) marked dirty.
+    memory_global_dirty_log_start();
+    qemu_ram_foreach_block(crete_snapshot_save_block, NULL);
+    crete_snapshot_overlay_drives();
+
+    fprintf(stderr, "[CRETE] snapshot taken: %zu RAM blocks, %zu drives\n",
+            crete_snapshot_block_count, crete_snapshot_drive_count);
+}
+
+static void crete_snapshot_restore(CPUX86State *env)
+{
+    CPUState *cs = ENV_GET_CPU(env);
+    unsigned long *dirty = ram_list.dirty_memory[DIRTY_MEMORY_MIGRATION];
+    size_t i;
+
+    assert(crete_snapshot_is_taken());
+
+    for (i = 0; i < crete_snapshot_block_count; ++i) {
+        const CreteSnapshotBlock *block = &crete_snapshot_blocks[i];
+        unsigned long first = block->offset >> TARGET_PAGE_BITS;
+        unsigned long end = first + (block->length >> TARGET_PAGE_BITS);
+        unsigned long page;
+
+        for (page = find_next_bit(dirty, end, first);
+             page < end;
+             page = find_next_bit(dirty, end, page + 1)) {
+            ram_addr_t addr = (ram_addr_t)(page - first) << TARGET_PAGE_BITS;
+
+            memcpy(block->host + addr, block->copy + addr, TARGET_PAGE_SIZE);
+        }
+
+        cpu_physical_memory_reset_dirty(block->offset, block->length,
+                                        DIRTY_MEMORY_MIGRATION);
+    }
+
+    // tsc_deadline comes back with the rest: tcg does not emulate the
+    // TSC-deadline timer, and the APIC timer is re-armed from its own state.
+    memcpy(env, crete_snapshot_cpu, sizeof(crete_snapshot_cpu));
+    crete_snapshot_load_apic(env);
+
+    crete_snapshot_empty_drives();
+
+    // Translations and code cached from the guest as it was are stale.
+    tlb_flush(cs, 1);
+    tb_flush(env);
+}
+
+static void crete_snapshot_poll(void *opaque)
+{
+    int64_t next = qemu_clock_get_us(QEMU_CLOCK_REALTIME) + CRETE_SNAPSHOT_POLL_US;
+    int ready;
+
+    // The vcpu stops at the end of its tb, and the main loop then stops the vm.
+    if (runstate_is_running()) {
+        timer_mod(crete_snapshot_timer, next);
+        return;
+    }
+
+    if (crete_snapshot_pending == CRETE_SNAPSHOT_TAKE) {
+        bdrv_drain_all();
+        crete_snapshot_take(crete_snapshot_env);
+        crete_snapshot_pending = CRETE_SNAPSHOT_NONE;
+    }
+
+    ready = crete_snapshot_test_ready();
+    if (ready == 0) {
+        timer_mod(crete_snapshot_timer, next);
+        return;
+    }
+    if (ready < 0) {
+        qemu_system_shutdown_request();
+        return;
+    }
+
+    if (crete_snapshot_pending == CRETE_SNAPSHOT_RESTORE) {
+        bdrv_drain_all();
+        crete_snapshot_restore(crete_snapshot_env);
+        crete_snapshot_pending = CRETE_SNAPSHOT_NONE;
+    }
+
+    vm_start();
+}
+
+void crete_snapshot_pause(CPUX86State *env, CreteSnapshotTestReady test_ready)
+{
+    assert(crete_snapshot_pending == CRETE_SNAPSHOT_NONE);
+
+    if (!crete_snapshot_timer) {
+        crete_snapshot_timer = timer_new_us(QEMU_CLOCK_REALTIME,
+                                            crete_snapshot_poll, NULL);
+    }
+
+    crete_snapshot_pending = crete_snapshot_is_taken() ? CRETE_SNAPSHOT_RESTORE
+                                                       : CRETE_SNAPSHOT_TAKE;
+    crete_snapshot_env = env;
+    crete_snapshot_test_ready = test_ready;
+
+    // From the vcpu thread, only requests the stop and has the vcpu leave its loop.
+    vm_stop(RUN_STATE_PAUSED);
+    timer_mod(crete_snapshot_timer, qemu_clock_get_us(QEMU_CLOCK_REALTIME));
+}
@@ -0,0 +1,27 @@
+#ifndef CRETE_SNAPSHOT_H
+#define CRETE_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************/
+/* In-memory snapshot of the guest, restored after each trace */
+struct CPUX86State;
+
+// Returns 1 once the next test is on the test channel, 0 while the guest is to
+// wait for it, and -1 if it is not coming.
+typedef int (*CreteSnapshotTestReady)(void);
+
+int crete_snapshot_is_taken(void);
+// From the vcpu: stops the vm. Then, from the main loop, takes the snapshot, or
+// rolls the guest back to it if taken, and resumes the guest once test_ready().
+// The guest resumes from the snapshot past the instruction that took it.
+void crete_snapshot_pause(struct CPUX86State *env,
+                          CreteSnapshotTestReady test_ready);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
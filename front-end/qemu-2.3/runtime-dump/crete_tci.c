@@ -43,6 +43,17 @@
         tcg_abort(); \
     } while (0)
 
+#if defined(CRETE_DEP_ANALYSIS) || 1
+/* Taint analysis callbacks are only invoked while there is taint to be
+ * propagated. See crete_tci_taint_free in tci_analyzer.cpp. */
+#define CRETE_TCI_ANALYZE(x) \
+    do { \
+        if (!crete_tci_taint_free) { \
+            x; \
+        } \
+    } while (0)
+#endif // defined(CRETE_DEP_ANALYSIS)
+
 #if MAX_OPC_PARAM_IARGS != 5
 # error Fix needed, number of supported input arguments changed!
 #endif
@@ -73,7 +84,7 @@ static tcg_target_ulong tci_read_reg(TCGReg index)
     assert(index < ARRAY_SIZE(tci_reg));
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-    crete_tci_read_reg(index, tci_reg[index]);
+    CRETE_TCI_ANALYZE(crete_tci_read_reg(index, tci_reg[index]));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
     return tci_reg[index];
@@ -129,7 +140,7 @@ static void tci_write_reg(TCGReg index, tcg_target_ulong value)
     assert(index != TCG_REG_CALL_STACK);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-    crete_tci_write_reg(index, value);
+    CRETE_TCI_ANALYZE(crete_tci_write_reg(index, value));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
     tci_reg[index] = value;
@@ -497,6 +508,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
     crete_init_analyzer((uint64_t)env, (uint64_t)sp_value);
+    crete_tci_update_taint_free();
     int temp_crete_read_was_symbolic = 0;
 #endif
 
@@ -580,7 +592,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 opc == INDEX_op_st_i64)*/
 
 #endif
-        crete_tci_next_tci_instr();
+        CRETE_TCI_ANALYZE(crete_tci_next_tci_instr());
 #endif // defined(CRETE_DEP_ANALYSIS)
 
         switch (opc) {
@@ -720,7 +732,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld8u_i32(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld8u_i32(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg8(t0, *(uint8_t *)(t1 + t2));
@@ -756,7 +768,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld_i32(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld_i32(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32(t0, *(uint32_t *)(t1 + t2));
@@ -768,7 +780,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint8_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st8_i32(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st8_i32(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st16_i32:
@@ -778,7 +790,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint16_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st16_i32(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st16_i32(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st_i32:
@@ -807,7 +819,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st_i32(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st_i32(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
 
@@ -1094,7 +1106,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld8u_i64(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld8u_i64(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg8(t0, *(uint8_t *)(t1 + t2));
@@ -1111,7 +1123,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld32u_i64(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld32u_i64(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32(t0, *(uint32_t *)(t1 + t2));
@@ -1122,7 +1134,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld32s_i64(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld32s_i64(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32s(t0, *(int32_t *)(t1 + t2));
@@ -1150,7 +1162,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld_i64(t0, t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_ld_i64(t0, t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg64(t0, *(uint64_t *)(t1 + t2));
@@ -1162,7 +1174,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint8_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st8_i64(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st8_i64(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st16_i64:
@@ -1172,7 +1184,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint16_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st16_i64(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st16_i64(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st32_i64:
@@ -1182,7 +1194,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint32_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st32_i64(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st32_i64(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st_i64:
@@ -1193,7 +1205,7 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint64_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st_i64(t1, t2);
+            CRETE_TCI_ANALYZE(crete_tci_st_i64(t1, t2));
 #endif // defined(CRETE_DEP_ANALYSIS)
 
 #if defined(CRETE_DEBUG_GENERAL)
@@ -1467,56 +1479,56 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 tmp32 = qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld8u(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_SB:
                 tmp32 = (int8_t)qemu_ld_ub;
 
                 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld8s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 tmp32 = qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16u(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16u(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LESW:
                 tmp32 = (int16_t)qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 tmp32 = qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 tmp32 = qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BESW:
                 tmp32 = (int16_t)qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 tmp32 = qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp32);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp32));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1543,84 +1555,84 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 tmp64 = qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld8u(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_SB:
                 tmp64 = (int8_t)qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld8u(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 tmp64 = qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LESW:
                 tmp64 = (int16_t)qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 tmp64 = qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_LESL:
                 tmp64 = (int32_t)qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_LEQ:
                 tmp64 = qemu_ld_leq;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld64(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld64(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_BEUW:
                 tmp64 = qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BESW:
                 tmp64 = (int16_t)qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld16s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 tmp64 = qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_BESL:
                 tmp64 = (int32_t)qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_ld32s(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEQ:
                 tmp64 = qemu_ld_beq;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_ld64(t0, taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_ld64(t0, taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1650,35 +1662,35 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 qemu_st_b(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st8(taddr, t0);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st8(taddr, t0));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 qemu_st_lew(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, t0);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st16(taddr, t0));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 qemu_st_lel(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, t0);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st32(taddr, t0));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 qemu_st_bew(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, t0);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st16(taddr, t0));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 qemu_st_bel(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, t0);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st32(taddr, t0));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1712,49 +1724,49 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 qemu_st_b(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_st8(taddr, tmp64);
+            CRETE_TCI_ANALYZE(crete_tci_qemu_st8(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 qemu_st_lew(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st16(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 qemu_st_lel(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st32(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEQ:
                 qemu_st_leq(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st64(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st64(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 qemu_st_bew(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st16(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 qemu_st_bel(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st32(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEQ:
                 qemu_st_beq(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st64(taddr, tmp64);
+                CRETE_TCI_ANALYZE(crete_tci_qemu_st64(taddr, tmp64));
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -2,6 +2,9 @@
 #include "runtime-dump.h"
 #include "tci_analyzer.h"
 #include "crete-debug.h"
+#if defined(CRETE_SNAPSHOT_RESTORE)
+#include "crete_snapshot.h"
+#endif
 
 #include <boost/serialization/split_member.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -177,14 +180,37 @@ static inline void crete_tracing_finish()
 	assert(rt_dump_tb_count != 0 && "[CRETE ERROR] Nothing is captured.\n");
     assert(runtime_env);
 
+    bool channel = crete_test_channel_ready();
+
 	// Waiting for vm_node
-    while(fs::exists(crete_trace_ready_file_name))
-        ; // Wait for it to not exist. FIXME: not efficient and can hang qume.
+    if(channel)
+    {
+        while(!crete::ring_empty(g_crete_test_channel.traces()))
+            usleep(100); // Until it has taken the previous trace.
+    }
+    else
+    {
+        while(fs::exists(crete_trace_ready_file_name))
+            ; // Wait for it to not exist. FIXME: not efficient and can hang qume.
+    }
 
     // Writing trace to file
     runtime_env->writeRtEnvToFile();
     runtime_env->printInfo();
 
+    if(channel)
+    {
+        if(!crete::ring_empty(g_crete_test_channel.tests()))
+        {
+            crete::ring_pop(g_crete_test_channel.tests());
+        }
+
+        crete::ring_push(g_crete_test_channel.traces(),
+                         runtime_env->getInputTestCase(),
+                         g_crete_test_channel.trace_spill());
+        return;
+    }
+
     fs::ofstream ofs(fs::path("hostfile") / crete_trace_ready_file_name);
 
     if(!ofs.good())
@@ -193,6 +219,54 @@ static inline void crete_tracing_finish()
     }
 }
 
+#if defined(CRETE_SNAPSHOT_RESTORE)
+// Polled from the main loop while the guest waits, paused, for its next test.
+static int crete_test_ready()
+{
+    if(!crete::ring_empty(g_crete_test_channel.tests()))
+        return 1;
+
+    return g_crete_test_channel.is_attached() ? 0 : -1;
+}
+#endif // defined(CRETE_SNAPSHOT_RESTORE)
+
+// CRETE_INSTR_SNAPSHOT_VALUE
+// Snapshot the guest where crete-run waits for its next test. The guest
+// is told whether it is to take its tests off the channel from here on.
+static inline void crete_custom_instr_snapshot()
+{
+    target_ulong addr = g_cpuState_bct->regs[R_EAX];
+#if defined(CRETE_SNAPSHOT_RESTORE)
+    uint8_t ret = crete_test_channel_ready() ? 1 : 0;
+
+    if(crete_snapshot_is_taken())
+    {
+        cerr << "[CRETE ERROR] snapshot requested twice\n";
+        assert(0);
+    }
+#else
+    // Built without CRETE_SNAPSHOT_RESTORE: crete-run falls back to next_test packets.
+    uint8_t ret = 0;
+#endif // defined(CRETE_SNAPSHOT_RESTORE)
+
+    // Before the snapshot is taken, so that it is what the guest finds on every restore.
+    if(RuntimeEnv::access_guest_memory(g_cpuState_bct, addr, &ret, 1, 1) != 0) {
+        cerr << "[CRETE ERROR] access_guest_memory() failed in crete_custom_instr_snapshot()\n";
+        assert(0);
+    }
+
+    if(!ret)
+    {
+        fprintf(stderr, "[CRETE Warning] no test channel, or no snapshot support built in: not taking a snapshot\n");
+        return;
+    }
+
+#if defined(CRETE_SNAPSHOT_RESTORE)
+    g_crete_test_channel.set_snapshot();
+    crete_snapshot_pause(g_cpuState_bct, crete_test_ready);
+#endif // defined(CRETE_SNAPSHOT_RESTORE)
+}
+
 // CRETE_INSTR_DUMP_VALUE
 // Reset flags and structs being used for tracing one concrete run of an executable
 static inline void crete_tracing_reset()
@@ -308,6 +382,16 @@ void crete_custom_instruction_handler(uint64_t arg) {
 	case CRETE_INSTR_DUMP_VALUE:
 	    crete_tracing_finish();
 	    crete_tracing_reset();
+#if defined(CRETE_SNAPSHOT_RESTORE)
+	    // Once a snapshot is taken, the guest goes back to it for the next test,
+	    // rather than carrying on from the end of the one just traced.
+	    if(crete_snapshot_is_taken())
+	        crete_snapshot_pause(g_cpuState_bct, crete_test_ready);
+#endif // defined(CRETE_SNAPSHOT_RESTORE)
+	    break;
+
+	case CRETE_INSTR_SNAPSHOT_VALUE:
+	    crete_custom_instr_snapshot();
 	    break;
 
 	case CRETE_INSTR_EXCLUDE_FILTER_VALUE: // Exclude filter
@@ -14,6 +14,7 @@ extern "C" {
 #include <crete/stacktrace.h>
 
 #include <stdexcept>
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
 
 #include "custom-instructions.h"
@@ -29,6 +30,19 @@ CPUArchState *g_cpuState_bct = 0;
 int f_crete_enabled = 0;
 int f_crete_is_loading_code = 0;
 
+crete::TestChannel g_crete_test_channel;
+
+bool crete_test_channel_ready()
+{
+    // A channel closed by a vm-node that has since been restarted is replaced.
+    if(!g_crete_test_channel.is_attached())
+    {
+        g_crete_test_channel.attach("hostfile");
+    }
+
+    return g_crete_test_channel.is_attached();
+}
+
 // Static globals shared by crete_pre_cpu_tb_exec() and crete_post_cpu_tb_exec()
 // flag to indicate whether the current tb is of interest
 static bool static_flag_interested_tb = 0;
@@ -63,6 +77,29 @@ uint64_t nb_captured_llvm_tb = 0;
 
 #define CPU_OFFSET(field) offsetof(CPUArchState, field)
 
+// A field of CPUArchState captured by CPUState tracing
+struct CPUStateField
+{
+    uint64_t m_offset;
+    uint64_t m_size;
+    string m_name;
+    // false: only preserved in snapshots, not traced by cpuStateSyncTable
+    bool m_traced;
+    // offset within cpuStateSnapshot_ty
+    uint64_t m_snapshot_offset;
+
+    CPUStateField(uint64_t offset, uint64_t size, const string& name, bool traced)
+    :m_offset(offset), m_size(size), m_name(name),
+     m_traced(traced), m_snapshot_offset(0) {}
+};
+
+static void x86_cpuState_snapshot(cpuStateSnapshot_ty& snapshot, const CPUArchState *src);
+static void x86_cpuState_restore(CPUArchState *dst, const cpuStateSnapshot_ty& snapshot);
+static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const cpuStateSnapshot_ty& reference,
+        const cpuStateSnapshot_ty& target);
+static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
+        const CPUArchState *target);
+
 static const uint32_t CRETE_TRACING_WINDOW_SIZE = 10000;
 
 /***********************************/
@@ -74,13 +111,8 @@ RuntimeEnv::RuntimeEnv()
   m_qemu_default_br_skipped(false),
   m_new_tb(false)
 {
-    m_tlo_ctx_cpuState = new uint8_t [sizeof(CPUArchState)];
-
     m_cpuState_post_insterest.first = false;
-    m_cpuState_post_insterest.second = new uint8_t [sizeof(CPUArchState)];
-
     m_cpuState_pre_interest.first = false;
-    m_cpuState_pre_interest.second = new uint8_t [sizeof(CPUArchState)];
 
     m_tcg_llvm_offline_ctx.dump_cpuState_size(sizeof(CPUArchState));
     m_initial_CpuState.reserve(sizeof(CPUArchState));
@@ -90,15 +122,6 @@ RuntimeEnv::RuntimeEnv()
 
 RuntimeEnv::~RuntimeEnv()
 {
-    assert(m_tlo_ctx_cpuState);
-    delete [] (uint8_t *)m_tlo_ctx_cpuState;
-
-    assert(m_cpuState_post_insterest.second);
-    delete [] (uint8_t *)m_cpuState_post_insterest.second;
-
-    assert(m_cpuState_pre_interest.second);
-    delete [] (uint8_t *)m_cpuState_pre_interest.second;
-
     CRETE_DBG_INT(
     assert(m_dbg_cpuState_post_interest);
     delete [] (uint8_t *)m_dbg_cpuState_post_interest;
@@ -126,19 +149,19 @@ void RuntimeEnv::dump_tloCtx(void *cpuState, TranslationBlock *tb, uint64_t cret
     if(nb_captured_llvm_tb == 0)
         dump_tloHelpers(*s);
 
-    // save a copy of original input cpuState
-    memcpy(m_tlo_ctx_cpuState, cpuState, sizeof(CPUArchState));
+    // save a snapshot of original input cpuState
+    x86_cpuState_snapshot(m_tlo_ctx_cpuState, (const CPUArchState *)cpuState);
 
     // Use pre_interest tb for translation
     // Note: must use input cpuState pointer required by ENV_GET_CPU()
     assert(m_cpuState_pre_interest.first);
-    memcpy(cpuState, m_cpuState_pre_interest.second, sizeof(CPUArchState));
+    x86_cpuState_restore((CPUArchState *)cpuState, m_cpuState_pre_interest.second);
 
     tcg_func_start(s);
 	gen_intermediate_code_crete((CPUArchState *)cpuState, tb, crete_interrupted_pc);
 
 	// Restore cpuState
-    memcpy(cpuState, m_tlo_ctx_cpuState, sizeof(CPUArchState));
+    x86_cpuState_restore((CPUArchState *)cpuState, m_tlo_ctx_cpuState);
 
     // the number of instructions within this tb
     uint64_t tb_inst_count = tcg_tb_inst_count(s);
@@ -168,24 +191,19 @@ void RuntimeEnv::addInitialCpuState()
 {
     assert(m_initial_CpuState.empty());
     assert(m_cpuState_pre_interest.first);
+    assert(m_cpuState_pre_initial.size() == sizeof(CPUArchState));
 
-    m_initial_CpuState.resize(sizeof(CPUArchState));
-    memcpy(m_initial_CpuState.data(), m_cpuState_pre_interest.second, sizeof(CPUArchState));
+    m_initial_CpuState.swap(m_cpuState_pre_initial);
 }
 
-static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
-        const CPUArchState *target);
-
 void RuntimeEnv::addcpuStateSyncTable()
 {
     assert(m_cpuState_post_insterest.first == true);
     assert(m_cpuState_pre_interest.first == true);
 
-    const CPUArchState *post_interest = (const CPUArchState *) m_cpuState_post_insterest.second;
-    const CPUArchState *pre_insterest = (const CPUArchState *) m_cpuState_pre_interest.second;
-
     m_cpuStateSyncTables.push_back(make_pair(true,
-            x86_cpuState_compuate_side_effect(post_interest, pre_insterest)));
+            x86_cpuState_compuate_side_effect(m_cpuState_post_insterest.second,
+                    m_cpuState_pre_interest.second)));
 
     // Invalid m_cpuState_post_insterest, after CPUState side-effect is computed
     m_cpuState_post_insterest.first = false;
@@ -436,11 +454,12 @@ void RuntimeEnv::writeRtEnvToFile()
             writeDebugCpuStateOffsets();
         }
 
-        // streamed
-        writeTcgLlvmCtx();
-        writeCPUStateSyncTables();
-        writeDebugCPUStateSyncTables();
-        writeMemoSyncTables();
+        // streamed: the last window is written synchronously, after the
+        // in-flight window (if any) has been flushed
+        m_window_writer.wait();
+        TraceWindow *window = takeTraceWindow();
+        window->write();
+        delete window;
 
         // to-be-streamed
         writeInterruptStates();
@@ -471,10 +490,7 @@ void RuntimeEnv::stream_writeRtEnvToFile(uint64_t tb_count) {
         writeDebugCpuStateOffsets();
     }
 
-    writeTcgLlvmCtx();
-    writeCPUStateSyncTables();
-    writeDebugCPUStateSyncTables();
-    writeMemoSyncTables();
+    m_window_writer.submit(takeTraceWindow());
 
     m_streamed = true;
     m_pending_stream = false;
@@ -482,6 +498,23 @@ void RuntimeEnv::stream_writeRtEnvToFile(uint64_t tb_count) {
     m_streamed_tb_count = tb_count;
 }
 
+// Move the data captured for the current window into a new TraceWindow,
+// leaving RuntimeEnv empty for capturing the next window
+TraceWindow *RuntimeEnv::takeTraceWindow()
+{
+    TraceWindow *window = new TraceWindow;
+
+    window->m_streamed_index = m_streamed_index;
+    window->m_outputDirectory = m_outputDirectory;
+
+    window->m_tcg_llvm_offline_ctx.swap(m_tcg_llvm_offline_ctx);
+    window->m_cpuStateSyncTables.swap(m_cpuStateSyncTables);
+    window->m_debug_cpuStateSyncTables.swap(m_debug_cpuStateSyncTables);
+    window->m_memoSyncTables.swap(m_memoSyncTables);
+
+    return window;
+}
+
 void RuntimeEnv::set_pending_stream()
 {
     m_pending_stream = true;
@@ -711,19 +744,35 @@ void RuntimeEnv::init_concolics()
 {
     using namespace crete;
 
-    assert(boost::filesystem::exists("hostfile/input_arguments.bin"));
-    ifstream inputs("hostfile/input_arguments.bin", ios_base::in | ios_base::binary);
+    TestCase tc;
 
-    assert(inputs && "failed to open input_arguments.bin!");
+    if(crete_test_channel_ready())
+    {
+        // Taken off the channel once its trace is written, in crete_tracing_finish()
+        if(ring_empty(g_crete_test_channel.tests())){
+            fprintf(stderr, "[CRETE WARNING] RuntimeEnv::init_concolics(): no test case from the test channel\n");
+            return;
+        }
 
-    if(empty_test_case(inputs)){
-        fprintf(stderr, "[CRETE WARNING] RuntimeEnv::init_concolics(): empty test case from hostfile/input_arguments.bin\n");
-        return;
+        tc = ring_front(g_crete_test_channel.tests(), g_crete_test_channel.test_spill());
+    }
+    else
+    {
+        assert(boost::filesystem::exists("hostfile/input_arguments.bin"));
+        ifstream inputs("hostfile/input_arguments.bin", ios_base::in | ios_base::binary);
+
+        assert(inputs && "failed to open input_arguments.bin!");
+
+        if(empty_test_case(inputs)){
+            fprintf(stderr, "[CRETE WARNING] RuntimeEnv::init_concolics(): empty test case from hostfile/input_arguments.bin\n");
+            return;
+        }
+
+        inputs.clear();
+        inputs.seekg(0, ios::beg);
+        tc = read_serialized(inputs);
     }
 
-    inputs.clear();
-    inputs.seekg(0, ios::beg);
-    const TestCase& tc = read_serialized(inputs);
     tc.assert_issued_tc();
 
     m_input_tc = tc;
@@ -778,24 +827,6 @@ void RuntimeEnv::dump_tloTbInstCount(const uint64_t inst_count)
 	m_tcg_llvm_offline_ctx.dump_tlo_tb_inst_count(inst_count);
 }
 
-void RuntimeEnv::writeTcgLlvmCtx()
-{
-    stringstream ss;
-    ss << "dump_tcg_llvm_offline." << m_streamed_index << ".bin";
-    ofstream ofs(getOutputFilename(ss.str()).c_str(), ios_base::binary);
-
-    assert(ofs.good());
-	try {
-        boost::archive::binary_oarchive oa(ofs);
-	    oa << m_tcg_llvm_offline_ctx;
-	}
-	catch(std::exception &e){
-	    cerr << e.what() << endl;
-	}
-
-    m_tcg_llvm_offline_ctx = TCGLLVMOfflineContext();
-}
-
 string RuntimeEnv::getOutputFilename(const string &fileName) const
 {
     fs::path filePath(m_outputDirectory);
@@ -854,16 +885,24 @@ void RuntimeEnv::writeConcolics()
     m_input_tc.set_elements(tc_elems);
 
     // Update "hostfile/input_arguments.bin" as there are more concolics than specified in xml
-    ofstream ofs("hostfile/input_arguments.bin", ios_base::out | ios_base::binary);
-    assert(ofs);
-    crete::write_serialized(ofs, m_input_tc);
+    // (With the test channel, m_input_tc goes back along with the trace instead)
+    if(!crete_test_channel_ready())
+    {
+        ofstream ofs("hostfile/input_arguments.bin", ios_base::out | ios_base::binary);
+        assert(ofs);
+        crete::write_serialized(ofs, m_input_tc);
+    }
+}
+
+const crete::TestCase& RuntimeEnv::getInputTestCase() const
+{
+    return m_input_tc;
 }
 
 void RuntimeEnv::setCPUStatePostInterest(const void *src)
 {
     assert(src);
-    memcpy(m_cpuState_post_insterest.second, src,
-            sizeof(CPUArchState));
+    x86_cpuState_snapshot(m_cpuState_post_insterest.second, (const CPUArchState *)src);
 }
 
 void RuntimeEnv::setFlagCPUStatePostInterest()
@@ -877,9 +916,15 @@ void RuntimeEnv::setFlagCPUStatePostInterest()
 void RuntimeEnv::setCPUStatePreInterest(const void *src)
 {
     assert(src);
-    memcpy(m_cpuState_pre_interest.second, src,
-            sizeof(CPUArchState));
+    x86_cpuState_snapshot(m_cpuState_pre_interest.second, (const CPUArchState *)src);
     m_cpuState_pre_interest.first = true;
+
+    // Full copy is only needed for the initial CPUState
+    if(rt_dump_tb_count == 0)
+    {
+        m_cpuState_pre_initial.resize(sizeof(CPUArchState));
+        memcpy(m_cpuState_pre_initial.data(), src, sizeof(CPUArchState));
+    }
 }
 
 void RuntimeEnv::resetCPUStatePreInterest()
@@ -887,46 +932,6 @@ void RuntimeEnv::resetCPUStatePreInterest()
     m_cpuState_pre_interest.first = false;
 }
 
-void RuntimeEnv::writeMemoSyncTables()
-{
-    stringstream ss;
-    ss << "dump_new_sync_memos." << m_streamed_index << ".bin";
-    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
-
-    assert(o_sm.good());
-
-    // boost::unordered_map is not supported by boost::serialization
-    // Covert boost::unordered_map to vector< pair<> >
-    vector<vector<pair<uint64_t, uint8_t> > > to_serialize;
-    to_serialize.reserve(m_memoSyncTables.size());
-
-    for(memoSyncTables_ty::const_iterator it = m_memoSyncTables.begin();
-            it != m_memoSyncTables.end(); ++it) {
-        vector<pair<uint64_t, uint8_t> > temp_memSyncTable;
-        temp_memSyncTable.reserve(it->size());
-
-        for(memoSyncTable_ty::const_iterator in_it = it->begin();
-                in_it != it->end(); ++in_it) {
-            temp_memSyncTable.push_back(*in_it);
-        }
-
-        assert(temp_memSyncTable.size() == it->size());
-        to_serialize.push_back(temp_memSyncTable);
-    }
-
-    assert(to_serialize.size() == m_memoSyncTables.size());
-
-    try {
-        boost::archive::binary_oarchive oa(o_sm);
-        oa << to_serialize;
-    }
-    catch(std::exception &e){
-        cerr << e.what() << endl;
-    }
-
-    m_memoSyncTables.clear();
-}
-
 #if defined(CRETE_DBG_MEM_MONI)
 // merge a sequence of consecutive non-BackToInterestTb TB's memoSyncTables
 //  to the nearest BackToInterestTb TB's memoSyncTable and make them empty
@@ -1225,64 +1230,6 @@ void RuntimeEnv::writeDebugCpuStateOffsets()
 }
 
 
-void RuntimeEnv::checkEmptyCPUStateSyncTables()
-{
-    uint64_t tb_count = 0;
-    for(vector<cpuStateSyncTable_ty>::iterator it = m_cpuStateSyncTables.begin();
-            it != m_cpuStateSyncTables.end(); ++it) {
-        if(it->first && it->second.empty()) {
-            it->first = false;
-
-            CRETE_DBG_GEN(
-            fprintf(stderr, "CPUState is not changed between tb-%lu, and tb-%lu\n",
-                    tb_count - 1, tb_count);
-            );
-        }
-
-        ++tb_count;
-    }
-}
-
-void RuntimeEnv::writeCPUStateSyncTables()
-{
-    checkEmptyCPUStateSyncTables();
-
-    stringstream ss;
-    ss << "dump_sync_cpu_states." << m_streamed_index << ".bin";
-    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
-
-    assert(o_sm.good() && "Create file failed: dump_sync_cpu_states.bin\n");
-
-    try {
-        boost::archive::binary_oarchive oa(o_sm);
-        oa << m_cpuStateSyncTables;
-    }
-    catch(std::exception &e){
-        cerr << e.what() << endl;
-    }
-
-    m_cpuStateSyncTables.clear();
-}
-
-void RuntimeEnv::writeDebugCPUStateSyncTables()
-{
-    stringstream ss;
-    ss << "dump_debug_sync_cpu_states." << m_streamed_index << ".bin";
-    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
-
-    assert(o_sm && "Create file failed: dump_debug_sync_cpu_states.bin\n");
-
-    try {
-        boost::archive::binary_oarchive oa(o_sm);
-        oa << m_debug_cpuStateSyncTables;
-    }
-    catch(std::exception &e){
-        cerr << e.what() << endl;
-    }
-
-    m_debug_cpuStateSyncTables.clear();
-}
-
 // Check whether the given entry (addr, size) overlaps with existing entries in target_memoSyncTable
 // Return the the address of all the overlapped entries
 vector<uint64_t> RuntimeEnv::overlapsMemoSyncEntry(uint64_t addr, uint32_t size,
@@ -1669,6 +1616,215 @@ void RuntimeEnv::handleCreteVoidTargetPid()
     crete_analyzer_void_target_pid(KERNEL_CODE_START_ADDR);
 }
 
+/*****************************/
+/* Streamed trace windows    */
+
+void TraceWindow::write()
+{
+    writeTcgLlvmCtx();
+    writeCPUStateSyncTables();
+    writeDebugCPUStateSyncTables();
+    writeMemoSyncTables();
+}
+
+string TraceWindow::getOutputFilename(const string &fileName) const
+{
+    fs::path filePath(m_outputDirectory);
+    filePath /= fileName;
+    return filePath.string();
+}
+
+void TraceWindow::writeTcgLlvmCtx()
+{
+    stringstream ss;
+    ss << "dump_tcg_llvm_offline." << m_streamed_index << ".bin";
+    ofstream ofs(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+
+    assert(ofs.good());
+	try {
+        boost::archive::binary_oarchive oa(ofs);
+	    oa << m_tcg_llvm_offline_ctx;
+	}
+	catch(std::exception &e){
+	    cerr << e.what() << endl;
+	}
+}
+
+void TraceWindow::checkEmptyCPUStateSyncTables()
+{
+    uint64_t tb_count = 0;
+    for(vector<cpuStateSyncTable_ty>::iterator it = m_cpuStateSyncTables.begin();
+            it != m_cpuStateSyncTables.end(); ++it) {
+        if(it->first && it->second.empty()) {
+            it->first = false;
+
+            CRETE_DBG_GEN(
+            fprintf(stderr, "CPUState is not changed between tb-%lu, and tb-%lu\n",
+                    tb_count - 1, tb_count);
+            );
+        }
+
+        ++tb_count;
+    }
+}
+
+void TraceWindow::writeCPUStateSyncTables()
+{
+    checkEmptyCPUStateSyncTables();
+
+    stringstream ss;
+    ss << "dump_sync_cpu_states." << m_streamed_index << ".bin";
+    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+
+    assert(o_sm.good() && "Create file failed: dump_sync_cpu_states.bin\n");
+
+    try {
+        boost::archive::binary_oarchive oa(o_sm);
+        oa << m_cpuStateSyncTables;
+    }
+    catch(std::exception &e){
+        cerr << e.what() << endl;
+    }
+
+    m_cpuStateSyncTables.clear();
+}
+
+void TraceWindow::writeDebugCPUStateSyncTables()
+{
+    stringstream ss;
+    ss << "dump_debug_sync_cpu_states." << m_streamed_index << ".bin";
+    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+
+    assert(o_sm && "Create file failed: dump_debug_sync_cpu_states.bin\n");
+
+    try {
+        boost::archive::binary_oarchive oa(o_sm);
+        oa << m_debug_cpuStateSyncTables;
+    }
+    catch(std::exception &e){
+        cerr << e.what() << endl;
+    }
+
+    m_debug_cpuStateSyncTables.clear();
+}
+
+void TraceWindow::writeMemoSyncTables()
+{
+    stringstream ss;
+    ss << "dump_new_sync_memos." << m_streamed_index << ".bin";
+    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+
+    assert(o_sm.good());
+
+    // boost::unordered_map is not supported by boost::serialization
+    // Covert boost::unordered_map to ranges of contiguous bytes
+    vector<memoSyncRanges_ty> to_serialize;
+    to_serialize.reserve(m_memoSyncTables.size());
+
+    for(memoSyncTables_ty::const_iterator it = m_memoSyncTables.begin();
+            it != m_memoSyncTables.end(); ++it) {
+        to_serialize.push_back(coalesceMemoSyncTable(*it));
+    }
+
+    assert(to_serialize.size() == m_memoSyncTables.size());
+
+    try {
+        boost::archive::binary_oarchive oa(o_sm);
+        oa << to_serialize;
+    }
+    catch(std::exception &e){
+        cerr << e.what() << endl;
+    }
+
+    m_memoSyncTables.clear();
+}
+
+memoSyncRanges_ty TraceWindow::coalesceMemoSyncTable(const memoSyncTable_ty& memoSyncTable)
+{
+    vector<pair<uint64_t, uint8_t> > sorted(memoSyncTable.begin(), memoSyncTable.end());
+    sort(sorted.begin(), sorted.end());
+
+    memoSyncRanges_ty ranges;
+    for(vector<pair<uint64_t, uint8_t> >::const_iterator it = sorted.begin();
+            it != sorted.end(); ++it) {
+        if(ranges.empty() ||
+                ranges.back().first + ranges.back().second.size() != it->first) {
+            ranges.push_back(memoSyncRange_ty(it->first, vector<uint8_t>()));
+        }
+
+        ranges.back().second.push_back(it->second);
+    }
+
+    return ranges;
+}
+
+TraceWindowWriter::TraceWindowWriter()
+: m_pending(NULL), m_stop(false),
+  m_thread(&TraceWindowWriter::run, this) {}
+
+TraceWindowWriter::~TraceWindowWriter()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    m_thread.join();
+    assert(!m_pending);
+}
+
+void TraceWindowWriter::submit(TraceWindow *window)
+{
+    assert(window);
+
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_pending)
+        m_cond.wait(lock);
+
+    m_pending = window;
+    m_cond.notify_all();
+}
+
+void TraceWindowWriter::wait()
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_pending)
+        m_cond.wait(lock);
+}
+
+void TraceWindowWriter::run()
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+
+    for(;;)
+    {
+        while(!m_pending && !m_stop)
+            m_cond.wait(lock);
+
+        // Drain the pending window before stopping
+        if(!m_pending)
+            break;
+
+        TraceWindow *window = m_pending;
+
+        lock.unlock();
+        try
+        {
+            window->write();
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "[CRETE Exception] " << e.what() << std::endl;
+        }
+        delete window;
+        lock.lock();
+
+        m_pending = NULL;
+        m_cond.notify_all();
+    }
+}
+
 CreteFlags::CreteFlags()
 : m_cpuState(NULL), m_tb(NULL),
   m_target_pid(0), m_capture_started(false),
@@ -2290,45 +2446,25 @@ int crete_flags_is_true(struct CreteFlags *cf)
 	return cf->is_true();
 }
 
-#define __CRETE_CALC_CPU_SIDE_EFFECT(in_type, in_name)                              \
-        if(memcmp(&reference->in_name, &target->in_name, sizeof(in_type)) != 0)     \
-        {                                                                           \
-            offset = CPU_OFFSET(in_name);                                           \
-            size   = sizeof(in_type);                                               \
-            name.str(string());                                                     \
-            name << #in_name;                                                       \
-            data.clear();                                                           \
-                                                                                    \
-            for(uint64_t j=0; j < size; ++j) {                                      \
-                data.push_back(*(uint8_t *)(((uint8_t *)target)                     \
-                        + offset + j));                                             \
-            }                                                                       \
-                                                                                    \
-            ret.push_back(CPUStateElement(offset, size, name.str(), data));         \
-        }
+#define __CRETE_CPU_FIELD(in_type, in_name)                                         \
+        fields.push_back(CPUStateField(CPU_OFFSET(in_name), sizeof(in_type),        \
+                #in_name, true));
 
-
-#define __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(in_type, in_name, array_size)            \
+#define __CRETE_CPU_FIELD_ARRAY(in_type, in_name, array_size)                       \
         for(uint64_t i = 0; i < (array_size); ++i)                                  \
         {                                                                           \
-            if(memcmp(&reference->in_name[i], &target->in_name[i],                  \
-                    sizeof(in_type)) != 0)                                          \
-            {                                                                       \
-                offset = CPU_OFFSET(in_name) + i*sizeof(in_type);                   \
-                size   = sizeof(in_type);                                           \
-                name.str(string());                                                 \
-                name << #in_name << "[" << dec << i << "]";                         \
-                data.clear();                                                       \
-                                                                                    \
-                for(uint64_t j=0; j < size; ++j) {                                  \
-                    data.push_back(*(uint8_t *)(((uint8_t *)target)                 \
-                            + offset + j));                                         \
-                }                                                                   \
-                                                                                    \
-                ret.push_back(CPUStateElement(offset, size, name.str(), data));     \
-            }                                                                       \
+            name.str(string());                                                     \
+            name << #in_name << "[" << dec << i << "]";                             \
+            fields.push_back(CPUStateField(CPU_OFFSET(in_name) + i*sizeof(in_type), \
+                    sizeof(in_type), name.str(), true));                            \
         }
 
+// Fields not traced by cpuStateSyncTable, but preserved in snapshots
+// for the offline translation in dump_tloCtx()
+#define __CRETE_CPU_FIELD_UNTRACED(in_type, in_name)                                \
+        fields.push_back(CPUStateField(CPU_OFFSET(in_name), sizeof(in_type),        \
+                #in_name, false));
+
 // List of CPUState being ignored by cpuStateSyncTable
 //  Element:                            Reason
 // +--------------------------------+----------------------------+
@@ -2340,213 +2476,210 @@ int crete_flags_is_true(struct CreteFlags *cf)
 // int old_exception;                 Irrelevant + cannot trace
 // CPU_COMMON and all below           Irrelevant
 
-// Compare two cpu states, return the different elements of target cpu state
-static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
-        const CPUArchState *target) {
-    vector<CPUStateElement> ret;
-    ret.clear();
+// The fields of CPUArchState captured by CPUState tracing, in the order of
+// cpuStateSyncTable entries
+static vector<CPUStateField> init_x86_cpuState_fields() {
+    vector<CPUStateField> fields;
 
-    uint64_t offset;
-    uint64_t size;
     stringstream name;
-    vector<uint8_t> data;
 
     /* standard registers */
     // target_ulong regs[CPU_NB_REGS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, regs, CPU_NB_REGS)
+    __CRETE_CPU_FIELD_ARRAY(target_ulong, regs, CPU_NB_REGS)
 
 //xxx: not traced
 // target_ulong eip;
+    __CRETE_CPU_FIELD_UNTRACED(target_ulong, eip)
 
    // target_ulong eflags;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, eflags)
+    __CRETE_CPU_FIELD(target_ulong, eflags)
 
     /* emulator internal eflags handling */
     // target_ulong cc_dst;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_dst)
+    __CRETE_CPU_FIELD(target_ulong, cc_dst)
     // target_ulong cc_src;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_src)
+    __CRETE_CPU_FIELD(target_ulong, cc_src)
     // target_ulong cc_src2;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_src2)
+    __CRETE_CPU_FIELD(target_ulong, cc_src2)
     //uint32_t cc_op;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, cc_op);
+    __CRETE_CPU_FIELD(uint32_t, cc_op);
 
     // int32_t df;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int32_t, df)
+    __CRETE_CPU_FIELD(int32_t, df)
     // uint32_t hflags;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, hflags)
+    __CRETE_CPU_FIELD(uint32_t, hflags)
     // uint32_t hflags2;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, hflags2)
+    __CRETE_CPU_FIELD(uint32_t, hflags2)
 
     /* segments */
     // SegmentCache segs[6];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(SegmentCache, segs, 6)
+    __CRETE_CPU_FIELD_ARRAY(SegmentCache, segs, 6)
     // SegmentCache ldt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, ldt)
+    __CRETE_CPU_FIELD(SegmentCache, ldt)
     // SegmentCache tr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, tr)
+    __CRETE_CPU_FIELD(SegmentCache, tr)
     // SegmentCache gdt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, gdt)
+    __CRETE_CPU_FIELD(SegmentCache, gdt)
     // SegmentCache idt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, idt)
+    __CRETE_CPU_FIELD(SegmentCache, idt)
 
 // xxx: not traced
 // target_ulong cr[5];
-//    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, cr, 5)
+    __CRETE_CPU_FIELD_UNTRACED(target_ulong[5], cr)
 
     // int32_t a20_mask;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int32_t, a20_mask)
+    __CRETE_CPU_FIELD(int32_t, a20_mask)
 
     // BNDReg bnd_regs[4];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(BNDReg, bnd_regs, 4)
+    __CRETE_CPU_FIELD_ARRAY(BNDReg, bnd_regs, 4)
     // BNDCSReg bndcs_regs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(BNDCSReg, bndcs_regs)
+    __CRETE_CPU_FIELD(BNDCSReg, bndcs_regs)
     // uint64_t msr_bndcfgs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_bndcfgs)
+    __CRETE_CPU_FIELD(uint64_t, msr_bndcfgs)
 
     /* Beginning of state preserved by INIT (dummy marker).  */
 //xxx: not traced
 //    struct {} start_init_save;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(struct {}, start_init_save)
+//    __CRETE_CPU_FIELD(struct {}, start_init_save)
 
     /* FPU state */
     // unsigned int fpstt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(unsigned int, fpstt)
+    __CRETE_CPU_FIELD(unsigned int, fpstt)
     // uint16_t fpus;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpus)
+    __CRETE_CPU_FIELD(uint16_t, fpus)
     // uint16_t fpuc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpuc)
+    __CRETE_CPU_FIELD(uint16_t, fpuc)
     // uint8_t fptags[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint8_t, fptags, 8)
+    __CRETE_CPU_FIELD_ARRAY(uint8_t, fptags, 8)
     // FPReg fpregs[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(FPReg, fpregs, 8)
+    __CRETE_CPU_FIELD_ARRAY(FPReg, fpregs, 8)
     /* KVM-only so far */
     // uint16_t fpop;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpop)
+    __CRETE_CPU_FIELD(uint16_t, fpop)
     // uint64_t fpip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, fpip)
+    __CRETE_CPU_FIELD(uint64_t, fpip)
     // uint64_t fpdp;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, fpdp)
+    __CRETE_CPU_FIELD(uint64_t, fpdp)
 
     /* emulator internal variables */
     // float_status fp_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, fp_status)
+    __CRETE_CPU_FIELD(float_status, fp_status)
     // floatx80 ft0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(floatx80, ft0)
+    __CRETE_CPU_FIELD(floatx80, ft0)
 
     // float_status mmx_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, mmx_status)
+    __CRETE_CPU_FIELD(float_status, mmx_status)
     // float_status sse_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, sse_status)
+    __CRETE_CPU_FIELD(float_status, sse_status)
     // uint32_t mxcsr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, mxcsr)
+    __CRETE_CPU_FIELD(uint32_t, mxcsr)
     // XMMReg xmm_regs[CPU_NB_REGS == 8 ? 8 : 32];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(XMMReg, xmm_regs, CPU_NB_REGS == 8 ? 8 : 32)
+    __CRETE_CPU_FIELD_ARRAY(XMMReg, xmm_regs, CPU_NB_REGS == 8 ? 8 : 32)
     // XMMReg xmm_t0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(XMMReg, xmm_t0)
+    __CRETE_CPU_FIELD(XMMReg, xmm_t0)
     // MMXReg mmx_t0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(MMXReg, mmx_t0)
+    __CRETE_CPU_FIELD(MMXReg, mmx_t0)
 
     // uint64_t opmask_regs[NB_OPMASK_REGS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, opmask_regs, NB_OPMASK_REGS)
+    __CRETE_CPU_FIELD_ARRAY(uint64_t, opmask_regs, NB_OPMASK_REGS)
 
     /* sysenter registers */
     // uint32_t sysenter_cs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, sysenter_cs)
+    __CRETE_CPU_FIELD(uint32_t, sysenter_cs)
     // target_ulong sysenter_esp;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, sysenter_esp)
+    __CRETE_CPU_FIELD(target_ulong, sysenter_esp)
     // target_ulong sysenter_eip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, sysenter_eip)
+    __CRETE_CPU_FIELD(target_ulong, sysenter_eip)
     // uint64_t efer;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, efer)
+    __CRETE_CPU_FIELD(uint64_t, efer)
     // uint64_t star;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, star)
+    __CRETE_CPU_FIELD(uint64_t, star)
 
     // uint64_t vm_hsave;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, vm_hsave)
+    __CRETE_CPU_FIELD(uint64_t, vm_hsave)
 
 #ifdef TARGET_X86_64
     // target_ulong lstar;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, lstar)
+    __CRETE_CPU_FIELD(target_ulong, lstar)
     // target_ulong cstar;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cstar)
+    __CRETE_CPU_FIELD(target_ulong, cstar)
     // target_ulong fmask;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, fmask)
+    __CRETE_CPU_FIELD(target_ulong, fmask)
     // target_ulong kernelgsbase;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, kernelgsbase)
+    __CRETE_CPU_FIELD(target_ulong, kernelgsbase)
 #endif
 
     // uint64_t tsc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc)
+    __CRETE_CPU_FIELD(uint64_t, tsc)
     // uint64_t tsc_adjust;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_adjust)
+    __CRETE_CPU_FIELD(uint64_t, tsc_adjust)
     // uint64_t tsc_deadline;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_deadline)
+    __CRETE_CPU_FIELD(uint64_t, tsc_deadline)
 
     // uint64_t mcg_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, mcg_status)
+    __CRETE_CPU_FIELD(uint64_t, mcg_status)
     // uint64_t msr_ia32_misc_enable;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_ia32_misc_enable)
+    __CRETE_CPU_FIELD(uint64_t, msr_ia32_misc_enable)
     // uint64_t msr_ia32_feature_control;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_ia32_feature_control)
+    __CRETE_CPU_FIELD(uint64_t, msr_ia32_feature_control)
 
     // uint64_t msr_fixed_ctr_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_fixed_ctr_ctrl)
+    __CRETE_CPU_FIELD(uint64_t, msr_fixed_ctr_ctrl)
     // uint64_t msr_global_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_ctrl)
+    __CRETE_CPU_FIELD(uint64_t, msr_global_ctrl)
     // uint64_t msr_global_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_status)
+    __CRETE_CPU_FIELD(uint64_t, msr_global_status)
     // uint64_t msr_global_ovf_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_ovf_ctrl)
+    __CRETE_CPU_FIELD(uint64_t, msr_global_ovf_ctrl)
     // uint64_t msr_fixed_counters[MAX_FIXED_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_fixed_counters, MAX_FIXED_COUNTERS)
+    __CRETE_CPU_FIELD_ARRAY(uint64_t, msr_fixed_counters, MAX_FIXED_COUNTERS)
     // uint64_t msr_gp_counters[MAX_GP_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_gp_counters, MAX_GP_COUNTERS)
+    __CRETE_CPU_FIELD_ARRAY(uint64_t, msr_gp_counters, MAX_GP_COUNTERS)
     // uint64_t msr_gp_evtsel[MAX_GP_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_gp_evtsel, MAX_GP_COUNTERS)
+    __CRETE_CPU_FIELD_ARRAY(uint64_t, msr_gp_evtsel, MAX_GP_COUNTERS)
 
     // uint64_t pat;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, pat)
+    __CRETE_CPU_FIELD(uint64_t, pat)
     // uint32_t smbase;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, smbase)
+    __CRETE_CPU_FIELD(uint32_t, smbase)
 
     /* End of state preserved by INIT (dummy marker).  */
 // xxx: not traced
 //    struct {} end_init_save;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(struct {}, end_init_save)
+//    __CRETE_CPU_FIELD(struct {}, end_init_save)
 
     // uint64_t system_time_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, system_time_msr)
+    __CRETE_CPU_FIELD(uint64_t, system_time_msr)
     // uint64_t wall_clock_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, wall_clock_msr)
+    __CRETE_CPU_FIELD(uint64_t, wall_clock_msr)
     // uint64_t steal_time_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, steal_time_msr)
+    __CRETE_CPU_FIELD(uint64_t, steal_time_msr)
     // uint64_t async_pf_en_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, async_pf_en_msr)
+    __CRETE_CPU_FIELD(uint64_t, async_pf_en_msr)
     // uint64_t pv_eoi_en_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, pv_eoi_en_msr)
+    __CRETE_CPU_FIELD(uint64_t, pv_eoi_en_msr)
 
     // uint64_t msr_hv_hypercall;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_hypercall)
+    __CRETE_CPU_FIELD(uint64_t, msr_hv_hypercall)
     // uint64_t msr_hv_guest_os_id;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_guest_os_id)
+    __CRETE_CPU_FIELD(uint64_t, msr_hv_guest_os_id)
     // uint64_t msr_hv_vapic;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_vapic)
+    __CRETE_CPU_FIELD(uint64_t, msr_hv_vapic)
     // uint64_t msr_hv_tsc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_tsc)
+    __CRETE_CPU_FIELD(uint64_t, msr_hv_tsc)
 
     /* exception/interrupt handling */
 
 // xxx: not traced
 // int error_code;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(int, error_code)
+//    __CRETE_CPU_FIELD(int, error_code)
 
     // int exception_is_int;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int, exception_is_int)
+    __CRETE_CPU_FIELD(int, exception_is_int)
     // target_ulong exception_next_eip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, exception_next_eip)
+    __CRETE_CPU_FIELD(target_ulong, exception_next_eip)
     // target_ulong dr[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, dr, 8)
+    __CRETE_CPU_FIELD_ARRAY(target_ulong, dr, 8)
 
 //xxx: not traced
 //    union {
@@ -2555,31 +2688,31 @@ static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchSt
 //    };
 
     // int old_exception;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int, old_exception)
+    __CRETE_CPU_FIELD(int, old_exception)
     // uint64_t vm_vmcb;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, vm_vmcb)
+    __CRETE_CPU_FIELD(uint64_t, vm_vmcb)
     // uint64_t tsc_offset;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_offset)
+    __CRETE_CPU_FIELD(uint64_t, tsc_offset)
     // uint64_t intercept;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, intercept)
+    __CRETE_CPU_FIELD(uint64_t, intercept)
     // uint16_t intercept_cr_read;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_cr_read)
+    __CRETE_CPU_FIELD(uint16_t, intercept_cr_read)
     // uint16_t intercept_cr_write;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_cr_write)
+    __CRETE_CPU_FIELD(uint16_t, intercept_cr_write)
     // uint16_t intercept_dr_read;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_dr_read)
+    __CRETE_CPU_FIELD(uint16_t, intercept_dr_read)
     // uint16_t intercept_dr_write;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_dr_write)
+    __CRETE_CPU_FIELD(uint16_t, intercept_dr_write)
     // uint32_t intercept_exceptions;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, intercept_exceptions)
+    __CRETE_CPU_FIELD(uint32_t, intercept_exceptions)
     // uint8_t v_tpr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, v_tpr)
+    __CRETE_CPU_FIELD(uint8_t, v_tpr)
 
     /* KVM states, automatically cleared on reset */
     // uint8_t nmi_injected;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, nmi_injected)
+    __CRETE_CPU_FIELD(uint8_t, nmi_injected)
     // uint8_t nmi_pending;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, nmi_pending)
+    __CRETE_CPU_FIELD(uint8_t, nmi_pending)
 
 // TODO: xxx not traced
 //    CPU_COMMON
@@ -2627,9 +2760,124 @@ static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchSt
     TPRAccess tpr_access_type;
 */
 
+    return fields;
+}
+
+// Contiguous ranges of CPUArchState covering all the fields, so that taking
+// a snapshot is a handful of memcpy() instead of one per field
+struct CPUStateSnapshotLayout
+{
+    vector<CPUStateField> m_fields;
+    // <offset in CPUArchState, size>
+    vector<pair<uint64_t, uint64_t> > m_ranges;
+    uint64_t m_size;
+
+    CPUStateSnapshotLayout()
+    : m_fields(init_x86_cpuState_fields()), m_size(0)
+    {
+        // <offset in CPUArchState, index in m_fields>
+        vector<pair<uint64_t, uint64_t> > sorted;
+        for(uint64_t i = 0; i < m_fields.size(); ++i)
+            sorted.push_back(make_pair(m_fields[i].m_offset, i));
+        sort(sorted.begin(), sorted.end());
+
+        for(vector<pair<uint64_t, uint64_t> >::const_iterator it = sorted.begin();
+                it != sorted.end(); ++it) {
+            CPUStateField& field = m_fields[it->second];
+
+            if(m_ranges.empty() ||
+                    (m_ranges.back().first + m_ranges.back().second) < field.m_offset) {
+                m_ranges.push_back(make_pair(field.m_offset, field.m_size));
+                m_size += field.m_size;
+            } else {
+                uint64_t range_end = m_ranges.back().first + m_ranges.back().second;
+                uint64_t field_end = field.m_offset + field.m_size;
+                if(field_end > range_end) {
+                    m_ranges.back().second += field_end - range_end;
+                    m_size += field_end - range_end;
+                }
+            }
+
+            uint64_t range_snapshot_offset = m_size - m_ranges.back().second;
+            field.m_snapshot_offset = range_snapshot_offset +
+                    (field.m_offset - m_ranges.back().first);
+        }
+
+        assert(m_size <= sizeof(CPUArchState));
+    }
+};
+
+static const CPUStateSnapshotLayout& x86_cpuState_snapshot_layout()
+{
+    static const CPUStateSnapshotLayout layout;
+    return layout;
+}
+
+static void x86_cpuState_snapshot(cpuStateSnapshot_ty& snapshot, const CPUArchState *src)
+{
+    const CPUStateSnapshotLayout& layout = x86_cpuState_snapshot_layout();
+    snapshot.resize(layout.m_size);
+
+    uint8_t *dst = snapshot.data();
+    for(vector<pair<uint64_t, uint64_t> >::const_iterator it = layout.m_ranges.begin();
+            it != layout.m_ranges.end(); ++it) {
+        memcpy(dst, (const uint8_t *)src + it->first, it->second);
+        dst += it->second;
+    }
+}
+
+static void x86_cpuState_restore(CPUArchState *dst, const cpuStateSnapshot_ty& snapshot)
+{
+    const CPUStateSnapshotLayout& layout = x86_cpuState_snapshot_layout();
+    assert(snapshot.size() == layout.m_size);
+
+    const uint8_t *src = snapshot.data();
+    for(vector<pair<uint64_t, uint64_t> >::const_iterator it = layout.m_ranges.begin();
+            it != layout.m_ranges.end(); ++it) {
+        memcpy((uint8_t *)dst + it->first, src, it->second);
+        src += it->second;
+    }
+}
+
+// Compare two cpu states, return the different elements of target cpu state
+static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const uint8_t *reference,
+        const uint8_t *target, bool is_snapshot)
+{
+    vector<CPUStateElement> ret;
+
+    const vector<CPUStateField>& fields = x86_cpuState_snapshot_layout().m_fields;
+    for(vector<CPUStateField>::const_iterator it = fields.begin();
+            it != fields.end(); ++it) {
+        if(!it->m_traced)
+            continue;
+
+        uint64_t offset = is_snapshot ? it->m_snapshot_offset : it->m_offset;
+        if(memcmp(reference + offset, target + offset, it->m_size) != 0)
+        {
+            ret.push_back(CPUStateElement(it->m_offset, it->m_size, it->m_name,
+                    vector<uint8_t>(target + offset, target + offset + it->m_size)));
+        }
+    }
+
     return ret;
 }
 
+static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const cpuStateSnapshot_ty& reference,
+        const cpuStateSnapshot_ty& target)
+{
+    assert(reference.size() == x86_cpuState_snapshot_layout().m_size);
+    assert(target.size() == x86_cpuState_snapshot_layout().m_size);
+
+    return x86_cpuState_compuate_side_effect(reference.data(), target.data(), true);
+}
+
+static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
+        const CPUArchState *target)
+{
+    return x86_cpuState_compuate_side_effect((const uint8_t *)reference,
+            (const uint8_t *)target, false);
+}
+
 void clear_current_tb_br_taken()
 {
     runtime_env->clear_current_tb_br_taken();
@@ -90,6 +90,9 @@ int  crete_flags_is_true(struct CreteFlags *cf);
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 /***********************************/
 /* External interface for C++ code */
@@ -98,9 +101,15 @@ int  crete_flags_is_true(struct CreteFlags *cf);
 #include <crete/trace_tag.h>
 #include <crete/guest_data_post_exec.hpp>
 #include <crete/test_case.h>
+#include <crete/test_channel.h>
 
 using namespace std;
 
+// Shared memory to the vm-node, attached on first use. Without it, tests and traces
+// are exchanged through files under hostfile/.
+extern crete::TestChannel g_crete_test_channel;
+bool crete_test_channel_ready();
+
 enum MemoMergePoint_ty{
     NormalTb = 0,
     BackToInterestTb = 1,
@@ -194,6 +203,11 @@ struct QemuInterruptInfo {
 typedef boost::unordered_map<uint64_t, uint8_t> memoSyncTable_ty;
 typedef vector<memoSyncTable_ty> memoSyncTables_ty;
 
+// On-disk format of memoSyncTable_ty, with contiguous bytes coalesced:
+// <start address, values>
+typedef pair<uint64_t, vector<uint8_t> > memoSyncRange_ty;
+typedef vector<memoSyncRange_ty> memoSyncRanges_ty;
+
 typedef map<uint64_t, CreteMemoInfo> debug_memoSyncTable_ty;
 typedef vector<debug_memoSyncTable_ty> debug_memoSyncTables_ty;
 
@@ -203,28 +217,89 @@ typedef pair<bool, vector<CPUStateElement> > cpuStateSyncTable_ty;
 
 typedef pair<QemuInterruptInfo, bool> interruptState_ty;
 
+// Compact copy of the CPUArchState fields captured by CPUState tracing,
+// stored back-to-back in the order of the field table in runtime-dump.cpp
+typedef vector<uint8_t> cpuStateSnapshot_ty;
+
 //<name, concolic_memo>
 typedef map<string, CreteMemoInfo> creteConcolics_ty;
 
+// One finished window of streamed tracing, which owns the captured data
+// (swapped out of RuntimeEnv) until it is serialized to disk
+struct TraceWindow
+{
+    uint64_t m_streamed_index;
+    string m_outputDirectory;
+
+    TCGLLVMOfflineContext m_tcg_llvm_offline_ctx;
+    vector<cpuStateSyncTable_ty> m_cpuStateSyncTables;
+    vector<cpuStateSyncTable_ty> m_debug_cpuStateSyncTables;
+    memoSyncTables_ty m_memoSyncTables;
+
+    TraceWindow() : m_streamed_index(0) {}
+
+    void write();
+
+private:
+    string getOutputFilename(const string &fileName) const;
+
+    void writeTcgLlvmCtx();
+    void checkEmptyCPUStateSyncTables();
+    void writeCPUStateSyncTables();
+    void writeDebugCPUStateSyncTables();
+    void writeMemoSyncTables();
+    static memoSyncRanges_ty coalesceMemoSyncTable(const memoSyncTable_ty& memoSyncTable);
+};
+
+// Serializes TraceWindows on a background thread, so that the vCPU thread can
+// capture the next window while the previous one is being written.
+// Double buffered: at most one window is in flight, submit() blocks until the
+// previous window has been written.
+class TraceWindowWriter
+{
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    TraceWindow *m_pending;
+    bool m_stop;
+
+    boost::thread m_thread;
+
+public:
+    TraceWindowWriter();
+    ~TraceWindowWriter();
+
+    // Takes ownership of window
+    void submit(TraceWindow *window);
+    // Blocks until the in-flight window (if any) has been written
+    void wait();
+
+private:
+    void run();
+};
+
 
 class RuntimeEnv
 {
 private:
 	// Instruction sequence and its translation context
     TCGLLVMOfflineContext m_tcg_llvm_offline_ctx;
-    void *m_tlo_ctx_cpuState;
+    cpuStateSnapshot_ty m_tlo_ctx_cpuState;
 
     // Initial CPU state
     vector<uint8_t> m_initial_CpuState;
+    // Full CPUState before the first potential interested TB, from which
+    // m_initial_CpuState is taken
+    vector<uint8_t> m_cpuState_pre_initial;
     // CpuState Side-effects
     vector<cpuStateSyncTable_ty> m_cpuStateSyncTables;
     // Two CPU States for tracing the side effects on CPUState
     // A CPUState right after  a set of consecutive interested TBs,
     // which will be compared with a CPUState right before a set of
     // consecutive interested TBs to compute side effects on CPUState
-    pair<bool, void *> m_cpuState_post_insterest;
+    pair<bool, cpuStateSnapshot_ty> m_cpuState_post_insterest;
     // The CPUState before the execution of potential interested TBs
-    pair<bool, void *> m_cpuState_pre_interest;
+    pair<bool, cpuStateSnapshot_ty> m_cpuState_pre_interest;
     // The CPUState after each interested TB being executed for cross checking on klee side
     vector<cpuStateSyncTable_ty> m_debug_cpuStateSyncTables;
 
@@ -243,6 +318,7 @@ private:
     bool m_pending_stream;  // Flag to indicate whether this is a pending stream
     uint64_t m_streamed_tb_count;
     uint64_t m_streamed_index;
+    TraceWindowWriter m_window_writer;
 
     // For skipping tracing interrupt handling code
     pair<bool, uint64_t> m_interrupt_process_info; // (interrupt_started, ret_eip)
@@ -350,6 +426,7 @@ public:
 
     void writeRtEnvToFile();
     void verifyDumpData() const;
+    const crete::TestCase& getInputTestCase() const;
     void initOutputDirectory(const string& outputDirectory);
 
     void reverseTBDump(void *qemuCpuState);
@@ -383,14 +460,14 @@ private:
     void dump_tcg_temp(const vector<TCGTemp>& tcg_temp);
     void dump_tloTbInstCount(const uint64_t inst_count);
 
-    void writeTcgLlvmCtx();
+    // Stream tracing
+    TraceWindow *takeTraceWindow();
 
     string getOutputFilename(const string &fileName) const;
 
     void writeConcolics();
 
     // Memory Monitoring
-    void writeMemoSyncTables();
     // Old MM
     void debug_mergeMemoSyncTables();
     void debug_writeMemoSyncTables();
@@ -403,9 +480,6 @@ private:
     void print_memoSyncTables();
 
     void writeInitialCpuState();
-    void checkEmptyCPUStateSyncTables();
-    void writeCPUStateSyncTables();
-    void writeDebugCPUStateSyncTables();
     void writeDebugCpuStateOffsets();
 
     void writeInterruptStates() const;
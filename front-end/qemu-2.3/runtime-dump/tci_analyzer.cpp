@@ -44,6 +44,319 @@ struct vCPUReg{
     :m_offset(offset), m_size(size), m_name(name) {}
 };
 
+/* Shadow memory for taint analysis on guest memory:
+ * A two-level table of guest pages. Each ShadowPage holds a taint bitmap and
+ * the values of its tainted bytes. A page only exists while it has tainted
+ * bytes, so that most of guest memory accesses are ruled out with a single
+ * (cached) directory lookup instead of a hash lookup per byte.
+ * */
+struct ShadowPage
+{
+    ShadowPage()
+        : tainted_count_(0)
+    {
+        memset(taint_, 0, sizeof(taint_));
+    }
+
+    bool is_tainted(uint64_t offset) const
+    {
+        return (taint_[offset >> 6] >> (offset & 63)) & 1;
+    }
+
+    void taint(uint64_t offset, uint8_t value)
+    {
+        if(!is_tainted(offset))
+        {
+            taint_[offset >> 6] |= (uint64_t)1 << (offset & 63);
+            ++tainted_count_;
+        }
+
+        value_[offset] = value;
+    }
+
+    void untaint(uint64_t offset)
+    {
+        if(is_tainted(offset))
+        {
+            taint_[offset >> 6] &= ~((uint64_t)1 << (offset & 63));
+            --tainted_count_;
+        }
+    }
+
+    uint64_t taint_[TARGET_PAGE_SIZE / 64];
+    uint8_t value_[TARGET_PAGE_SIZE];
+    uint64_t tainted_count_;
+};
+
+class ShadowMemory
+{
+public:
+    static const uint64_t DIR_BITS = 9;
+    static const uint64_t DIR_SIZE = 1 << DIR_BITS;
+
+    typedef boost::array<ShadowPage*, DIR_SIZE> ShadowDir;
+    // (guest_addr >> (TARGET_PAGE_BITS + DIR_BITS), ShadowDir)
+    typedef boost::unordered_map<uint64_t, ShadowDir*> ShadowDirs;
+
+public:
+    ShadowMemory();
+    ShadowMemory(const ShadowMemory& other);
+    ~ShadowMemory();
+
+    ShadowMemory& operator=(const ShadowMemory& other);
+
+    // Returns NULL if the page of addr has no tainted byte
+    ShadowPage* find_page(uint64_t addr);
+    ShadowPage* get_page(uint64_t addr);
+    // Free the page of addr if it has no tainted byte anymore
+    void release_page_if_empty(uint64_t addr);
+
+    // Whether any byte within [addr, addr + size) may be tainted
+    bool may_be_tainted(uint64_t addr, uint64_t size);
+
+    // Untaint all the bytes below addr
+    void clear_below(uint64_t addr);
+    void clear();
+
+    bool empty() const
+    {
+        return page_count_ == 0;
+    }
+
+    // Debug
+    void dbg_print() const;
+
+    static uint64_t page_offset(uint64_t addr)
+    {
+        return addr & (TARGET_PAGE_SIZE - 1);
+    }
+
+private:
+    ShadowDir* find_dir(uint64_t addr);
+
+    static uint64_t dir_index(uint64_t addr)
+    {
+        return addr >> (TARGET_PAGE_BITS + DIR_BITS);
+    }
+
+    static uint64_t page_index(uint64_t addr)
+    {
+        return (addr >> TARGET_PAGE_BITS) & (DIR_SIZE - 1);
+    }
+
+private:
+    ShadowDirs dirs_;
+    uint64_t page_count_;
+
+    // The last directory being looked up
+    bool cached_dir_valid_;
+    uint64_t cached_dir_index_;
+    ShadowDir* cached_dir_;
+};
+
+ShadowMemory::ShadowMemory()
+    : page_count_(0)
+    , cached_dir_valid_(false)
+    , cached_dir_index_(0)
+    , cached_dir_(NULL)
+{
+}
+
+ShadowMemory::ShadowMemory(const ShadowMemory& other)
+    : page_count_(0)
+    , cached_dir_valid_(false)
+    , cached_dir_index_(0)
+    , cached_dir_(NULL)
+{
+    *this = other;
+}
+
+ShadowMemory::~ShadowMemory()
+{
+    clear();
+}
+
+ShadowMemory& ShadowMemory::operator=(const ShadowMemory& other)
+{
+    if(this == &other)
+        return *this;
+
+    clear();
+
+    for(ShadowDirs::const_iterator d_it = other.dirs_.begin(); d_it != other.dirs_.end(); ++d_it)
+    {
+        ShadowDir *dir = new ShadowDir;
+        for(uint64_t i = 0; i < DIR_SIZE; ++i)
+            (*dir)[i] = (*d_it->second)[i] ? new ShadowPage(*(*d_it->second)[i]) : NULL;
+
+        dirs_.insert(std::make_pair(d_it->first, dir));
+    }
+
+    page_count_ = other.page_count_;
+
+    return *this;
+}
+
+ShadowMemory::ShadowDir* ShadowMemory::find_dir(uint64_t addr)
+{
+    uint64_t index = dir_index(addr);
+    if(cached_dir_valid_ && cached_dir_index_ == index)
+        return cached_dir_;
+
+    ShadowDirs::iterator it = dirs_.find(index);
+
+    cached_dir_valid_ = true;
+    cached_dir_index_ = index;
+    cached_dir_ = (it == dirs_.end()) ? NULL : it->second;
+
+    return cached_dir_;
+}
+
+ShadowPage* ShadowMemory::find_page(uint64_t addr)
+{
+    ShadowDir *dir = find_dir(addr);
+    if(!dir)
+        return NULL;
+
+    return (*dir)[page_index(addr)];
+}
+
+ShadowPage* ShadowMemory::get_page(uint64_t addr)
+{
+    ShadowDir *dir = find_dir(addr);
+    if(!dir)
+    {
+        dir = new ShadowDir;
+        dir->assign(NULL);
+        dirs_.insert(std::make_pair(dir_index(addr), dir));
+
+        cached_dir_ = dir;
+    }
+
+    ShadowPage *&page = (*dir)[page_index(addr)];
+    if(!page)
+    {
+        page = new ShadowPage;
+        ++page_count_;
+    }
+
+    return page;
+}
+
+void ShadowMemory::release_page_if_empty(uint64_t addr)
+{
+    ShadowDir *dir = find_dir(addr);
+    if(!dir)
+        return;
+
+    ShadowPage *&page = (*dir)[page_index(addr)];
+    if(page && page->tainted_count_ == 0)
+    {
+        delete page;
+        page = NULL;
+        --page_count_;
+    }
+}
+
+bool ShadowMemory::may_be_tainted(uint64_t addr, uint64_t size)
+{
+    assert(size > 0);
+
+    if(find_page(addr))
+        return true;
+
+    // Access crossing page boundary
+    uint64_t last_addr = addr + size - 1;
+    if((last_addr >> TARGET_PAGE_BITS) != (addr >> TARGET_PAGE_BITS))
+        return find_page(last_addr) != NULL;
+
+    return false;
+}
+
+void ShadowMemory::clear_below(uint64_t addr)
+{
+    for(ShadowDirs::iterator d_it = dirs_.begin(); d_it != dirs_.end(); ++d_it)
+    {
+        ShadowDir& dir = *d_it->second;
+        uint64_t dir_base = d_it->first << (TARGET_PAGE_BITS + DIR_BITS);
+
+        for(uint64_t i = 0; i < DIR_SIZE; ++i)
+        {
+            if(!dir[i])
+                continue;
+
+            uint64_t page_base = dir_base + (i << TARGET_PAGE_BITS);
+            if(page_base >= addr)
+                continue;
+
+            if(page_base + TARGET_PAGE_SIZE <= addr)
+            {
+                delete dir[i];
+                dir[i] = NULL;
+                --page_count_;
+            }
+            else
+            {
+                for(uint64_t offset = 0; page_base + offset < addr; ++offset)
+                    dir[i]->untaint(offset);
+
+                if(dir[i]->tainted_count_ == 0)
+                {
+                    delete dir[i];
+                    dir[i] = NULL;
+                    --page_count_;
+                }
+            }
+        }
+    }
+}
+
+void ShadowMemory::clear()
+{
+    for(ShadowDirs::iterator d_it = dirs_.begin(); d_it != dirs_.end(); ++d_it)
+    {
+        ShadowDir *dir = d_it->second;
+        for(uint64_t i = 0; i < DIR_SIZE; ++i)
+            delete (*dir)[i];
+
+        delete dir;
+    }
+
+    dirs_.clear();
+    page_count_ = 0;
+
+    cached_dir_valid_ = false;
+    cached_dir_ = NULL;
+}
+
+void ShadowMemory::dbg_print() const
+{
+    for(ShadowDirs::const_iterator d_it = dirs_.begin(); d_it != dirs_.end(); ++d_it)
+    {
+        const ShadowDir& dir = *d_it->second;
+        uint64_t dir_base = d_it->first << (TARGET_PAGE_BITS + DIR_BITS);
+
+        for(uint64_t i = 0; i < DIR_SIZE; ++i)
+        {
+            if(!dir[i])
+                continue;
+
+            uint64_t page_base = dir_base + (i << TARGET_PAGE_BITS);
+            for(uint64_t offset = 0; offset < TARGET_PAGE_SIZE; ++offset)
+            {
+                if(!dir[i]->is_tainted(offset))
+                    continue;
+
+                std::cerr << "tained guest mem: "
+                << std::hex
+                << page_base + offset
+                << std::dec
+                << std::endl;
+            }
+        }
+    }
+}
+
 /* Pitfalls:
  * 1. guest_vcpu_regs_: TA and CPUState tracing monitors different part of CPU State,
  *      a) they have different blacklist:
@@ -60,7 +373,7 @@ class Analyzer
 public:
     // The address of tainted memory byte
     typedef boost::unordered_set<uint64_t> MemSet;
-    // virtual guest address, value
+    // address, value
     typedef boost::unordered_map<uint64_t, uint8_t> taintedMem_ty;
     // (offset, vCPUReg)
     typedef boost::unordered_map<uint64_t, vCPUReg> cpuRegsTable_ty;
@@ -84,6 +397,9 @@ public:
 
     bool is_within_vcpu(uint64_t addr, uint64_t size);
 
+    // Whether there is no taint to be propagated at all
+    bool is_taint_free();
+
     bool is_block_symbolic();
     bool is_previous_block_symbolic();
     void mark_block_symbolic();
@@ -99,10 +415,11 @@ public:
 private:
     Block current_block_;
 
-    taintedMem_ty guest_mem_;
+    ShadowMemory guest_mem_;
 
     // <tainted, value>
     std::pair<bool, uint8_t> guest_vcpu_regs_[CRETE_TCG_ENV_SIZE];
+    uint64_t tainted_vcpu_bytes_;
     uint64_t guest_vcpu_addr_; // The address of the guest virtual cpu
 
     // <tainted, value>
@@ -121,7 +438,8 @@ private:
 };
 
 Analyzer::Analyzer()
-    : guest_vcpu_addr_(0)
+    : tainted_vcpu_bytes_(0)
+    , guest_vcpu_addr_(0)
     , tcg_sp_value_(0)
     , previous_block_symbolic_(false)
     , initialized_(false)
@@ -191,6 +509,7 @@ void Analyzer::make_tcg_reg_symbolic(uint64_t index, uint64_t data)
     tcg_regs_[index].first = true;
     tcg_regs_[index].second = data;
 
+    crete_tci_taint_free = false;
     mark_block_symbolic();
 
 #if defined(CRETE_DBG_TA)
@@ -210,32 +529,39 @@ void Analyzer::make_tcg_reg_concrete(uint64_t index, uint64_t data)
 
 bool Analyzer::is_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data)
 {
+    if(!guest_mem_.may_be_tainted(addr, size))
+        return false;
+
     bool ret = false;
 
-    taintedMem_ty::iterator it;
     uint8_t byte_value = 0;
     for(uint64_t i = 0; i < size; ++i) {
-        it = guest_mem_.find(addr + i);
-        if(it == guest_mem_.end())
+        ShadowPage *page = guest_mem_.find_page(addr + i);
+        if(!page)
+            continue;
+
+        uint64_t offset = ShadowMemory::page_offset(addr + i);
+        if(!page->is_tainted(offset))
             continue;
 
         byte_value = (data >> i*8) & 0xff;
-        if(it->second == byte_value) {
+        if(page->value_[offset] == byte_value) {
             ret = true;
 
 #if defined(CRETE_DBG_TA)
             if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
                 fprintf(stderr, "is_guest_mem_symbolic() is true for address %p, value = %d\n",
-                        (void *)(addr+i), guest_mem_[addr+i]);
+                        (void *)(addr+i), page->value_[offset]);
 #endif
         } else {
             CRETE_DBG_GEN(
             fprintf(stderr, "[CRETE Warning] TA: is_guest_mem_symbolic() "
                     "potential under-taint-analysis: (%p) is changed (from %d to %d)"
-                    "while is tainted.\n", (void *)(addr + i), guest_mem_[addr+i], byte_value);
+                    "while is tainted.\n", (void *)(addr + i), page->value_[offset], byte_value);
             );
 
-            guest_mem_.erase(it);
+            page->untaint(offset);
+            guest_mem_.release_page_if_empty(addr + i);
         }
     }
 
@@ -245,22 +571,32 @@ bool Analyzer::is_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data
 void Analyzer::make_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data)
 {
     for(uint64_t i = 0; i < size; ++i) {
-        guest_mem_[addr+i] = (data >> i*8) & 0xff;
+        ShadowPage *page = guest_mem_.get_page(addr + i);
+        page->taint(ShadowMemory::page_offset(addr + i), (data >> i*8) & 0xff);
 
 #if defined(CRETE_DBG_TA)
         if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
             fprintf(stderr, "make_guest_mem_symbolic() for address %p, value = %d\n",
-                    (void *)(addr+i), (int)guest_mem_[addr+i]);
+                    (void *)(addr+i), (int)page->value_[ShadowMemory::page_offset(addr + i)]);
 #endif
     }
 
+    crete_tci_taint_free = false;
     mark_block_symbolic();
 }
 
 void Analyzer::make_guest_mem_concrete(uint64_t addr, uint64_t size, uint64_t data)
 {
+    if(!guest_mem_.may_be_tainted(addr, size))
+        return;
+
     for(uint64_t i = 0; i < size; ++i) {
-        guest_mem_.erase(addr + i);
+        ShadowPage *page = guest_mem_.find_page(addr + i);
+        if(!page)
+            continue;
+
+        page->untaint(ShadowMemory::page_offset(addr + i));
+        guest_mem_.release_page_if_empty(addr + i);
 
 #if defined(CRETE_DBG_TA)
         if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
@@ -323,6 +659,7 @@ bool Analyzer::is_host_mem_symbolic(uint64_t base_addr, uint64_t offset, uint64_
 
             } else {
                 guest_vcpu_regs_[offset + i].first = false;
+                --tainted_vcpu_bytes_;
 
                 CRETE_DBG_GEN(
                 fprintf(stderr, "[CRETE Warning] TA: vcpu in is_host_mem_symbolic() "
@@ -399,6 +736,9 @@ void Analyzer::make_host_mem_symbolic(uint64_t base_addr, uint64_t offset, uint6
         assert( (offset + size -1) < CRETE_TCG_ENV_SIZE);
         const uint8_t *current_cpuState = (const uint8_t *)guest_vcpu_addr_;
         for(uint64_t i = 0; i < size; ++i){
+            if(!guest_vcpu_regs_[offset + i].first)
+                ++tainted_vcpu_bytes_;
+
             guest_vcpu_regs_[offset + i].second = current_cpuState[offset + i];
             guest_vcpu_regs_[offset + i].first = true;
         }
@@ -413,6 +753,7 @@ void Analyzer::make_host_mem_symbolic(uint64_t base_addr, uint64_t offset, uint6
         assert(0 && "[CRETE ERROR] base_addr is neither guest_vcpu_addr_ nor tcg_sp_value_\n");
     }
 
+    crete_tci_taint_free = false;
     mark_block_symbolic();
 
 #if defined(CRETE_DBG_TA)
@@ -438,7 +779,12 @@ void Analyzer::make_host_mem_concrete(uint64_t base_addr, uint64_t offset, uint6
 
         assert( (offset + size -1) < CRETE_TCG_ENV_SIZE);
         for(uint64_t i = 0; i < size; ++i)
+        {
+            if(guest_vcpu_regs_[offset + i].first)
+                --tainted_vcpu_bytes_;
+
             guest_vcpu_regs_[offset + i].first = false;
+        }
     } else if (base_addr == tcg_sp_value_) {
         assert(((offset >> 63) & 1)  && "[CRETE ERROR] when base addr is not vcpu, "
                 "its offset should always be negative.\n ");
@@ -464,19 +810,26 @@ bool Analyzer::is_within_vcpu(uint64_t addr, uint64_t size)
         return false;
 }
 
-void Analyzer::dbg_print()
+bool Analyzer::is_taint_free()
 {
-    for(taintedMem_ty::const_iterator it = guest_mem_.begin();
-    it != guest_mem_.end();
-    ++it)
+    if(!guest_mem_.empty() ||
+            tainted_vcpu_bytes_ != 0 ||
+            !tcg_call_stack_mem_.empty())
+        return false;
+
+    for(uint64_t i = 0; i < TCG_TARGET_NB_REGS; ++i)
     {
-        std::cerr << "tained guest mem: "
-        << std::hex
-        << it->first
-        << std::dec
-        << std::endl;
+        if(tcg_regs_[i].first)
+            return false;
     }
 
+    return true;
+}
+
+void Analyzer::dbg_print()
+{
+    guest_mem_.dbg_print();
+
 //    for(boost::array<Reg, register_count>::iterator it = reg_.begin();
 //            it != reg_.end();
 //            ++it)
@@ -826,22 +1179,13 @@ void Analyzer::void_target_pid(const uint64_t kernel_code_start_addr)
 {
     current_block_.symbolic_block_ = false;
 
-    for(taintedMem_ty::const_iterator it = guest_mem_.cbegin(); it != guest_mem_.cend();)
-    {
-        if(it->first < kernel_code_start_addr)
-        {
-            guest_mem_.erase(it++);
-        }
-        else
-        {
-            ++it;
-        }
-    }
+    guest_mem_.clear_below(kernel_code_start_addr);
 
     for(uint32_t i = 0; i < CRETE_TCG_ENV_SIZE; ++i)
     {
         guest_vcpu_regs_[i].first = false;
     }
+    tainted_vcpu_bytes_ = 0;
 
     for(uint32_t i = 0; i < TCG_TARGET_NB_REGS; ++i)
     {
@@ -877,6 +1221,12 @@ void mark_block_branching()
 
 using namespace crete::tci;
 
+// Set at the entry of each TB when there is no taint to be propagated, so
+// that crete_tci.c can skip the taint analysis callbacks for that TB. It is
+// cleared as soon as taint is introduced, e.g. by crete_make_concolic()
+// within the TB.
+bool crete_tci_taint_free = false;
+
 // Generate assumption: within one tci operation, if there is any tainted value being read,
 // all the coming writes (to vcpu, guest memory, tci_regs) will be tainted.
 static
@@ -1244,6 +1594,17 @@ void tci_analyzer_print()
     analyzer.dbg_print();
 }
 
+void crete_tci_update_taint_free()
+{
+#if defined(CRETE_TCI_ALWAYS_ANALYZE)
+    crete_tci_taint_free = false;
+#else
+    crete_tci_taint_free = analyzer.is_taint_free();
+    if(crete_tci_taint_free)
+        crete_read_was_symbolic = false;
+#endif
+}
+
 void crete_tci_next_iteration()
 {
     analyzer = Analyzer();
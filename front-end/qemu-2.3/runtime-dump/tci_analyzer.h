@@ -22,6 +22,10 @@ bool crete_tci_is_previous_block_symbolic(void);
 void crete_tci_mark_block_symbolic(void);
 void crete_tci_next_iteration(void); // reset for taint analysis
 
+// Fast path: no taint analysis for TBs being executed without any taint
+extern bool crete_tci_taint_free;
+void crete_tci_update_taint_free(void); // Must call at the entry of each TB.
+
 void crete_tci_next_tci_instr(void); // Must call at the entry of each instruction.
 void crete_tci_read_reg(uint64_t index, uint64_t data);
 void crete_tci_write_reg(uint64_t index, uint64_t data);
@@ -4661,6 +4661,20 @@ static target_ulong disas_insn(CPUX86State *env, DisasContext *s,
             case CRETE_INSTR_ASSUME_VALUE:
                 gen_helper_crete_assume(cpu_regs[R_EAX]);
                 break;
+#if defined(CRETE_SNAPSHOT_RESTORE)
+            case CRETE_INSTR_SNAPSHOT_VALUE:
+                /* The snapshot is resumed from past this instruction, and taken
+                   once the vcpu has stopped: nothing may run in between */
+                gen_update_cc_op(s);
+                gen_jmp_im(s->pc + 8 - s->cs_base);
+                gen_helper_crete_custom_instruction_handler(cpu_tmp1_i64);
+#if defined(CRETE_CONFIG) && defined(INST_BASED_CALL_STACK) || 1
+                gen_eob(s, b);
+#else
+                gen_eob(s);
+#endif
+                break;
+#endif /* defined(CRETE_SNAPSHOT_RESTORE) */
             }
 #else
             /* Simply skip the opcode when building vanilla qemu */
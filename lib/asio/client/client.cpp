@@ -65,6 +65,16 @@ void Client::write(const PacketInfo& pktinfo)
     pimpl_->write(pktinfo);
 }
 
+size_t Client::write_raw(const char* data, size_t size)
+{
+    return pimpl_->write_raw(data, size);
+}
+
+void Client::write_file(const boost::filesystem::path& file, uint64_t size)
+{
+    pimpl_->write_file(file, size);
+}
+
 PacketInfo Client::read(std::vector<char>& buf)
 {
     return pimpl_->read(buf);
@@ -80,6 +90,11 @@ PacketInfo Client::read()
     return pimpl_->read();
 }
 
+void Client::read_raw(char* data, size_t size)
+{
+    pimpl_->read_raw(data, size);
+}
+
 PacketInfo Client::read(boost::posix_time::time_duration timeout)
 {
     return pimpl_->read(timeout);
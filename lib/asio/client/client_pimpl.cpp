@@ -178,6 +178,20 @@ void ClientImpl::write(const PacketInfo& pktinfo)
         throw runtime_error("failed to send entire stream");
 }
 
+size_t ClientImpl::write_raw(const char* data, size_t size)
+{
+    return boost::asio::write(socket_,
+                              boost::asio::buffer(data,
+                                                  size));
+}
+
+void ClientImpl::write_file(const boost::filesystem::path& file, uint64_t size)
+{
+    send_file(socket_,
+              file,
+              size);
+}
+
 PacketInfo ClientImpl::read(std::vector<char>& buf)
 {
     boost::system::error_code error;
@@ -241,6 +255,21 @@ PacketInfo ClientImpl::read()
     return pktinfo;
 }
 
+void ClientImpl::read_raw(char* data, size_t size)
+{
+    boost::system::error_code error;
+
+    size_t nrec = boost::asio::read(socket_,
+                                    boost::asio::buffer(data,
+                                                        size),
+                                    error);
+
+    if(error)
+      throw boost::system::system_error(error);
+    if(nrec != size)
+        throw runtime_error("failed to receive expected number of bytes for packet");
+}
+
 PacketInfo ClientImpl::read(boost::posix_time::time_duration timeout)
 {
     boost::system::error_code ec = boost::asio::error::would_block;
@@ -51,6 +51,17 @@ void Server::open_connection_wait()
     acceptor_.accept(socket_);
 }
 
+void Server::close_connection()
+{
+    if(socket_.is_open())
+    {
+        boost::system::error_code error; // Peer may already have closed its end; nothing to report.
+
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, error);
+        socket_.close(error);
+    }
+}
+
 bool Server::is_socket_open()
 {
     return socket_.is_open();
@@ -148,6 +159,20 @@ void Server::write(const PacketInfo& pktinfo)
         throw runtime_error("failed to send entire stream");
 }
 
+size_t Server::write_raw(const char* data, size_t size)
+{
+    return boost::asio::write(socket_,
+                              boost::asio::buffer(data,
+                                                  size));
+}
+
+void Server::write_file(const boost::filesystem::path& file, uint64_t size)
+{
+    send_file(socket_,
+              file,
+              size);
+}
+
 PacketInfo Server::read(std::vector<char>& buf)
 {
     boost::system::error_code error;
@@ -211,6 +236,21 @@ PacketInfo Server::read()
     return pktinfo;
 }
 
+void Server::read_raw(char* data, size_t size)
+{
+    boost::system::error_code error;
+
+    size_t nrec = boost::asio::read(socket_,
+                                    boost::asio::buffer(data,
+                                                        size),
+                                    error);
+
+    if(error)
+      throw boost::system::system_error(error);
+    if(nrec != size)
+        throw runtime_error("failed to receive expected number of bytes for packet");
+}
+
 void crete::Server::update_directory(const boost::filesystem::path& from, const boost::filesystem::path& to)
 {
     namespace fs = boost::filesystem;
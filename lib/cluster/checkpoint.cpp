@@ -0,0 +1,141 @@
+#include <crete/cluster/checkpoint.h>
+#include <crete/exception.h>
+
+#include <sstream>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace crete
+{
+namespace cluster
+{
+
+Checkpoint::Checkpoint(const boost::filesystem::path& dir) :
+    dir_{dir}
+{
+    fs::create_directories(dir_);
+}
+
+/**
+ * @brief Appends a record to the journal begun by the last snapshot().
+ */
+auto Checkpoint::append(const CheckpointRecord& record) -> void
+{
+    CRETE_EXCEPTION_ASSERT(journal_.is_open(),
+                           err::file_open_failed{journal_path(generation_).string()});
+
+    std::ostringstream os;
+
+    {
+        boost::archive::binary_oarchive oa(os, boost::archive::no_header);
+        oa << record;
+    }
+
+    const auto& s = os.str();
+    auto size = static_cast<uint32_t>(s.size());
+
+    journal_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    journal_.write(s.data(), static_cast<std::streamsize>(s.size()));
+    journal_.flush();
+}
+
+/**
+ * @brief Writes 'snapshot' as the next generation and starts its (empty) journal.
+ *        The previous generation's journal is dropped once the snapshot is in place.
+ */
+auto Checkpoint::snapshot(DispatchSnapshot snapshot) -> void
+{
+    auto prev = generation_;
+
+    snapshot.generation = ++generation_;
+
+    auto tmp = dir_ / (checkpoint_snapshot_file_name + ".tmp");
+
+    {
+        fs::ofstream ofs{tmp, std::ios::out | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ofs.good(), err::file_open_failed{tmp.string()});
+
+        boost::archive::binary_oarchive oa(ofs);
+        oa << snapshot;
+    }
+
+    journal_.close();
+
+    fs::remove(journal_path(generation_));
+    fs::rename(tmp,
+               dir_ / checkpoint_snapshot_file_name);
+    fs::remove(journal_path(prev));
+
+    open_journal();
+}
+
+/**
+ * @brief Reads the last snapshot and the journal that follows it. A record cut short by
+ *        dispatch dying mid-write ends the journal.
+ * @return false if no snapshot was ever taken.
+ */
+auto Checkpoint::load(DispatchSnapshot& snapshot,
+                      std::vector<CheckpointRecord>& records) -> bool
+{
+    auto snapshot_path = dir_ / checkpoint_snapshot_file_name;
+
+    if(!fs::exists(snapshot_path))
+    {
+        return false;
+    }
+
+    {
+        fs::ifstream ifs{snapshot_path, std::ios::in | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{snapshot_path.string()});
+
+        boost::archive::binary_iarchive ia(ifs);
+        ia >> snapshot;
+    }
+
+    generation_ = snapshot.generation;
+
+    fs::ifstream ifs{journal_path(snapshot.generation), std::ios::in | std::ios::binary};
+    auto size = uint32_t{0};
+    auto buf = std::string{};
+
+    while(ifs.read(reinterpret_cast<char*>(&size), sizeof(size)))
+    {
+        buf.resize(size);
+
+        if(!ifs.read(&buf[0], size))
+        {
+            break;
+        }
+
+        std::istringstream is(buf);
+        boost::archive::binary_iarchive ia(is, boost::archive::no_header);
+
+        records.emplace_back();
+        ia >> records.back();
+    }
+
+    return true;
+}
+
+auto Checkpoint::journal_path(uint64_t generation) const -> boost::filesystem::path
+{
+    return dir_ / (checkpoint_journal_file_name + "." + std::to_string(generation));
+}
+
+auto Checkpoint::open_journal() -> void
+{
+    auto path = journal_path(generation_);
+
+    journal_.open(path, std::ios::out | std::ios::binary | std::ios::app);
+
+    CRETE_EXCEPTION_ASSERT(journal_.good(), err::file_open_failed{path.string()});
+}
+
+} // namespace cluster
+} // namespace crete
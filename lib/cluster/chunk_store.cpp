@@ -0,0 +1,372 @@
+#include <crete/cluster/chunk_store.h>
+#include <crete/exception.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/uuid/name_generator.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace fs = boost::filesystem;
+namespace bui = boost::uuids;
+
+namespace crete
+{
+namespace cluster
+{
+
+namespace
+{
+
+auto chunk_id(const char* data,
+              std::size_t size) -> ChunkID
+{
+    return bui::name_generator{bui::nil_uuid()}(data, size);
+}
+
+auto write_chunk(const fs::path& path,
+                 const char* data,
+                 std::size_t size) -> void
+{
+    fs::ofstream ofs{path, std::ios::out | std::ios::binary};
+
+    CRETE_EXCEPTION_ASSERT(ofs.good(), err::file_open_failed{path.string()});
+
+    ofs.write(data, static_cast<std::streamsize>(size));
+}
+
+auto read_chunk(const fs::path& path) -> std::vector<char>
+{
+    auto data = std::vector<char>(static_cast<std::size_t>(fs::file_size(path)));
+
+    fs::ifstream ifs{path, std::ios::in | std::ios::binary};
+
+    CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{path.string()});
+
+    ifs.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+    return data;
+}
+
+} // namespace
+
+ChunkStore::ChunkStore(const boost::filesystem::path& root) :
+    root_{root}
+{
+}
+
+/**
+ * @return chunks of 'manifest' not in the store, each listed once.
+ */
+auto ChunkStore::missing(const TraceManifest& manifest) const -> std::vector<ChunkID>
+{
+    auto seen = boost::unordered_set<ChunkID>{};
+    auto ids = std::vector<ChunkID>{};
+
+    for(const auto& file : manifest.files_)
+    {
+        for(const auto& id : file.chunks_)
+        {
+            if(seen.insert(id).second && !fs::exists(chunk_path(id)))
+            {
+                ids.emplace_back(id);
+            }
+        }
+    }
+
+    return ids;
+}
+
+/**
+ * @brief Moves the chunks of a bundle made by bundle()/write_bundle() into the store.
+ *        Each chunk is checked against its name before it's accepted. The bundle is removed.
+ */
+auto ChunkStore::absorb(const boost::filesystem::path& bundle) -> void
+{
+    fs::create_directories(root_);
+
+    auto chunks = std::vector<fs::path>{fs::directory_iterator{bundle},
+                                        fs::directory_iterator{}};
+
+    for(const auto& chunk : chunks)
+    {
+        auto id = bui::string_generator{}(chunk.filename().string());
+        auto data = read_chunk(chunk);
+
+        CRETE_EXCEPTION_ASSERT(chunk_id(data.data(), data.size()) == id,
+                               err::msg{"chunk contents don't match its id: " + chunk.string()});
+
+        fs::rename(chunk,
+                   chunk_path(id));
+    }
+
+    fs::remove_all(bundle);
+}
+
+/**
+ * @brief Gathers chunks into a directory, 'bundle', one file per chunk named after its id.
+ *        Chunks are hard linked where possible.
+ */
+auto ChunkStore::bundle(const std::vector<ChunkID>& ids,
+                        const boost::filesystem::path& bundle) const -> void
+{
+    fs::create_directories(bundle);
+
+    for(const auto& id : ids)
+    {
+        auto from = chunk_path(id);
+        auto to = bundle / bui::to_string(id);
+
+        CRETE_EXCEPTION_ASSERT(fs::exists(from), err::file_missing{from.string()});
+
+        boost::system::error_code ec;
+
+        fs::create_hard_link(from, to, ec);
+
+        if(ec)
+        {
+            fs::copy_file(from, to);
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds, in-place, the trace directory described by the manifest at 'trace'.
+ */
+auto ChunkStore::materialize(const boost::filesystem::path& trace) const -> void
+{
+    auto manifest = read_manifest(trace);
+    auto tmp = fs::path{trace}.replace_extension("tmp");
+
+    fs::remove_all(tmp);
+
+    for(const auto& file : manifest.files_)
+    {
+        auto path = tmp / file.path_;
+
+        fs::create_directories(path.parent_path());
+
+        fs::ofstream ofs{path, std::ios::out | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ofs.good(), err::file_open_failed{path.string()});
+
+        for(const auto& id : file.chunks_)
+        {
+            auto data = read_chunk(chunk_path(id));
+
+            ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+
+        CRETE_EXCEPTION_ASSERT(static_cast<uint64_t>(ofs.tellp()) == file.size_,
+                               err::file{path.string()});
+    }
+
+    fs::remove(trace);
+    fs::rename(tmp,
+               trace);
+}
+
+auto ChunkStore::remove(const std::vector<ChunkID>& ids) const -> void
+{
+    for(const auto& id : ids)
+    {
+        fs::remove(chunk_path(id));
+    }
+}
+
+auto ChunkStore::chunk_path(const ChunkID& id) const -> boost::filesystem::path
+{
+    return root_ / bui::to_string(id);
+}
+
+ChunkCache::ChunkCache(uint64_t capacity) :
+    capacity_{capacity}
+{
+}
+
+auto ChunkCache::retain(const TraceManifest& manifest) -> void
+{
+    for(const auto& file : manifest.files_)
+    {
+        auto left = file.size_;
+
+        for(const auto& id : file.chunks_)
+        {
+            auto bytes = std::min(left, static_cast<uint64_t>(trace_chunk_size));
+            auto it = entries_.find(id);
+
+            left -= bytes;
+
+            if(it == entries_.end())
+            {
+                entries_.emplace(id, Entry{1, bytes, lru_.end()});
+            }
+            else if(it->second.refs++ == 0)
+            {
+                lru_.erase(it->second.lru_it);
+                lru_bytes_ -= it->second.bytes;
+            }
+        }
+    }
+}
+
+/**
+ * @return chunks to drop from the store: the least recently released, now that unreferenced
+ *         chunks no longer fit in the capacity.
+ */
+auto ChunkCache::release(const TraceManifest& manifest) -> std::vector<ChunkID>
+{
+    for(const auto& file : manifest.files_)
+    {
+        for(const auto& id : file.chunks_)
+        {
+            auto it = entries_.find(id);
+
+            CRETE_EXCEPTION_ASSERT(it != entries_.end() && it->second.refs > 0,
+                                   err::msg{"chunk released more often than retained"});
+
+            if(--it->second.refs == 0)
+            {
+                lru_.push_front(id);
+                it->second.lru_it = lru_.begin();
+                lru_bytes_ += it->second.bytes;
+            }
+        }
+    }
+
+    return evict();
+}
+
+auto ChunkCache::evict() -> std::vector<ChunkID>
+{
+    auto ids = std::vector<ChunkID>{};
+
+    while(!lru_.empty() &&
+          lru_bytes_ > capacity_)
+    {
+        auto it = entries_.find(lru_.back());
+
+        assert(it != entries_.end());
+
+        lru_bytes_ -= it->second.bytes;
+        ids.emplace_back(it->first);
+        entries_.erase(it);
+        lru_.pop_back();
+    }
+
+    return ids;
+}
+
+/**
+ * @brief Splits every file of the trace directory into trace_chunk_size chunks and names them.
+ */
+auto make_manifest(const boost::filesystem::path& trace) -> TraceManifest
+{
+    CRETE_EXCEPTION_ASSERT(fs::is_directory(trace), err::file_missing{trace.string()});
+
+    auto manifest = TraceManifest{};
+    auto buf = std::vector<char>(trace_chunk_size);
+    auto prefix_size = trace.string().size() + 1; // Including the separator.
+
+    manifest.name_ = trace.filename().string();
+
+    for(fs::recursive_directory_iterator it{trace}, end; it != end; ++it)
+    {
+        if(!fs::is_regular_file(it->path()))
+        {
+            continue;
+        }
+
+        auto file = ChunkedFile{};
+
+        file.path_ = it->path().string().substr(prefix_size);
+        file.size_ = fs::file_size(it->path());
+
+        fs::ifstream ifs{it->path(), std::ios::in | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{it->path().string()});
+
+        while(ifs.read(buf.data(), static_cast<std::streamsize>(buf.size())),
+              ifs.gcount() > 0)
+        {
+            file.chunks_.emplace_back(chunk_id(buf.data(),
+                                               static_cast<std::size_t>(ifs.gcount())));
+        }
+
+        manifest.files_.emplace_back(file);
+    }
+
+    return manifest;
+}
+
+/**
+ * @brief Like ChunkStore::bundle(), but takes the chunks from the trace directory itself.
+ */
+auto write_bundle(const boost::filesystem::path& trace,
+                  const TraceManifest& manifest,
+                  const std::vector<ChunkID>& ids,
+                  const boost::filesystem::path& bundle) -> void
+{
+    auto wanted = boost::unordered_set<ChunkID>{ids.begin(), ids.end()};
+    auto buf = std::vector<char>(trace_chunk_size);
+
+    fs::create_directories(bundle);
+
+    for(const auto& file : manifest.files_)
+    {
+        auto path = trace / file.path_;
+
+        fs::ifstream ifs{path, std::ios::in | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{path.string()});
+
+        for(const auto& id : file.chunks_)
+        {
+            ifs.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+
+            if(wanted.erase(id))
+            {
+                write_chunk(bundle / bui::to_string(id),
+                            buf.data(),
+                            static_cast<std::size_t>(ifs.gcount()));
+            }
+        }
+    }
+
+    CRETE_EXCEPTION_ASSERT(wanted.empty(), err::msg{"chunks requested that aren't part of " + trace.string()});
+}
+
+auto write_manifest(const TraceManifest& manifest,
+                    const boost::filesystem::path& file) -> void
+{
+    fs::ofstream ofs{file, std::ios::out | std::ios::binary};
+
+    CRETE_EXCEPTION_ASSERT(ofs.good(), err::file_open_failed{file.string()});
+
+    boost::archive::binary_oarchive oa(ofs);
+    oa << manifest;
+}
+
+auto read_manifest(const boost::filesystem::path& file) -> TraceManifest
+{
+    auto manifest = TraceManifest{};
+
+    fs::ifstream ifs{file, std::ios::in | std::ios::binary};
+
+    CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{file.string()});
+
+    boost::archive::binary_iarchive ia(ifs);
+    ia >> manifest;
+
+    return manifest;
+}
+
+} // namespace cluster
+} // namespace crete
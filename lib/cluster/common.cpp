@@ -32,13 +32,70 @@ ImageInfo::ImageInfo(const boost::filesystem::path& image) :
 {
 }
 
+namespace
+{
+
+/**
+ * @brief Command handed to tar's --use-compress-program for a given format. The level is
+ *        ignored when decompressing.
+ */
+auto compress_program(const std::string& format,
+                      uint32_t level,
+                      bool decompress) -> std::string
+{
+    auto exe = bp::find_executable_in_path(format); // Throws if the compressor isn't installed.
+
+    if(decompress)
+    {
+        return exe + " -d";
+    }
+
+    auto cmd = exe + " -" + std::to_string(level);
+
+    if(format == "zstd")
+    {
+        cmd += " -T0"; // All cores.
+    }
+
+    return cmd;
+}
+
+/**
+ * @brief Format of an archive made by archive_directory(), told by its leading bytes.
+ * @return empty if uncompressed.
+ */
+auto detect_compress_format(const boost::filesystem::path& archive) -> std::string
+{
+    uint8_t magic[4] = {0};
+
+    fs::ifstream ifs{archive, std::ios::in | std::ios::binary};
+
+    CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{archive.string()});
+
+    ifs.read(reinterpret_cast<char*>(magic), sizeof(magic));
+
+    if(magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+        return "zstd";
+    if(magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4D && magic[3] == 0x18)
+        return "lz4";
+    if(magic[0] == 0x1F && magic[1] == 0x8B)
+        return "gzip";
+
+    return std::string{};
+}
+
+} // namespace
+
 /**
  * @brief archive_directory archives a directory into a single archived file
  *        of the same name. Please note that this is done in-place.
  * @param dir - path to the directory to be archived, in-place.
- * @note Compression is also done on the archive.
+ * @param compress_format - compressor the archive is streamed through (zstd, lz4). Empty for none.
+ * @param compress_level - level passed on to the compressor.
  */
-auto archive_directory(const boost::filesystem::path& dir) -> void
+auto archive_directory(const boost::filesystem::path& dir,
+                       const std::string& compress_format,
+                       uint32_t compress_level) -> void
 {
     auto tmp = fs::path{dir}.replace_extension("tmp");
 
@@ -48,11 +105,18 @@ auto archive_directory(const boost::filesystem::path& dir) -> void
     ctx.work_directory = dir.parent_path().string();
     ctx.environment = bp::self::get_environment();
     auto exe = bp::find_executable_in_path("tar");
-    auto args = std::vector<std::string>{fs::path{exe}.filename().string(),
-                                         "-zcf",
-                                         tmp.filename().string(),
-                                         dir.filename().string()
-                                         };
+    auto args = std::vector<std::string>{fs::path{exe}.filename().string()};
+
+    if(!compress_format.empty())
+    {
+        args.emplace_back("--use-compress-program=" + compress_program(compress_format,
+                                                                       compress_level,
+                                                                       false));
+    }
+
+    args.insert(args.end(), {"-cf",
+                             tmp.filename().string(),
+                             dir.filename().string()});
 
     auto proc = bp::launch(exe, args, ctx);
     auto status = proc.wait();
@@ -70,8 +134,8 @@ auto archive_directory(const boost::filesystem::path& dir) -> void
 /**
  * @brief restore_directory restores a previously archived directory via archive_directory().
  *        Please note that this is done in-place.
- * @param dir - path to the directory to be restored, in-place.
- * @note Archive is decompressed.
+ * @param dir - path to the directory to be restored, in-place. Left alone if already a directory.
+ * @note Archive is decompressed with whichever compressor made it.
  */
 auto restore_directory(const boost::filesystem::path& dir) -> void
 {
@@ -79,6 +143,13 @@ auto restore_directory(const boost::filesystem::path& dir) -> void
 
     CRETE_EXCEPTION_ASSERT(fs::exists(dir), err::file_missing{dir.string()});
 
+    if(fs::is_directory(dir))
+    {
+        return;
+    }
+
+    auto compress_format = detect_compress_format(dir);
+
     fs::rename(dir,
                tmp);
 
@@ -86,10 +157,17 @@ auto restore_directory(const boost::filesystem::path& dir) -> void
     ctx.work_directory = dir.parent_path().string();
     ctx.environment = bp::self::get_environment();
     auto exe = bp::find_executable_in_path("tar");
-    auto args = std::vector<std::string>{fs::path{exe}.filename().string(),
-                                         "-xf",
-                                         tmp.filename().string(),
-                                         };
+    auto args = std::vector<std::string>{fs::path{exe}.filename().string()};
+
+    if(!compress_format.empty())
+    {
+        args.emplace_back("--use-compress-program=" + compress_program(compress_format,
+                                                                       0,
+                                                                       true));
+    }
+
+    args.insert(args.end(), {"-xf",
+                             tmp.filename().string()});
 
     auto proc = bp::launch(exe, args, ctx);
     auto status = proc.wait();
@@ -1,4 +1,6 @@
 #include <crete/cluster/dispatch.h>
+#include <crete/cluster/chunk_store.h>
+#include <crete/cluster/checkpoint.h>
 #include <crete/exception.h>
 #include <crete/logger.h>
 #include <crete/async_task.h>
@@ -14,12 +16,21 @@
 #include <boost/msm/front/euml/operator.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <vector>
 
+#include <pthread.h>
+#include <sched.h>
+
 namespace bpt = boost::property_tree;
 namespace bui = boost::uuids;
 namespace fs = boost::filesystem;
@@ -43,10 +54,14 @@ auto receive_tests(NodeRegistrar::Node& node) -> std::vector<TestCase>;
 auto receive_errors(NodeRegistrar::Node& node) -> std::vector<log::NodeError>;
 auto receive_image_info(NodeRegistrar::Node& node) -> ImageInfo;
 auto transmit_trace(NodeRegistrar::Node& node,
-                    const boost::filesystem::path& traces) -> void;
+                    const boost::filesystem::path& trace,
+                    const option::Trace& options) -> void;
 auto transmit_tests(NodeRegistrar::Node& node,
                     const std::vector<TestCase>& tcs) -> void;
 auto transmit_commencement(NodeRegistrar::Node& node) -> void;
+auto transmit_reset(NodeRegistrar::Node& node) -> void;
+auto transmit_target(NodeRegistrar::Node& node,
+                     const std::string& target) -> void;
 auto transmit_image_info(NodeRegistrar::Node& node,
                          const ImageInfo& ii) -> void;
 auto transmit_config(NodeRegistrar::Node& node,
@@ -57,6 +72,7 @@ auto register_node_fsm(NodeRegistrar::Node& node,
                        AtomicGuard<std::vector<std::shared_ptr<vm::NodeFSM>>>& vm_node_fsms,
                        AtomicGuard<std::vector<std::shared_ptr<svm::NodeFSM>>>& svm_node_fsms) -> void;
 auto make_dispatch_root() -> boost::filesystem::path;
+auto estimate_replay_cost(const TraceManifest& manifest) -> uint64_t;
 auto extract_initial_test(const config::RunConfiguration& config) -> TestCase;
 
 namespace vm
@@ -99,12 +115,14 @@ class VMNodeFSM_ : public boost::msm::front::state_machine_def<VMNodeFSM_>
 public:
     VMNodeFSM_();
 
+    auto node() const -> const NodeRegistrar::Node&;
     auto node_status() const -> const NodeStatus&;
     auto get_trace() const -> const fs::path&;
     auto errors() const -> const std::deque<log::NodeError>&;
     auto pop_error() -> log::NodeError;
     auto guest_data() const -> const GuestData&;
     auto get_guest_data_post_exec() const -> const GuestDataPostExec&;
+    auto status_wait(uint32_t ms) -> void;
 
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
@@ -147,6 +165,7 @@ public:
     struct rx_guest_data;
     struct commence;
     struct rx_status;
+    struct rx_status_update;
     struct rx_trace;
     struct tx_test;
     struct rx_error;
@@ -207,9 +226,9 @@ public:
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<GuestDataRxed     ,poll              ,RxStatus          ,none                 ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<RxStatus          ,poll              ,StatusRxed        ,rx_status            ,none                 >,
+      Row<RxStatus          ,poll              ,StatusRxed        ,rx_status_update     ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<StatusRxed        ,poll              ,RxTrace           ,none                 ,none                 >,
+      Row<StatusRxed        ,poll              ,RxTrace           ,none                 ,is_prev_task_finished>,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<RxTrace           ,poll              ,TxTest            ,none                 ,Not_<has_trace>      >,
       Row<RxTrace           ,poll              ,TraceRxed         ,rx_trace             ,has_trace            >,
@@ -237,6 +256,7 @@ private:
     bool update_image_{false};
     bool distributed_{false};
     GuestData guest_data_;
+    uint32_t status_wait_{status_update_timeout}; // ms the node may hold back its next status update.
 };
 
 struct start
@@ -288,10 +308,10 @@ VMNodeFSM_::VMNodeFSM_()
 {
 }
 
-//auto VMNodeFSM_::node() -> NodeRegistrar::Node&
-//{
-//    return node_;
-//}
+auto VMNodeFSM_::node() const -> const NodeRegistrar::Node&
+{
+    return node_;
+}
 
 auto VMNodeFSM_::node_status() const -> const NodeStatus&
 {
@@ -327,6 +347,11 @@ auto VMNodeFSM_::guest_data() const -> const GuestData&
     return guest_data_;
 }
 
+auto VMNodeFSM_::status_wait(uint32_t ms) -> void
+{
+    status_wait_ = ms;
+}
+
 // +--------------------------------------------------+
 // + States                                           +
 // +--------------------------------------------------+
@@ -435,6 +460,8 @@ struct VMNodeFSM_::StatusRxed : public msm::front::state<>
     template <class Event,class FSM>
     void on_exit(Event const&,FSM& ) {std::cout << "leaving: StatusRxed" << std::endl;}
 #endif // defined(CRETE_DEBUG)
+
+    std::unique_ptr<AsyncTask> async_task_{new AsyncTask{}};
 };
 
 struct VMNodeFSM_::RxTrace : public msm::front::state<>
@@ -559,10 +586,6 @@ struct VMNodeFSM_::update_image
                 BOOST_THROW_EXCEPTION(Exception{} << err::file_missing{image_path.string()});
             }
 
-            fs::ifstream ifs(image_path);
-
-            CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{image_path.string()});
-
             auto pkinfo = PacketInfo{0,0,0};
             auto lock = node->acquire();
 
@@ -574,8 +597,7 @@ struct VMNodeFSM_::update_image
             std::cout << "Sending OS image to VM Node..." << std::endl;
 
             write(lock->server,
-                  ifs,
-                  default_chunk_size);
+                  image_path);
 
         }
         , fsm.node_
@@ -621,6 +643,22 @@ struct VMNodeFSM_::rx_status
     }
 };
 
+struct VMNodeFSM_::rx_status_update
+{
+    template <class EVT,class FSM,class SourceState,class TargetState>
+    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState& ts) -> void
+    {
+        ts.async_task_.reset(new AsyncTask{[]( NodeRegistrar::Node node
+                                             , uint32_t timeout)
+        {
+            cluster::poll_update(node,
+                                 timeout);
+        }
+        , fsm.node_
+        , fsm.status_wait_});
+    }
+};
+
 struct VMNodeFSM_::rx_trace
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
@@ -818,16 +856,20 @@ private:
     NodeRegistrar::Node node_;
     std::vector<TestCase> tests_;
     std::deque<log::NodeError> errors_;
+    uint32_t status_wait_{status_update_timeout}; // ms the node may hold back its next status update.
+    option::Trace trace_options_;
 
     friend class vm::VMNodeFSM_; // Allow reuse of VMNode's actions/guards with private members.
 
 public:
     SVMNodeFSM_();
 
+    auto node() const -> const NodeRegistrar::Node&;
     auto node_status() -> const NodeStatus&;
     auto tests() -> const std::vector<TestCase>&;
     auto errors() -> const std::deque<log::NodeError>&;
     auto pop_error() -> const log::NodeError;
+    auto status_wait(uint32_t ms) -> void;
 
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
@@ -865,6 +907,7 @@ public:
     struct tx_trace;
     struct rx_test;
     using rx_status = vm::NodeFSM::rx_status;
+    using rx_status_update = vm::NodeFSM::rx_status_update;
     using rx_error = vm::NodeFSM::rx_error;
 
     // +--------------------------------------------------+
@@ -901,9 +944,9 @@ public:
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<Commence          ,poll              ,RxStatus          ,commence             ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<RxStatus          ,poll              ,StatusRxed        ,rx_status            ,none                 >,
+      Row<RxStatus          ,poll              ,StatusRxed        ,rx_status_update     ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<StatusRxed        ,poll              ,TxTrace           ,none                 ,none                 >,
+      Row<StatusRxed        ,poll              ,TxTrace           ,none                 ,is_prev_task_finished>,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<TxTrace           ,trace             ,TraceTxed         ,tx_trace             ,none                 >,
       Row<TxTrace           ,poll              ,RxTest            ,none                 ,none                 >,
@@ -925,11 +968,14 @@ public:
 
 struct start
 {
-    start(NodeRegistrar::Node& node) :
-        node_{node}
+    start(NodeRegistrar::Node& node,
+          const option::Trace& trace_options) :
+        node_{node},
+        trace_options_{trace_options}
     {}
 
     NodeRegistrar::Node node_;
+    option::Trace trace_options_;
 };
 
 struct trace
@@ -941,6 +987,11 @@ SVMNodeFSM_::SVMNodeFSM_()
 {
 }
 
+auto SVMNodeFSM_::node() const -> const NodeRegistrar::Node&
+{
+    return node_;
+}
+
 auto SVMNodeFSM_::node_status() -> const NodeStatus&
 {
     return node_->acquire()->status;
@@ -965,6 +1016,11 @@ auto SVMNodeFSM_::pop_error() -> const log::NodeError
     return e;
 }
 
+auto SVMNodeFSM_::status_wait(uint32_t ms) -> void
+{
+    status_wait_ = ms;
+}
+
 // +--------------------------------------------------+
 // + States                                           +
 // +--------------------------------------------------+
@@ -1061,6 +1117,7 @@ struct SVMNodeFSM_::init
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
         fsm.node_ = ev.node_;
+        fsm.trace_options_ = ev.trace_options_;
     }
 };
 
@@ -1079,13 +1136,16 @@ struct SVMNodeFSM_::tx_trace
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState& ts) -> void
     {
         ts.async_task_.reset(new AsyncTask{[]( NodeRegistrar::Node node
-                                             , const fs::path trace)
+                                             , const fs::path trace
+                                             , const option::Trace options)
         {
             transmit_trace(node,
-                           trace);
+                           trace,
+                           options);
         }
         , fsm.node_
-        , ev.trace_});
+        , ev.trace_
+        , fsm.trace_options_});
 
     }
 };
@@ -1124,6 +1184,149 @@ class NodeFSM : public boost::msm::back::state_machine<SVMNodeFSM_>
 namespace fsm
 {
 
+// +--------------------------------------------------+
+// + Status                                           +
+// +--------------------------------------------------+
+
+/**
+ * @brief A node's queues as last seen by the dispatch thread.
+ */
+struct NodeCounts
+{
+    bool vm;
+    uint32_t test_case_count;
+    uint32_t trace_count;
+};
+
+/**
+ * @brief What the status display and the statistics need of a campaign. Dispatch publishes
+ *        the counters as it goes; StatusReporter reads them from its own thread.
+ */
+struct CampaignStatus
+{
+    CampaignStatus(const std::string& target,
+                   const fs::path& root);
+
+    auto display(std::ostream& os) -> void;
+    auto write_statistics(uint64_t interval) -> void;
+
+    const std::string target_;
+    const fs::path root_;
+    std::atomic<uint64_t> elapsed_{0};
+    std::atomic<uint64_t> tests_left_{0};
+    std::atomic<uint64_t> tests_total_{0};
+    std::atomic<uint64_t> traces_left_{0};
+    std::atomic<uint64_t> traces_total_{0};
+    AtomicGuard<std::vector<NodeCounts>> nodes_; // Copied in by the dispatch thread: the reporter never locks a node.
+
+    // Only touched by the StatusReporter thread.
+    uint64_t statistics_time_{0};
+    bool statistics_started_{false};
+};
+
+/**
+ * @brief Redraws the status of every campaign and appends to their statistics on a timer,
+ *        at idle priority, so the dispatch loop never forks or writes files to report progress.
+ */
+class StatusReporter
+{
+public:
+    using CampaignStatusPtr = std::shared_ptr<CampaignStatus>;
+
+public:
+    ~StatusReporter();
+
+    auto start(uint64_t profile_interval) -> void;
+    auto add(const CampaignStatusPtr& status) -> void;
+    auto remove(const CampaignStatusPtr& status) -> void;
+
+private:
+    auto run() -> void;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector<CampaignStatusPtr> statuses_;
+    uint64_t profile_interval_{0};
+    bool stop_{false};
+    std::thread thread_;
+};
+
+// +--------------------------------------------------+
+// + Campaign                                         +
+// +--------------------------------------------------+
+
+/**
+ * @brief One target under test: its pools, its coverage and the nodes serving it.
+ *        Dispatch runs up to test.concurrent-targets campaigns side by side, each rooted
+ *        in a directory of its own laid out as a lone target's root was.
+ */
+struct Campaign
+{
+    using VMNodeFSM = std::shared_ptr<vm::NodeFSM>;
+    using VMNodeFSMs = std::vector<VMNodeFSM>;
+    using SVMNodeFSM = std::shared_ptr<svm::NodeFSM>;
+    using SVMNodeFSMs = std::vector<SVMNodeFSM>;
+
+    Campaign(const option::Dispatch& options,
+             const fs::path& root,
+             const std::string& target,
+             const fs::path& seeds);
+
+    auto to_trace_pool(const fs::path& trace) -> void;
+    auto next_trace(uint64_t node_id,
+                    uint32_t queued_on_node,
+                    bool replaying) -> boost::optional<fs::path>;
+    auto next_test() -> boost::optional<TestCase>;
+    auto set_up_root_dir() -> void;
+    auto start_clocks() -> void;
+    auto elapsed_time() -> uint64_t;
+    auto no_new_tb_time() -> uint64_t;
+    auto set_update_time_last_new_tb(const GuestDataPostExec& data) -> uint64_t;
+    auto node_count(uint32_t type) -> std::size_t;
+    auto nodes() -> NodeRegistrar::Nodes;
+    auto release_nodes() -> NodeRegistrar::Nodes;
+    auto release_drained_node(uint32_t type) -> NodeRegistrar::Node;
+    auto are_node_queues_empty() -> bool;
+    auto are_all_queues_empty() -> bool;
+    auto are_nodes_inactive() -> bool;
+    auto is_converged() -> bool;
+    auto is_expired() -> bool;
+    auto write_target_log(const log::NodeError& ne,
+                          const fs::path& subdir) -> void;
+    auto publish_status() -> void;
+    auto publish_nodes() -> void;
+    auto finish() -> void;
+    auto open_checkpoint() -> void;
+    auto update_checkpoint() -> void;
+    auto take_snapshot() -> void;
+    auto restore(const DispatchSnapshot& snapshot,
+                 const std::vector<CheckpointRecord>& records) -> void;
+
+    const option::Dispatch& options_;
+    fs::path root_;
+    std::string target_; // Empty in developer mode.
+    fs::path seeds_;
+    TestPool test_pool_;
+    TracePool trace_pool_;
+    AtomicGuard<VMNodeFSMs> vm_node_fsms_;
+    AtomicGuard<SVMNodeFSMs> svm_node_fsms_;
+    GuestData guest_data_;
+
+    std::chrono::time_point<std::chrono::system_clock> start_time_ = std::chrono::system_clock::now(); // Once had_nodes_.
+    uint64_t resumed_elapsed_{0}; // Seconds spent on the target by the run resumed from.
+    bool first_trace_rxed_{false};
+    bool guest_data_rxed_{false};
+    bool had_nodes_{false}; // Until then, nothing has started: neither convergence nor the clocks count.
+    boost::unordered_set<uint64_t> explored_tbs_;
+    std::chrono::time_point<std::chrono::system_clock> update_time_last_new_tb_ = std::chrono::system_clock::now();
+    std::shared_ptr<CampaignStatus> status_;
+
+    std::unique_ptr<Checkpoint> checkpoint_;
+    bool resumed_{false};
+    uint64_t checkpoint_snapshot_time_{0};
+    uint64_t checkpoint_elapsed_time_{0};
+};
+
 // +--------------------------------------------------+
 // + Finite State Machine                             +
 // +--------------------------------------------------+
@@ -1148,37 +1351,28 @@ struct poll {};
 class DispatchFSM_ : public boost::msm::front::state_machine_def<DispatchFSM_>
 {
 public:
-    using VMNodeFSM = std::shared_ptr<vm::NodeFSM>;
-    using VMNodeFSMs = std::vector<VMNodeFSM>;
-    using SVMNodeFSM = std::shared_ptr<svm::NodeFSM>;
-    using SVMNodeFSMs = std::vector<SVMNodeFSM>;
+    using VMNodeFSM = Campaign::VMNodeFSM;
+    using VMNodeFSMs = Campaign::VMNodeFSMs;
+    using SVMNodeFSM = Campaign::SVMNodeFSM;
+    using SVMNodeFSMs = Campaign::SVMNodeFSMs;
+    using CampaignPtr = std::shared_ptr<Campaign>;
 
 public:
     DispatchFSM_();
     ~DispatchFSM_();
 
-    auto to_trace_pool(const fs::path& trace) -> void;
-    auto next_trace() -> boost::optional<fs::path>;
-    auto next_test() -> boost::optional<TestCase>;
     auto node_registrar() -> AtomicGuard<NodeRegistrar>&;
-    auto display_status(std::ostream& os) -> void;
-    auto write_test_pool_log(std::ostream& os) -> void;
-    auto write_statistics() -> void;
-    auto test_pool() -> TestPool&;
-    auto trace_pool() -> TracePool&;
     auto store_config_file() -> void;
     auto set_up_root_dir() -> void;
     auto launch_node_registrar(Port master) -> void;
-    auto elapsed_time() -> uint64_t;
-    auto are_node_queues_empty() -> bool;
-    auto are_all_queues_empty() -> bool;
-    auto are_nodes_inactive() -> bool;
-    auto is_converged() -> bool;
-    auto write_target_log(const log::NodeError& ne,
-                          const fs::path& subdir) -> void;
-
-    auto set_update_time_last_new_tb(const GuestDataPostExec& data) -> void;
-    auto no_new_tb_time() -> uint64_t;
+    auto add_campaign(const fs::path& root,
+                      const std::string& target,
+                      const fs::path& seeds) -> void;
+    auto assign_node(Campaign& campaign,
+                     NodeRegistrar::Node& node) -> void;
+    auto balance_nodes(uint32_t type,
+                       std::deque<NodeRegistrar::Node>& idle) -> void;
+    auto was_idle() -> bool; // Whether the last dispatch moved no node along. Resets on call.
 
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
@@ -1197,7 +1391,6 @@ public:
     // +--------------------------------------------------+
     struct Start;
     struct SpecCheck;
-    struct NextTarget;
     struct Dispatch;
     struct Terminate;
     struct Terminated;
@@ -1206,20 +1399,16 @@ public:
     // + Actions                                          +
     // +--------------------------------------------------+
     struct init;
-    struct reset;
-    struct assign_next_target;
+    struct retire_campaigns;
+    struct launch_campaigns;
+    struct assign_nodes;
     struct dispatch;
-    struct finish;
-    struct next_target_clean;
     struct terminate;
 
     // +--------------------------------------------------+
     // + Gaurds                                           +
     // +--------------------------------------------------+
-    struct is_first;
-    struct is_dev_mode;
-    struct have_next_target;
-    struct is_target_expired;
+    struct is_done;
 
     // +--------------------------------------------------+
     // + Transitions                                      +
@@ -1244,28 +1433,15 @@ public:
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<Start             ,start             ,SpecCheck         ,init                 ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<SpecCheck         ,poll              ,NextTarget        ,none                 ,And_<Not_<is_dev_mode>,
-                                                                                              Or_<is_first,
-                                                                                                  And_<is_target_expired,
-                                                                                                       have_next_target>>>>,
-      Row<SpecCheck         ,poll              ,Dispatch          ,none                 ,Or_<is_dev_mode,
-                                                                                             And_<Not_<is_first>,
-                                                                                                  Not_<is_target_expired>>>>,
-      Row<SpecCheck         ,poll              ,Terminate         ,next_target_clean    ,And_<is_target_expired,
-                                                                                              Not_<have_next_target>>>,
-    //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<NextTarget        ,poll              ,Dispatch          ,ActionSequence_<mpl::vector<
-                                                                       finish,
-                                                                       next_target_clean,
-                                                                       reset,
-                                                                       assign_next_target>>
-                                                                                        ,none                 >,
+      Row<SpecCheck         ,poll              ,Dispatch          ,ActionSequence_<mpl::vector<
+                                                                       launch_campaigns,
+                                                                       assign_nodes,
+                                                                       retire_campaigns>>   ,Not_<is_done>        >,
+      Row<SpecCheck         ,poll              ,Terminate         ,none                 ,is_done              >,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<Dispatch          ,poll              ,SpecCheck         ,dispatch             ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<Terminate         ,poll              ,Terminated        ,ActionSequence_<mpl::vector<
-                                                                       finish,
-                                                                       terminate>>      ,none                 >
+      Row<Terminate         ,poll              ,Terminated        ,terminate            ,none                 >
     > {};
 
 private:
@@ -1273,26 +1449,20 @@ private:
     AtomicGuard<NodeRegistrar> node_registrar_;
     boost::thread node_registrar_driver_thread_;
     boost::filesystem::path root_{make_dispatch_root()};
-    TestPool test_pool_{root_};
-//    TracePool trace_pool_{option::Dispatch{}, "weighted"};
-    TracePool trace_pool_{option::Dispatch{}};
-    AtomicGuard<VMNodeFSMs> vm_node_fsms_;
-    AtomicGuard<SVMNodeFSMs> svm_node_fsms_;
     Port master_port_;
     crete::log::Logger exception_log_;
     crete::log::Logger node_error_log_;
 
-    std::chrono::time_point<std::chrono::system_clock> start_time_ = std::chrono::system_clock::now();
-    bool first_{true};
     std::deque<std::string> next_target_queue_;
     std::deque<std::string> next_target_seeds_queue_;
-    std::string target_;
-    boost::filesystem::path current_target_seeds_;
-    bool first_trace_rxed_{false};
-    GuestData guest_data_;
+    std::vector<CampaignPtr> campaigns_;
+    StatusReporter status_reporter_;
 
-    boost::unordered_set<uint64_t> explored_tbs_;
-    std::chrono::time_point<std::chrono::system_clock> update_time_last_new_tb_ = std::chrono::system_clock::now();
+    AtomicGuard<NodeRegistrar::Nodes> registered_nodes_; // Filled by the registrar's thread; yet to be assigned.
+    std::deque<NodeRegistrar::Node> idle_vm_nodes_;
+    std::deque<NodeRegistrar::Node> idle_svm_nodes_;
+
+    bool idle_{false};
 };
 
 struct start
@@ -1330,16 +1500,6 @@ struct DispatchFSM_::SpecCheck : public msm::front::state<>
 #endif // defined(CRETE_DEBUG)
 };
 
-struct DispatchFSM_::NextTarget : public msm::front::state<>
-{
-#if defined(CRETE_DEBUG)
-    template <class Event,class FSM>
-    void on_entry(Event const&,FSM&) {std::cout << "entering: NextTarget" << std::endl;}
-    template <class Event,class FSM>
-    void on_exit(Event const&,FSM& ) {std::cout << "leaving: NextTarget" << std::endl;}
-#endif // defined(CRETE_DEBUG)
-};
-
 struct DispatchFSM_::Dispatch : public msm::front::state<>
 {
 #if defined(CRETE_DEBUG)
@@ -1376,56 +1536,13 @@ struct DispatchFSM_::Terminated : public msm::front::terminate_state<>
 // + Gaurds                                           +
 // +--------------------------------------------------+
 
-struct DispatchFSM_::is_first
-{
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
-    {
-        return fsm.first_;
-    }
-};
-
-struct DispatchFSM_::is_dev_mode
-{
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
-    {
-        return !fsm.options_.mode.distributed;
-    }
-};
-
-struct DispatchFSM_::have_next_target
-{
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
-    {
-        return !fsm.next_target_queue_.empty();
-    }
-};
-
-struct DispatchFSM_::is_target_expired
+struct DispatchFSM_::is_done
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
     {
-        auto elapsed_time_count = fsm.elapsed_time();
-        auto no_new_tb_time_count = fsm.no_new_tb_time();
-
-        assert(elapsed_time_count >= 0);
-
-        auto converged = fsm.is_converged();
-        auto trace_exceeded = fsm.trace_pool_.count_all_unique() >= fsm.options_.test.interval.trace;
-        auto tc_exceeded = fsm.test_pool_.count_all() >= fsm.options_.test.interval.tc;
-        auto overall_time_exceeded = elapsed_time_count >= fsm.options_.test.interval.time;
-        auto no_new_tb_time_exceeded = no_new_tb_time_count >= fsm.options_.test.interval.new_inst_wait_time;
-
-        return
-                   converged
-                || trace_exceeded
-                || tc_exceeded
-                || overall_time_exceeded
-                || no_new_tb_time_exceeded
-                ;
+        return fsm.campaigns_.empty()
+            && fsm.next_target_queue_.empty();
     }
 };
 
@@ -1438,6 +1555,11 @@ struct DispatchFSM_::init
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        if(!ev.options_.resume.empty())
+        {
+            fsm.root_ = ev.options_.resume;
+        }
+
         fsm.exception_log_.add_sink(fsm.root_ / log_dir_name / exception_log_file_name);
         fsm.exception_log_.auto_flush(true);
         fsm.node_error_log_.add_sink(fsm.root_ / log_dir_name / dispatch_node_error_log_file_name);
@@ -1454,281 +1576,362 @@ struct DispatchFSM_::init
             assert(fsm.next_target_seeds_queue_.size() == fsm.next_target_queue_.size()); // FIXME: xxx use exception
         }
 
-        fsm.trace_pool_ = TracePool{fsm.options_};
-
-        fsm.launch_node_registrar(fsm.master_port_);
+        fsm.set_up_root_dir();
+        fsm.status_reporter_.start(fsm.options_.profile.interval);
 
         if(!fsm.options_.mode.distributed) // TODO: should be encoded into FSM.
         {
-            fsm.set_up_root_dir();
+            fsm.add_campaign(fsm.root_,
+                             std::string{},
+                             fs::path{});
         }
+
+        fsm.launch_node_registrar(fsm.master_port_);
     }
 };
 
-struct DispatchFSM_::reset
+struct DispatchFSM_::retire_campaigns
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        fsm.set_up_root_dir();
+        auto& campaigns = fsm.campaigns_;
 
-        fsm.test_pool_ = TestPool{fsm.root_};
-        fsm.trace_pool_ = TracePool{fsm.options_};
+        for(auto it = campaigns.begin(); it != campaigns.end();)
+        {
+            auto& campaign = **it;
 
-        fsm.vm_node_fsms_.acquire()->clear();
-        fsm.svm_node_fsms_.acquire()->clear();
+            if(!campaign.is_expired())
+            {
+                ++it;
 
-        fsm.start_time_ = std::chrono::system_clock::now();
-        fsm.first_trace_rxed_ = false;
+                continue;
+            }
 
-        fsm.explored_tbs_.clear();
-        fsm.update_time_last_new_tb_ = std::chrono::system_clock::now();
+            campaign.finish();
+            fsm.status_reporter_.remove(campaign.status_);
 
-        {
-            auto lock = fsm.node_registrar_.acquire();
+            // No need to store expensive traces once we're done testing.
+            fs::remove_all(campaign.root_ / dispatch_trace_dir_name);
 
-            for(auto& node : lock->nodes())
+            for(auto& node : campaign.release_nodes())
             {
-                {
-                    auto nl = node->acquire();
-                    auto pkinfo = PacketInfo{0,0,0};
-                    pkinfo.id = nl->status.id;
-                    pkinfo.type = packet_type::cluster_reset;
+                transmit_reset(node);
 
-                    nl->server.write(pkinfo);
+                if(node->acquire()->type == packet_type::cluster_request_vm_node)
+                {
+                    fsm.idle_vm_nodes_.emplace_back(node);
+                }
+                else
+                {
+                    fsm.idle_svm_nodes_.emplace_back(node);
                 }
-
-                register_node_fsm(node,
-                                  fsm.options_,
-                                  fsm.root_,
-                                  fsm.vm_node_fsms_,
-                                  fsm.svm_node_fsms_);
             }
 
+            it = campaigns.erase(it);
         }
     }
 };
 
-struct DispatchFSM_::assign_next_target
+struct DispatchFSM_::launch_campaigns
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        auto registered = NodeRegistrar::Nodes{};
+
         {
-            auto lock = fsm.node_registrar_.acquire();
+            auto lock = fsm.registered_nodes_.acquire();
+
+            registered = static_cast<NodeRegistrar::Nodes>(lock);
+            lock->clear();
+        }
 
-            for(auto& node : lock->nodes())
+        for(auto& node : registered)
+        {
+            if(node->acquire()->type == packet_type::cluster_request_vm_node)
+            {
+                fsm.idle_vm_nodes_.emplace_back(node);
+            }
+            else
             {
-                auto nl = node->acquire();
+                fsm.idle_svm_nodes_.emplace_back(node);
+            }
+        }
 
-                if(nl->type != packet_type::cluster_request_vm_node)
-                {
-                    continue;
-                }
+        auto vm_count = fsm.idle_vm_nodes_.size();
+        auto svm_count = fsm.idle_svm_nodes_.size();
 
-                auto pkinfo = PacketInfo{0,0,0};
-                pkinfo.id = nl->status.id;
-                pkinfo.type = packet_type::cluster_next_target;
+        for(auto& campaign : fsm.campaigns_)
+        {
+            vm_count += campaign->node_count(packet_type::cluster_request_vm_node);
+            svm_count += campaign->node_count(packet_type::cluster_request_svm_node);
+        }
+
+        // A campaign is only started once there are enough nodes for each to have a VM and an SVM node.
+        auto& queue = fsm.next_target_queue_;
+
+        while(!queue.empty() &&
+              fsm.campaigns_.size() < fsm.options_.test.concurrent_targets &&
+              fsm.campaigns_.size() < vm_count &&
+              fsm.campaigns_.size() < svm_count)
+        {
+            auto target = queue.front();
+            auto seeds = fs::path{};
+
+            queue.pop_front();
 
-                auto& queue = fsm.next_target_queue_;
-                write_serialized_binary(nl->server,
-                                        pkinfo,
-                                        queue.front());
-                fsm.target_ = queue.front();
-                queue.pop_front();
+            if(!fsm.next_target_seeds_queue_.empty())
+            {
+                seeds = fsm.next_target_seeds_queue_.front();
+                fsm.next_target_seeds_queue_.pop_front();
+                assert(fsm.next_target_seeds_queue_.size() == fsm.next_target_queue_.size()); // FIXME: xxx use exception
             }
+
+            fsm.add_campaign(fsm.root_ / fs::path{target}.filename(),
+                             target,
+                             seeds);
         }
     }
 };
 
+struct DispatchFSM_::assign_nodes
+{
+    template <class EVT,class FSM,class SourceState,class TargetState>
+    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
+    {
+        fsm.balance_nodes(packet_type::cluster_request_vm_node,
+                          fsm.idle_vm_nodes_);
+        fsm.balance_nodes(packet_type::cluster_request_svm_node,
+                          fsm.idle_svm_nodes_);
+    }
+};
+
 struct DispatchFSM_::dispatch
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        fsm.idle_ = true;
+
+        for(auto& c : fsm.campaigns_)
         {
-            auto vmns_lock = fsm.vm_node_fsms_.acquire();
+            auto& campaign = *c;
 
-            std::for_each(vmns_lock->begin(),
-                          vmns_lock->end(),
-                          [&] (VMNodeFSM& nfsm)
             {
-                if(nfsm->is_flag_active<vm::flag::trace_rxed>())
+                auto vmns_lock = campaign.vm_node_fsms_.acquire();
+
+                std::for_each(vmns_lock->begin(),
+                              vmns_lock->end(),
+                              [&] (VMNodeFSM& nfsm)
                 {
-                    using boost::msm::back::HANDLED_TRUE;
+                    auto prev_state = *nfsm->current_state();
 
-                    if(!fsm.first_trace_rxed_)
+                    // A node that could take a test right away shouldn't hold back its status.
+                    if(campaign.test_pool_.count_next() > 0 &&
+                       nfsm->node_status().test_case_count < fsm.options_.test.batch*vm_test_multiplier)
                     {
-                        fsm.first_trace_rxed_ = true;
+                        nfsm->status_wait(0);
                     }
-
-                    if(HANDLED_TRUE == nfsm->process_event(vm::trace{}))
+                    else
                     {
-                        fsm.to_trace_pool(nfsm->get_trace());
-                        fsm.set_update_time_last_new_tb(nfsm->get_guest_data_post_exec());
+                        nfsm->status_wait(status_update_timeout);
                     }
-                }
-                else if(nfsm->is_flag_active<vm::flag::tx_test>())
-                {
-                    auto tests = std::vector<TestCase>{};
-                    auto tc_count = nfsm->node_status().test_case_count;
 
-                    while(tc_count < (1*vm_test_multiplier)) // TODO: should be num_vm_insts*vm_test_multiplier. Also, should verify bandwidth, though I doubt this would be a problem.
+                    if(nfsm->is_flag_active<vm::flag::trace_rxed>())
                     {
-                        auto next = fsm.next_test();
+                        using boost::msm::back::HANDLED_TRUE;
 
-                        if(!next)
-                            break;
+                        if(!campaign.first_trace_rxed_)
+                        {
+                            campaign.first_trace_rxed_ = true;
+                        }
 
-                        tests.emplace_back(*next);
+                        if(HANDLED_TRUE == nfsm->process_event(vm::trace{}))
+                        {
+                            campaign.to_trace_pool(nfsm->get_trace());
+                            const auto& data = nfsm->get_guest_data_post_exec();
 
-                        ++tc_count;
+                            campaign.test_pool_.credit_coverage(data.m_tc_issue_index,
+                                                                campaign.set_update_time_last_new_tb(data));
+                        }
                     }
-
-                    nfsm->process_event(vm::test{tests});
-                }
-                else if(nfsm->is_flag_active<vm::flag::error_rxed>())
-                {
-                    while(!nfsm->errors().empty())
+                    else if(nfsm->is_flag_active<vm::flag::tx_test>())
                     {
-                        auto err = nfsm->pop_error();
+                        auto tests = std::vector<TestCase>{};
+                        auto tc_count = nfsm->node_status().test_case_count;
+
+                        while(tc_count < (fsm.options_.test.batch*vm_test_multiplier)) // TODO: should be num_vm_insts*vm_test_multiplier. Also, should verify bandwidth, though I doubt this would be a problem.
+                        {
+                            auto next = campaign.next_test();
+
+                            if(!next)
+                                break;
+
+                            tests.emplace_back(*next);
 
-                        fsm.write_target_log(err, dispatch_log_vm_dir_name);
-                        fsm.node_error_log_ << "Target: " << fsm.target_ << "\n"
-                                            <<  err.log << "\n";
+                            ++tc_count;
+                        }
+
+                        nfsm->process_event(vm::test{tests});
                     }
+                    else if(nfsm->is_flag_active<vm::flag::error_rxed>())
+                    {
+                        while(!nfsm->errors().empty())
+                        {
+                            auto err = nfsm->pop_error();
 
-                    nfsm->process_event(vm::poll{});
-                }
-                else if(nfsm->is_flag_active<vm::flag::tx_config>())
-                {
-                    nfsm->process_event(vm::config{fsm.options_});
-                }
-                else if(nfsm->is_flag_active<vm::flag::image>())
-                {
-                    nfsm->process_event(vm::image{fsm.options_.vm.image.path});
-                }
-                else if(nfsm->is_flag_active<vm::flag::guest_data_rxed>())
-                {
-                    fsm.guest_data_ = nfsm->guest_data();
-                    fsm.guest_data_.write_guest_config(fsm.root_ / dispatch_guest_data_dir_name / dispatch_guest_config_file_name);
+                            campaign.write_target_log(err, dispatch_log_vm_dir_name);
+                            fsm.node_error_log_ << "Target: " << campaign.target_ << "\n"
+                                                <<  err.log << "\n";
+                        }
 
-                    if(fsm.options_.test.seeds.empty())
+                        nfsm->process_event(vm::poll{});
+                    }
+                    else if(nfsm->is_flag_active<vm::flag::tx_config>())
+                    {
+                        nfsm->process_event(vm::config{fsm.options_});
+                    }
+                    else if(nfsm->is_flag_active<vm::flag::image>())
+                    {
+                        nfsm->process_event(vm::image{fsm.options_.vm.image.path});
+                    }
+                    else if(nfsm->is_flag_active<vm::flag::guest_data_rxed>())
                     {
-                        if(fsm.options_.vm.initial_tc.get_elements().size() > 0)
+                        campaign.guest_data_ = nfsm->guest_data();
+                        campaign.guest_data_rxed_ = true;
+                        campaign.guest_data_.write_guest_config(campaign.root_ / dispatch_guest_data_dir_name / dispatch_guest_config_file_name);
+
+                        if(campaign.resumed_)
+                        {
+                            // Queues were restored from the checkpoint.
+                        }
+                        else if(campaign.seeds_.empty())
                         {
-                            fsm.test_pool_.insert_initial_tcs(vector<TestCase>(1, fsm.options_.vm.initial_tc));
+                            if(fsm.options_.vm.initial_tc.get_elements().size() > 0)
+                            {
+                                campaign.test_pool_.insert_initial_tcs(vector<TestCase>(1, fsm.options_.vm.initial_tc));
+                            }
+                            else
+                            {
+                                campaign.test_pool_.insert_initial_tc_from_config(extract_initial_test(campaign.guest_data_.guest_config));
+                            }
                         }
                         else
                         {
-                            fsm.test_pool_.insert_initial_tc_from_config(extract_initial_test(fsm.guest_data_.guest_config));
+                            std::vector<TestCase> seeds = retrieve_tests(campaign.seeds_.string());
+                            campaign.test_pool_.insert_initial_tcs(seeds);
                         }
+
+                        nfsm->process_event(vm::poll{});
                     }
                     else
                     {
-                        fsm.current_target_seeds_ = fsm.next_target_seeds_queue_.front();
-                        fsm.next_target_seeds_queue_.pop_front();
-                        assert(fsm.next_target_seeds_queue_.size() == fsm.next_target_queue_.size()); // FIXME: xxx use exception
-
-                        std::vector<TestCase> seeds = retrieve_tests(fsm.current_target_seeds_.string());
-                        fsm.test_pool_.insert_initial_tcs(seeds);
+                        nfsm->process_event(vm::poll{});
                     }
 
-                    nfsm->process_event(vm::poll{});
-                }
-                else
-                {
-                    nfsm->process_event(vm::poll{});
-                }
-            });
-        }
-
-        {
-            auto svmns_lock = fsm.svm_node_fsms_.acquire();
+                    if(*nfsm->current_state() != prev_state)
+                    {
+                        fsm.idle_ = false;
+                    }
+                });
+            }
 
-            std::for_each(svmns_lock->begin(),
-                          svmns_lock->end(),
-                          [&] (SVMNodeFSM& nfsm)
             {
-                if(nfsm->is_flag_active<svm::flag::test_rxed>())
-                {
-                    fsm.test_pool_.insert(nfsm->tests());
+                auto svmns_lock = campaign.svm_node_fsms_.acquire();
 
-                    nfsm->process_event(svm::test{});
-                }
-                else if(nfsm->is_flag_active<svm::flag::tx_trace>())
+                std::for_each(svmns_lock->begin(),
+                              svmns_lock->end(),
+                              [&] (SVMNodeFSM& nfsm)
                 {
-                    auto trace_count = nfsm->node_status().trace_count;
-                    auto next = boost::optional<fs::path>{};
+                    auto prev_state = *nfsm->current_state();
+
+                    // A node that could take a trace right away shouldn't hold back its status.
+                    if(campaign.trace_pool_.count_next() > 0 &&
+                       nfsm->node_status().trace_count < svm_trace_queue_size)
+                    {
+                        nfsm->status_wait(0);
+                    }
+                    else
+                    {
+                        nfsm->status_wait(status_update_timeout);
+                    }
 
-                    if(trace_count < (1*vm_trace_multiplier)) // TODO: should be num_vm_insts*vm_trace_multiplier. Also, should verify bandwidth, though I doubt this would be a problem.
+                    if(nfsm->is_flag_active<svm::flag::test_rxed>())
                     {
+                        campaign.test_pool_.insert(nfsm->tests());
 
-                        try // TODO: I don't like using try/catch here, but the trace could fail somehow (bug) and we need to continue testing. Have a better way?
-                        {   // Cont: what seems to be causing the bug is that a supergraph is found which in turn causes a callback to call and remove it from the trace pool.
-                            // Cont: This, then, seems to cause the problem. Some reference to the trace is removed, while another is perserved. When lookup is done based on the preserved, the removed raises an exception.
-                            next = fsm.next_trace();
-                        }
-                        catch(std::exception& e)
+                        nfsm->process_event(svm::test{});
+                    }
+                    else if(nfsm->is_flag_active<svm::flag::tx_trace>())
+                    {
+                        auto trace_count = nfsm->node_status().trace_count;
+                        auto next = boost::optional<fs::path>{};
+
+                        if(trace_count < svm_trace_queue_size)
                         {
-                            fsm.exception_log_
-                                    << boost::diagnostic_information(e)
-                                    << "\n"
-                                    << __FILE__
-                                    << ": "
-                                    << __LINE__
-                                    << "\n";
+
+                            try // TODO: I don't like using try/catch here, but the trace could fail somehow (bug) and we need to continue testing. Have a better way?
+                            {   // Cont: what seems to be causing the bug is that a supergraph is found which in turn causes a callback to call and remove it from the trace pool.
+                                // Cont: This, then, seems to cause the problem. Some reference to the trace is removed, while another is perserved. When lookup is done based on the preserved, the removed raises an exception.
+                                next = campaign.next_trace(nfsm->node_status().id,
+                                                           trace_count,
+                                                           nfsm->node_status().active);
+                            }
+                            catch(std::exception& e)
+                            {
+                                fsm.exception_log_
+                                        << boost::diagnostic_information(e)
+                                        << "\n"
+                                        << __FILE__
+                                        << ": "
+                                        << __LINE__
+                                        << "\n";
+                            }
+
                         }
 
+                        if(next)
+                        {
+                            nfsm->process_event(svm::trace{*next});
+                        }
+                        else
+                        {
+                            nfsm->process_event(svm::poll{});
+                        }
                     }
+                    else if(nfsm->is_flag_active<vm::flag::error_rxed>())
+                    {
+                        while(!nfsm->errors().empty())
+                        {
+                            auto err = nfsm->pop_error();
 
-                    if(next)
+                            campaign.write_target_log(err, dispatch_log_svm_dir_name);
+                            fsm.node_error_log_ << "Target: " << campaign.target_ << "\n"
+                                                <<  err.log << "\n";
+                        }
+
+                        nfsm->process_event(svm::poll{});
+                    }
+                    else if(nfsm->is_flag_active<vm::flag::tx_config>())
                     {
-                        nfsm->process_event(svm::trace{*next});
+                        nfsm->process_event(vm::config{fsm.options_});
                     }
                     else
                     {
                         nfsm->process_event(svm::poll{});
                     }
-                }
-                else if(nfsm->is_flag_active<vm::flag::error_rxed>())
-                {
-                    while(!nfsm->errors().empty())
-                    {
-                        auto err = nfsm->pop_error();
 
-                        fsm.write_target_log(err, dispatch_log_svm_dir_name);
-                        fsm.node_error_log_ << "Target: " << fsm.target_ << "\n"
-                                            <<  err.log << "\n";
+                    if(*nfsm->current_state() != prev_state)
+                    {
+                        fsm.idle_ = false;
                     }
+                });
+            }
 
-                    nfsm->process_event(svm::poll{});
-                }
-                else if(nfsm->is_flag_active<vm::flag::tx_config>())
-                {
-                    nfsm->process_event(vm::config{fsm.options_});
-                }
-                else
-                {
-                    nfsm->process_event(svm::poll{});
-                }
-            });
+            campaign.publish_status();
+            campaign.update_checkpoint();
         }
-
-        fsm.first_ = false;
-
-        fsm.display_status(std::cout);
-        fsm.write_statistics();
-    }
-};
-
-struct DispatchFSM_::next_target_clean
-{
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
-    {
-        // No need to store expensive traces once we're done testing.
-        fs::remove_all(fsm.root_ / dispatch_trace_dir_name);
     }
 };
 
@@ -1737,11 +1940,14 @@ struct DispatchFSM_::terminate
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        // In distributed mode, the run's root holds a directory per target.
+        auto coverage_root = fsm.options_.mode.distributed ? fsm.root_ : fsm.root_.parent_path();
+
         fs::path coverage_exec = fsm.options_.coverage.cmd_path;
         if(!coverage_exec.empty() && fs::is_regular(coverage_exec))
         {
             std::string cmd = fs::canonical(coverage_exec).string() + " " +
-                    fs::canonical(fsm.root_.parent_path()).string();;
+                    fs::canonical(coverage_root).string();;
 
             fprintf(stderr, " coverage_cmd = %s \n"
                     "Running batch_coverage ... ",
@@ -1762,128 +1968,487 @@ struct DispatchFSM_::terminate
     }
 };
 
-struct DispatchFSM_::finish
+CampaignStatus::CampaignStatus(const std::string& target,
+                               const fs::path& root) :
+    target_{target},
+    root_{root}
 {
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
+}
+
+auto CampaignStatus::display(std::ostream& os) -> void
+{
+    using namespace std;
+
+    auto nodes = static_cast<std::vector<NodeCounts>>(nodes_.acquire());
+
+    if(!target_.empty())
     {
-        auto p = fsm.root_ / log_dir_name;
+        os << target_ << endl;
+    }
 
-        if(!fs::exists(p)) // TODO: encode as part of transition table. We only want to write the 'finish' file for existing tests, not the first time NextTest entered.
+    os << setw(12) << "time (s)"
+         << "|"
+         << setw(12) << "tests left"
+         << "|"
+         << setw(12) << "traces left"
+         << "|";
+
+    {
+        auto count = 1u;
+        for(const auto& node : nodes)
         {
-            return;
-        }
+            auto tt = std::string{};
 
-        auto finish_log = p / dispatch_log_finish_file_name;
+            tt += to_string(count++);
 
-        fs::ofstream ofs{finish_log};
+            if(node.vm)
+                tt += "-[vm]";
+            else
+                tt += "-[svm]";
 
-        if(!ofs.good())
-        {
-            BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{finish_log.string()});
+            tt += " tc/tr";
+
+            os << setw(14) << tt
+                 << "|";
         }
+    }
 
-        fsm.display_status(ofs);
+    os << endl;
 
-        auto test_case_tree_log = p / dispatch_log_test_case_tree_file_name;
-        fs::ofstream tc_tree_ofs{test_case_tree_log};
+    auto disp_time = std::to_string(elapsed_);
 
-        if(!tc_tree_ofs.good())
-        {
-            BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{test_case_tree_log.string()});
-        }
+    auto test = to_string(tests_left_) +
+                 "/" +
+                 to_string(tests_total_);
+    auto trace = to_string(traces_left_) +
+                 "/" +
+                 to_string(traces_total_);
+
+    os << setw(12) << disp_time
+         << "|"
+         << setw(12) << test
+         << "|"
+         << setw(12) << trace
+         << "|";
+
+    for(const auto& node : nodes)
+    {
+        auto tt = std::string{};
 
-        fsm.write_test_pool_log(tc_tree_ofs);
+        tt += to_string(node.test_case_count) +
+              "/" +
+              to_string(node.trace_count);
+        os << setw(14) << tt
+             << "|";
     }
-};
 
-DispatchFSM_::DispatchFSM_()
+    os << endl;
+}
+
+auto CampaignStatus::write_statistics(uint64_t interval) -> void
 {
+    auto time = elapsed_.load();
+    auto dir = root_ / dispatch_profile_dir_name;
+
+    if(time - statistics_time_ >= interval)
+    {
+        statistics_time_ = time;
+    }
+    else
+    {
+        return;
+    }
+
+    if(!statistics_started_)
+    {
+        statistics_started_ = true;
+
+        fs::ofstream ofs{dir / "stat.pg"};
+
+        ofs << R"(#!/usr/bin/gnuplot
+               reset
+               set terminal png
+
+               set title "Test cases and traces per second"
+               set grid
+               set key reverse Left outside
+               set style data linespoints
+
+               set ylabel "tcs/traces"
+
+               set xlabel "seconds"
+
+               plot "stat.dat" using 1:2 title "tc remaining", \
+               "" using 1:3 title "tc total", \
+               "" using 1:4 title "trace remaining", \
+               "" using 1:5 title "trace total"
+               #)";
+    }
+
+    fs::ofstream ofs{dir / "stat.dat"
+                    ,std::ios_base::app};
+
+    ofs << time
+        << " "
+        << tests_left_
+        << " "
+        << tests_total_
+        << " "
+        << traces_left_
+        << " "
+        << traces_total_
+        << "\n";
 }
 
-DispatchFSM_::~DispatchFSM_()
+StatusReporter::~StatusReporter()
 {
-    if(node_registrar_driver_thread_.joinable())
     {
-        node_registrar_driver_thread_.join();
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        stop_ = true;
+    }
+
+    cond_.notify_all();
+
+    if(thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+auto StatusReporter::start(uint64_t profile_interval) -> void
+{
+    profile_interval_ = profile_interval;
+
+    thread_ = std::thread{&StatusReporter::run,
+                          this};
+
+    // Reporting must never take time from dispatch; failing to lower the priority is harmless.
+    auto param = sched_param{};
+
+    pthread_setschedparam(thread_.native_handle(),
+                          SCHED_IDLE,
+                          &param);
+}
+
+auto StatusReporter::add(const CampaignStatusPtr& status) -> void
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    statuses_.emplace_back(status);
+}
+
+auto StatusReporter::remove(const CampaignStatusPtr& status) -> void
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    statuses_.erase(std::remove(statuses_.begin(),
+                                statuses_.end(),
+                                status),
+                    statuses_.end());
+}
+
+auto StatusReporter::run() -> void
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    while(!cond_.wait_for(lock,
+                          std::chrono::milliseconds{dispatch_status_interval},
+                          [this] { return stop_; }))
+    {
+        auto statuses = statuses_;
+
+        lock.unlock();
+
+        std::ostringstream ss;
+
+        ss << "\033[2J\033[H"; // Clear the terminal.
+
+        for(auto& status : statuses)
+        {
+            status->display(ss);
+            status->write_statistics(profile_interval_);
+        }
+
+        std::cout << ss.str() << std::flush;
+
+        lock.lock();
     }
 }
 
-auto DispatchFSM_::to_trace_pool(const fs::path& trace) -> void
+Campaign::Campaign(const option::Dispatch& options,
+                   const fs::path& root,
+                   const std::string& target,
+                   const fs::path& seeds) :
+    options_(options),
+    root_{root},
+    target_{target},
+    seeds_{seeds},
+    test_pool_{root_,
+               to_test_sched_strat(options.test.priority)},
+    trace_pool_{options},
+    status_{std::make_shared<CampaignStatus>(target, root)}
+{
+}
+
+auto Campaign::to_trace_pool(const fs::path& trace) -> void
 {
     CRETE_EXCEPTION_ASSERT(fs::exists(trace), err::file_missing{trace.string()})
 
-    trace_pool_.insert(trace);
+    trace_pool_.insert(trace,
+                       estimate_replay_cost(read_manifest(trace)));
 }
 
-auto DispatchFSM_::next_trace() -> boost::optional<fs::path>
+auto Campaign::next_trace(uint64_t node_id,
+                          uint32_t queued_on_node,
+                          bool replaying) -> boost::optional<fs::path>
 {
-    return trace_pool_.next();
+    return trace_pool_.next(node_id,
+                            queued_on_node,
+                            replaying);
 }
 
-auto DispatchFSM_::next_test() -> boost::optional<TestCase>
+auto Campaign::next_test() -> boost::optional<TestCase>
 {
     return test_pool_.next();
 }
 
-auto DispatchFSM_::launch_node_registrar(Port master) -> void
+auto Campaign::set_up_root_dir() -> void
 {
-    node_registrar_driver_thread_ =
-            boost::thread{NodeRegistrarDriver{master,
-                          node_registrar_,
-                          [this] (NodeRegistrar::Node& node) {
-        register_node_fsm(node,
-                          options_,
-                          root_,
-                          vm_node_fsms_,
-                          svm_node_fsms_);
-    }}};
+    auto create_dirs = [](const fs::path& root)
+    {
+        return [root](const std::vector<std::string>& v)
+        {
+            for(const auto& e : v)
+            {
+                auto d = root / e;
+                if(!fs::create_directories(d))
+                {
+                    BOOST_THROW_EXCEPTION(Exception{} << err::file_create{d.string()});
+                }
+            }
+        };
+    };
+
+    if(!fs::exists(root_))
+    {
+        auto create_root_dirs = create_dirs(root_);
+        auto create_log_dirs = create_dirs(root_ / log_dir_name);
+
+        create_root_dirs({dispatch_trace_dir_name,
+                          dispatch_test_case_dir_name,
+                          dispatch_profile_dir_name,
+                          dispatch_guest_data_dir_name});
+        create_log_dirs({dispatch_log_vm_dir_name,
+                         dispatch_log_svm_dir_name});
+    }
 }
 
-auto DispatchFSM_::elapsed_time() -> uint64_t
+/**
+ * @brief Starts the time limits once the campaign gets its first node. A campaign launched
+ *        alongside others may wait for a drained node long after it's constructed.
+ */
+auto Campaign::start_clocks() -> void
+{
+    auto current_time = std::chrono::system_clock::now();
+
+    start_time_ = current_time - std::chrono::seconds{resumed_elapsed_};
+    update_time_last_new_tb_ = current_time;
+}
+
+auto Campaign::elapsed_time() -> uint64_t
 {
     using namespace std::chrono;
 
+    if(!had_nodes_)
+    {
+        return resumed_elapsed_;
+    }
+
     auto current_time = system_clock::now();
 
     return duration_cast<seconds>(current_time - start_time_).count();
 }
 
-auto DispatchFSM_::no_new_tb_time() -> uint64_t
+auto Campaign::no_new_tb_time() -> uint64_t
 {
     using namespace std::chrono;
 
+    if(!had_nodes_)
+    {
+        return 0;
+    }
+
     auto current_time = system_clock::now();
 
     return duration_cast<seconds>(current_time - update_time_last_new_tb_).count();
 }
 
+// Returns the number of TBs in 'data' not explored before
+auto Campaign::set_update_time_last_new_tb(const GuestDataPostExec& data) -> uint64_t
+{
+    const vector<uint64_t>& current_new_tbs = data.m_new_captured_tbs;
+
+    CheckpointRecord r;
+    r.type = CheckpointRecord::tbs_explored;
 
-auto DispatchFSM_::are_node_queues_empty() -> bool
+    for(vector<uint64_t>::const_iterator it = current_new_tbs.begin();
+            it != current_new_tbs.end(); ++it) {
+        if(explored_tbs_.insert(*it).second)
+        {
+            r.tbs.push_back(*it);
+        }
+    }
+
+    uint64_t inserted = r.tbs.size();
+
+    if(inserted)
+    {
+        if(checkpoint_)
+        {
+            checkpoint_->append(r);
+        }
+
+        update_time_last_new_tb_ = std::chrono::system_clock::now();
+
+        cerr << "update_time_last_new_tb_ is updated\n";
+    }
+
+    return inserted;
+}
+
+auto Campaign::node_count(uint32_t type) -> std::size_t
 {
-    auto lock = node_registrar_.acquire();
-    auto& nodes = lock->nodes();
+    if(type == packet_type::cluster_request_vm_node)
+    {
+        return vm_node_fsms_.acquire()->size();
+    }
 
-    auto nonempty = true;
+    return svm_node_fsms_.acquire()->size();
+}
+
+auto Campaign::nodes() -> NodeRegistrar::Nodes
+{
+    auto nodes = NodeRegistrar::Nodes{};
 
-    for(const auto& n : nodes)
     {
-        auto nl = n->acquire();
+        auto vmns_lock = vm_node_fsms_.acquire();
 
-        const auto& st = nl->status;
+        std::for_each(vmns_lock->begin(),
+                      vmns_lock->end(),
+                      [&] (VMNodeFSM& nfsm)
+        {
+            nodes.emplace_back(nfsm->node());
+        });
+    }
 
-        if(st.test_case_count != 0 || st.trace_count != 0)
+    {
+        auto svmns_lock = svm_node_fsms_.acquire();
+
+        std::for_each(svmns_lock->begin(),
+                      svmns_lock->end(),
+                      [&] (SVMNodeFSM& nfsm)
         {
-            nonempty = false;
+            nodes.emplace_back(nfsm->node());
+        });
+    }
 
-            break;
+    return nodes;
+}
+
+/**
+ * @brief Takes all nodes from the campaign. Their FSMs are gone, along with any transfer
+ *        in flight, by the time this returns.
+ */
+auto Campaign::release_nodes() -> NodeRegistrar::Nodes
+{
+    auto nodes = this->nodes();
+
+    vm_node_fsms_.acquire()->clear();
+    svm_node_fsms_.acquire()->clear();
+
+    publish_nodes();
+
+    return nodes;
+}
+
+template <typename ActiveFlag, typename NodeFSMs>
+static auto release_drained_node_fsm(NodeFSMs* fsms) -> NodeRegistrar::Node
+{
+    // Never the first: for VM nodes, that's the one that brought in the guest data.
+    for(auto i = fsms->size(); i > 1; --i)
+    {
+        auto& nfsm = (*fsms)[i - 1];
+        auto node = nfsm->node();
+        auto status = node->acquire()->status;
+
+        if(!status.active &&
+           status.test_case_count == 0 &&
+           status.trace_count == 0 &&
+           !nfsm->template is_flag_active<ActiveFlag>())
+        {
+            fsms->erase(fsms->begin() + (i - 1));
+
+            return node;
+        }
+    }
+
+    return NodeRegistrar::Node{};
+}
+
+/**
+ * @brief Takes the most recently assigned node of 'type' that has nothing queued or in
+ *        progress from the campaign, as release_nodes() does. Tests and traces a busy node
+ *        holds are already marked as issued, so resetting it would lose them for good.
+ * @return null if every node of 'type' is busy.
+ */
+auto Campaign::release_drained_node(uint32_t type) -> NodeRegistrar::Node
+{
+    auto node = NodeRegistrar::Node{};
+
+    if(type == packet_type::cluster_request_vm_node)
+    {
+        auto lock = vm_node_fsms_.acquire();
+
+        node = release_drained_node_fsm<vm::flag::active>(lock.operator->());
+    }
+    else
+    {
+        auto lock = svm_node_fsms_.acquire();
+
+        node = release_drained_node_fsm<svm::flag::active>(lock.operator->());
+
+        // Traces placed with the node, but not yet handed to it, go to the nodes that remain.
+        if(node)
+        {
+            trace_pool_.remove_node(node->acquire()->status.id);
+        }
+    }
+
+    if(node)
+    {
+        publish_nodes();
+    }
+
+    return node;
+}
+
+auto Campaign::are_node_queues_empty() -> bool
+{
+    for(const auto& n : nodes())
+    {
+        const auto& st = n->acquire()->status;
+
+        if(st.test_case_count != 0 || st.trace_count != 0)
+        {
+            return false;
         }
     }
 
-    return nonempty;
+    return true;
 }
 
-auto DispatchFSM_::are_all_queues_empty() -> bool
+auto Campaign::are_all_queues_empty() -> bool
 {
     return
             are_node_queues_empty()
@@ -1891,27 +2456,18 @@ auto DispatchFSM_::are_all_queues_empty() -> bool
          && trace_pool_.count_next() == 0;
 }
 
-auto DispatchFSM_::are_nodes_inactive() -> bool
+auto Campaign::are_nodes_inactive() -> bool
 {
-    auto lock = node_registrar_.acquire();
-    auto& nodes = lock->nodes();
-
-    auto inactive = true;
-
-    for(const auto& n : nodes)
+    for(const auto& n : nodes())
     {
-        auto nl = n->acquire();
-
-        const auto& st = nl->status;
-
-        if(st.active)
+        if(n->acquire()->status.active)
         {
-            inactive = false;
-
-            break;
+            return false;
         }
     }
 
+    auto inactive = true;
+
     {
         auto vmns_lock = vm_node_fsms_.acquire();
 
@@ -1922,94 +2478,372 @@ auto DispatchFSM_::are_nodes_inactive() -> bool
             if(nfsm->is_flag_active<vm::flag::active>())
             {
                 inactive = false;
+            }
+        });
+    }
 
-                return;
+    {
+        auto svmns_lock = svm_node_fsms_.acquire();
+
+        std::for_each(svmns_lock->begin(),
+                      svmns_lock->end(),
+                      [&] (SVMNodeFSM& nfsm)
+        {
+            if(nfsm->is_flag_active<svm::flag::active>())
+            {
+                inactive = false;
             }
         });
     }
 
-    {
-        auto svmns_lock = svm_node_fsms_.acquire();
+    return inactive;
+}
+
+auto Campaign::is_converged() -> bool
+{
+    return
+               had_nodes_
+            && (first_trace_rxed_ || guest_data_rxed_)
+            && are_all_queues_empty()
+            && are_nodes_inactive();
+}
+
+auto Campaign::is_expired() -> bool
+{
+    auto elapsed_time_count = elapsed_time();
+    auto no_new_tb_time_count = no_new_tb_time();
+
+    auto converged = is_converged();
+    auto trace_exceeded = trace_pool_.count_all_unique() >= options_.test.interval.trace;
+    auto tc_exceeded = test_pool_.count_all() >= options_.test.interval.tc;
+    auto overall_time_exceeded = had_nodes_ && elapsed_time_count >= options_.test.interval.time;
+    auto no_new_tb_time_exceeded = had_nodes_ && no_new_tb_time_count >= options_.test.interval.new_inst_wait_time;
+
+    return
+               converged
+            || trace_exceeded
+            || tc_exceeded
+            || overall_time_exceeded
+            || no_new_tb_time_exceeded
+            ;
+}
+
+auto Campaign::write_target_log(const log::NodeError& ne,
+                                const fs::path& subdir) -> void
+{
+    auto p = root_ / log_dir_name / subdir;
+
+    {
+        auto i = 1u;
+
+        while(fs::exists(p / std::to_string(i)))
+        {
+            ++i;
+        }
+
+        p /= std::to_string(i);
+    }
+
+    fs::ofstream ofs{p};
+
+    if(!ofs.good())
+    {
+        BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{p.string()});
+    }
+
+    ofs << ne.log;
+}
+
+auto Campaign::publish_status() -> void
+{
+    status_->elapsed_ = elapsed_time();
+    status_->tests_left_ = test_pool_.count_next();
+    status_->tests_total_ = test_pool_.count_all();
+    status_->traces_left_ = trace_pool_.count_next();
+    status_->traces_total_ = trace_pool_.count_all_unique();
+
+    publish_nodes();
+}
+
+auto Campaign::publish_nodes() -> void
+{
+    auto counts = std::vector<NodeCounts>{};
+
+    for(const auto& node : nodes())
+    {
+        auto lock = node->acquire();
+
+        counts.push_back(NodeCounts{lock->type == packet_type::cluster_request_vm_node,
+                                    lock->status.test_case_count,
+                                    lock->status.trace_count});
+    }
+
+    status_->nodes_.acquire()->swap(counts);
+}
+
+auto Campaign::finish() -> void
+{
+    auto p = root_ / log_dir_name;
+
+    if(!fs::exists(p))
+    {
+        return;
+    }
+
+    auto finish_log = p / dispatch_log_finish_file_name;
+
+    fs::ofstream ofs{finish_log};
+
+    if(!ofs.good())
+    {
+        BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{finish_log.string()});
+    }
+
+    publish_status();
+    status_->display(ofs);
+
+    auto test_case_tree_log = p / dispatch_log_test_case_tree_file_name;
+    fs::ofstream tc_tree_ofs{test_case_tree_log};
+
+    if(!tc_tree_ofs.good())
+    {
+        BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{test_case_tree_log.string()});
+    }
+
+    test_pool_.write_log(tc_tree_ofs);
+}
+
+/**
+ * @brief Starts checkpointing under the campaign's root. When resuming, the pools are first
+ *        rebuilt from the checkpoint left there; a fresh snapshot then compacts it.
+ */
+auto Campaign::open_checkpoint() -> void
+{
+    test_pool_.journal_to(nullptr);
+    trace_pool_.journal_to(nullptr);
+
+    checkpoint_.reset(new Checkpoint{root_ / dispatch_checkpoint_dir_name});
+
+    if(!options_.resume.empty() && !resumed_)
+    {
+        auto snapshot = DispatchSnapshot{};
+        auto records = std::vector<CheckpointRecord>{};
+
+        if(checkpoint_->load(snapshot, records))
+        {
+            restore(snapshot, records);
+
+            resumed_ = true;
+        }
+    }
+
+    take_snapshot();
+
+    test_pool_.journal_to(checkpoint_.get());
+    trace_pool_.journal_to(checkpoint_.get());
+}
+
+auto Campaign::update_checkpoint() -> void
+{
+    if(!checkpoint_)
+    {
+        return;
+    }
+
+    auto elapsed = elapsed_time();
+
+    if(elapsed - checkpoint_snapshot_time_ >= checkpoint_snapshot_interval)
+    {
+        take_snapshot();
+    }
+    else if(elapsed - checkpoint_elapsed_time_ >= checkpoint_elapsed_interval)
+    {
+        auto r = CheckpointRecord{};
+        r.type = CheckpointRecord::elapsed;
+        r.a = elapsed;
+
+        checkpoint_->append(r);
+
+        checkpoint_elapsed_time_ = elapsed;
+    }
+}
+
+auto Campaign::take_snapshot() -> void
+{
+    auto snapshot = DispatchSnapshot{};
+
+    snapshot.elapsed = elapsed_time();
+    snapshot.test_pool = test_pool_.snapshot();
+    snapshot.trace_pool = trace_pool_.snapshot();
+    snapshot.explored_tbs.assign(explored_tbs_.begin(),
+                                 explored_tbs_.end());
+
+    checkpoint_->snapshot(snapshot);
+
+    checkpoint_snapshot_time_ = snapshot.elapsed;
+    checkpoint_elapsed_time_ = snapshot.elapsed;
+}
+
+auto Campaign::restore(const DispatchSnapshot& snapshot,
+                       const std::vector<CheckpointRecord>& records) -> void
+{
+    auto elapsed = snapshot.elapsed;
+
+    test_pool_.restore(snapshot.test_pool,
+                       records);
+    trace_pool_.restore(snapshot.trace_pool,
+                        records);
+
+    explored_tbs_.insert(snapshot.explored_tbs.begin(),
+                         snapshot.explored_tbs.end());
+
+    for(const auto& r : records)
+    {
+        if(r.type == CheckpointRecord::tbs_explored)
+        {
+            explored_tbs_.insert(r.tbs.begin(),
+                                 r.tbs.end());
+        }
+        else if(r.type == CheckpointRecord::elapsed)
+        {
+            elapsed = std::max(elapsed, r.a);
+        }
+    }
+
+    resumed_elapsed_ = elapsed; // The clocks start from there with the first node.
+    first_trace_rxed_ = true;
+}
 
-        std::for_each(svmns_lock->begin(),
-                      svmns_lock->end(),
-                      [&] (SVMNodeFSM& nfsm)
-        {
-            if(nfsm->is_flag_active<svm::flag::active>())
-            {
-                inactive = false;
+DispatchFSM_::DispatchFSM_()
+{
+}
 
-                return;
-            }
-        });
+DispatchFSM_::~DispatchFSM_()
+{
+    if(node_registrar_driver_thread_.joinable())
+    {
+        node_registrar_driver_thread_.join();
     }
+}
 
-    return inactive;
+auto DispatchFSM_::launch_node_registrar(Port master) -> void
+{
+    node_registrar_driver_thread_ =
+            boost::thread{NodeRegistrarDriver{master,
+                          node_registrar_,
+                          [this] (NodeRegistrar::Node& node) {
+        registered_nodes_.acquire()->emplace_back(node);
+    }}};
 }
 
-auto DispatchFSM_::is_converged() -> bool
+auto DispatchFSM_::add_campaign(const fs::path& root,
+                                const std::string& target,
+                                const fs::path& seeds) -> void
 {
-    return
-               are_all_queues_empty()
-            && are_nodes_inactive();
+    auto campaign = std::make_shared<Campaign>(options_,
+                                               root,
+                                               target,
+                                               seeds);
+
+    campaign->set_up_root_dir();
+    campaign->open_checkpoint();
+    campaign->publish_status();
+
+    status_reporter_.add(campaign->status_);
+    campaigns_.emplace_back(campaign);
 }
 
-auto DispatchFSM_::write_target_log(const log::NodeError& ne,
-                                    const fs::path& subdir) -> void
+auto DispatchFSM_::assign_node(Campaign& campaign,
+                               NodeRegistrar::Node& node) -> void
 {
-    auto p = root_ / log_dir_name / subdir;
+    register_node_fsm(node,
+                      options_,
+                      campaign.root_,
+                      campaign.vm_node_fsms_,
+                      campaign.svm_node_fsms_);
 
+    if(!campaign.had_nodes_)
     {
-        auto i = 1u;
+        campaign.had_nodes_ = true;
+        campaign.start_clocks();
+    }
 
-        while(fs::exists(p / std::to_string(i)))
-        {
-            ++i;
-        }
+    campaign.publish_nodes();
 
-        p /= std::to_string(i);
+    if(options_.mode.distributed &&
+       node->acquire()->type == packet_type::cluster_request_vm_node)
+    {
+        transmit_target(node,
+                        campaign.target_);
     }
+}
 
-    fs::ofstream ofs{p};
+/**
+ * @brief Fair share: idle nodes of 'type' go to the campaigns with the fewest, then nodes are
+ *        moved until no two campaigns differ by more than one. Moving a node resets it, so only
+ *        nodes that have drained are moved; the rest wait for a later poll.
+ */
+auto DispatchFSM_::balance_nodes(uint32_t type,
+                                 std::deque<NodeRegistrar::Node>& idle) -> void
+{
+    if(campaigns_.empty())
+    {
+        return;
+    }
 
-    if(!ofs.good())
+    auto by_count = [type](const CampaignPtr& lhs,
+                           const CampaignPtr& rhs)
     {
-        BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{p.string()});
+        return lhs->node_count(type) < rhs->node_count(type);
+    };
+
+    while(!idle.empty())
+    {
+        auto& fewest = *std::min_element(campaigns_.begin(),
+                                         campaigns_.end(),
+                                         by_count);
+
+        assign_node(*fewest,
+                    idle.front());
+
+        idle.pop_front();
     }
 
-    ofs << ne.log;
-}
+    for(;;)
+    {
+        auto fewest = std::min_element(campaigns_.begin(),
+                                       campaigns_.end(),
+                                       by_count);
+        auto most = std::max_element(campaigns_.begin(),
+                                     campaigns_.end(),
+                                     by_count);
 
+        if((*most)->node_count(type) < (*fewest)->node_count(type) + 2)
+        {
+            break;
+        }
 
-auto DispatchFSM_::set_update_time_last_new_tb(const GuestDataPostExec& data) -> void
-{
-    const vector<uint64_t>& current_new_tbs = data.m_new_captured_tbs;
+        auto node = (*most)->release_drained_node(type);
 
-    bool inserted = false;
-    for(vector<uint64_t>::const_iterator it = current_new_tbs.begin();
-            it != current_new_tbs.end(); ++it) {
-        if(explored_tbs_.insert(*it).second && !inserted)
+        if(!node)
         {
-            inserted = true;
+            break;
         }
-    }
 
-    if(inserted)
-    {
-        update_time_last_new_tb_ = std::chrono::system_clock::now();
+        transmit_reset(node);
 
-        cerr << "update_time_last_new_tb_ is updated\n";
+        assign_node(**fewest,
+                    node);
     }
 }
 
-auto DispatchFSM_::test_pool() -> TestPool&
+auto DispatchFSM_::was_idle() -> bool
 {
-    return test_pool_;
-}
+    auto idle = idle_;
 
-auto DispatchFSM_::trace_pool() -> TracePool&
-{
-    return trace_pool_;
+    idle_ = false;
+
+    return idle;
 }
 
 auto DispatchFSM_::store_config_file() -> void
@@ -2051,200 +2885,24 @@ auto DispatchFSM_::store_config_file() -> void
             boost::property_tree::xml_writer_make_settings<std::string>('\t', 1));
 }
 
+/**
+ * @brief Prepares the run's root. In distributed mode each target's campaign gets a directory
+ *        within it; in developer mode the lone campaign uses the root itself.
+ */
 auto DispatchFSM_::set_up_root_dir() -> void
 {
-    auto timestamp_root = root_.filename();
-
     if(options_.mode.distributed)
     {
-        auto target = fs::path{next_target_queue_.front()}.filename();
-
-        if(root_.parent_path().filename() == dispatch_root_dir_name)
-        {
-            store_config_file();
-
-            timestamp_root = root_.filename();
-            root_ /= target;
-        }
-        else
-        {
-            timestamp_root = root_.parent_path().filename();
-            root_ = root_.parent_path() / target;
-        }
-    }
-
-    auto create_dirs = [](const fs::path& root)
-    {
-        return [root](const std::vector<std::string>& v)
-        {
-            for(const auto& e : v)
-            {
-                auto d = root / e;
-                if(!fs::create_directories(d))
-                {
-                    BOOST_THROW_EXCEPTION(Exception{} << err::file_create{d.string()});
-                }
-            }
-        };
-    };
-
-    if(!fs::exists(root_))
-    {
-        auto create_root_dirs = create_dirs(root_);
-        auto create_log_dirs = create_dirs(root_ / log_dir_name);
-
-        create_root_dirs({dispatch_trace_dir_name,
-                          dispatch_test_case_dir_name,
-                          dispatch_profile_dir_name,
-                          dispatch_guest_data_dir_name});
-        create_log_dirs({dispatch_log_vm_dir_name,
-                         dispatch_log_svm_dir_name});
+        store_config_file();
     }
 
     auto last_symlink = fs::path{dispatch_root_dir_name} / dispatch_last_root_symlink;
 
     fs::remove(last_symlink);
-    fs::create_symlink(timestamp_root,
+    fs::create_symlink(root_.filename(),
                        last_symlink);
 }
 
-auto DispatchFSM_::display_status(std::ostream& os) -> void
-{
-    using namespace std;
-
-    system("clear");
-
-    os << setw(12) << "time (s)"
-         << "|"
-         << setw(12) << "tests left"
-         << "|"
-         << setw(12) << "traces left"
-         << "|";
-
-    {
-        auto count = 1u;
-        auto lock = node_registrar_.acquire();
-        for(const auto& node : lock->nodes())
-        {
-            auto tt = std::string{};
-
-            tt += to_string(count++);
-
-            if(node->acquire()->type == packet_type::cluster_request_vm_node)
-                tt += "-[vm]";
-            else
-                tt += "-[svm]";
-
-            tt += " tc/tr";
-
-            os << setw(14) << tt
-                 << "|";
-        }
-    }
-
-    os << endl;
-
-    auto disp_time = std::to_string(elapsed_time());
-
-    auto test = to_string(test_pool_.count_next()) +
-                 "/" +
-                 to_string(test_pool_.count_all());
-    auto trace = to_string(trace_pool_.count_next()) +
-                 "/" +
-                 to_string(trace_pool_.count_all_unique());
-
-    os << setw(12) << disp_time
-         << "|"
-         << setw(12) << test
-         << "|"
-         << setw(12) << trace
-         << "|";
-
-    {
-        auto lock = node_registrar_.acquire();
-        for(const auto& node : lock->nodes())
-        {
-            auto tt = std::string{};
-            auto lock = node->acquire();
-
-            tt += to_string(lock->status.test_case_count) +
-                  "/" +
-                  to_string(lock->status.trace_count);
-            os << setw(14) << tt
-                 << "|";
-        }
-    }
-
-    os << endl;
-}
-
-auto DispatchFSM_::write_test_pool_log(std::ostream& os) -> void
-{
-    test_pool_.write_log(os);
-}
-
-auto DispatchFSM_::write_statistics() -> void
-{
-    static auto prev_time = decltype(elapsed_time()){0};
-    static auto print_pg = true;
-    auto time = elapsed_time();
-    auto dir = root_ / dispatch_profile_dir_name;
-
-    if(time - prev_time >= options_.profile.interval)
-    {
-        prev_time = time;
-    }
-    else
-    {
-        return;
-    }
-
-    if(print_pg)
-    {
-        print_pg = false;
-
-        fs::ofstream ofs{dir / "stat.pg"};
-
-        ofs << R"(#!/usr/bin/gnuplot
-               reset
-               set terminal png
-
-               set title "Test cases and traces per second"
-               set grid
-               set key reverse Left outside
-               set style data linespoints
-
-               set ylabel "tcs/traces"
-
-               set xlabel "seconds"
-
-               plot "stat.dat" using 1:2 title "tc remaining", \
-               "" using 1:3 title "tc total", \
-               "" using 1:4 title "trace remaining", \
-               "" using 1:5 title "trace total"
-               #)";
-    }
-
-    fs::ofstream ofs{dir / "stat.dat"
-                    ,std::ios_base::app};
-
-    auto tc_left = test_pool_.count_next();
-    auto tc_total = test_pool_.count_all();
-    auto trace_left = trace_pool_.count_next();
-    auto trace_total = trace_pool_.count_all_unique();
-
-    ofs << time
-        << " "
-        << tc_left
-        << " "
-        << tc_total
-        << " "
-        << trace_left
-        << " "
-        << trace_total
-        << "\n";
-}
-
 auto DispatchFSM_::node_registrar() -> AtomicGuard<NodeRegistrar>&
 {
     return node_registrar_;
@@ -2283,7 +2941,16 @@ auto Dispatch::run() -> bool
     }
     else
     {
+        auto finished = AsyncTask::finished_count();
+
         dispatch_fsm_->process_event(fsm::poll{});
+
+        // No node moved: sleep until one of them replies rather than spinning over them.
+        if(dispatch_fsm_->was_idle())
+        {
+            AsyncTask::wait_for_finished(finished,
+                                         std::chrono::milliseconds{status_update_timeout});
+        }
     }
 
     return ret;
@@ -2362,26 +3029,36 @@ auto receive_trace(NodeRegistrar::Node& node,
 
     lock->server.write(pkinfo);
 
-    auto trace_name = std::string{};
+    auto manifest = TraceManifest{};
 
     read_serialized_binary(lock->server,
-                           trace_name,
+                           manifest,
                            packet_type::cluster_trace);
 
-    auto trace = traces_dir / trace_name;
+    auto store = ChunkStore{traces_dir / chunk_store_dir_name};
+    auto missing = store.missing(manifest);
+
+    pkinfo.type = packet_type::cluster_trace_chunks_request;
+
+    write_serialized_binary(lock->server,
+                            pkinfo,
+                            missing);
 
+    auto trace = traces_dir / manifest.name_;
+
+    if(!missing.empty())
     {
-        fs::ofstream ofs{trace,
-                         std::ios::out | std::ios::binary};
+        auto bundle = fs::path{trace}.replace_extension("chunks");
 
-        CRETE_EXCEPTION_ASSERT(ofs.good(),
-                               err::file_open_failed{trace.string()});
+        receive_bundle(lock->server,
+                       bundle);
 
-        read(lock->server,
-             ofs);
+        store.absorb(bundle);
     }
 
-//    restore_directory(trace);
+    // The pool holds the manifest; the contents stay in the store.
+    write_manifest(manifest,
+                   trace);
 
     return trace;
 }
@@ -2444,7 +3121,8 @@ auto receive_image_info(NodeRegistrar::Node& node) -> ImageInfo
 }
 
 auto transmit_trace(NodeRegistrar::Node& node,
-                    const fs::path& trace) -> void
+                    const fs::path& trace,
+                    const option::Trace& options) -> void
 {
     auto lock = node->acquire();
 
@@ -2452,21 +3130,60 @@ auto transmit_trace(NodeRegistrar::Node& node,
     pkinfo.id = lock->status.id;
     pkinfo.type = packet_type::cluster_trace;
 
-//    archive_directory(trace);
-
-    fs::ifstream ifs{trace,
-                     std::ios::in | std::ios::binary};
+    CRETE_EXCEPTION_ASSERT(fs::exists(trace),
+                           err::file_missing{trace.string()});
 
-    CRETE_EXCEPTION_ASSERT(ifs.good(),
-                           err::file_open_failed{trace.string()});
+    auto manifest = read_manifest(trace);
 
     write_serialized_binary(lock->server,
                             pkinfo,
-                            trace.filename().string());
+                            manifest);
 
-    write(lock->server,
-          ifs,
-          default_chunk_size);
+    auto missing = std::vector<ChunkID>{};
+
+    read_serialized_binary(lock->server,
+                           missing,
+                           packet_type::cluster_trace_chunks_request);
+
+    if(!missing.empty())
+    {
+        auto store = ChunkStore{trace.parent_path() / chunk_store_dir_name};
+        auto bundle = fs::path{trace}.replace_extension("chunks");
+
+        store.bundle(missing,
+                     bundle);
+
+        transmit_bundle(lock->server,
+                        bundle,
+                        options.compress ? options.compress_format : std::string{},
+                        options.compress_level);
+    }
+}
+
+/**
+ * @brief Estimated cost of replaying a trace under KLEE: the bytes of its captured TCG
+ *        (a proxy for its TB count) and of its CPU-state and memory sync tables.
+ */
+auto estimate_replay_cost(const TraceManifest& manifest) -> uint64_t
+{
+    auto cost = uint64_t{0};
+    auto total = uint64_t{0};
+
+    for(const auto& file : manifest.files_)
+    {
+        const auto name = fs::path{file.path_}.filename().string();
+
+        if(boost::starts_with(name, "dump_tcg_llvm_offline") ||
+           boost::starts_with(name, "dump_sync_cpu_states") ||
+           boost::starts_with(name, "dump_new_sync_memos"))
+        {
+            cost += file.size_;
+        }
+
+        total += file.size_;
+    }
+
+    return std::max<uint64_t>(cost ? cost : total, 1);
 }
 
 auto transmit_tests(NodeRegistrar::Node& node,
@@ -2495,6 +3212,26 @@ auto transmit_commencement(NodeRegistrar::Node& node) -> void
                        packet_type::cluster_commence);
 }
 
+auto transmit_reset(NodeRegistrar::Node& node) -> void
+{
+    auto lock = node->acquire();
+    lock->server.write(lock->status.id,
+                       packet_type::cluster_reset);
+}
+
+auto transmit_target(NodeRegistrar::Node& node,
+                     const std::string& target) -> void
+{
+    auto lock = node->acquire();
+    auto pkinfo = PacketInfo{0,0,0};
+    pkinfo.id = lock->status.id;
+    pkinfo.type = packet_type::cluster_next_target;
+
+    write_serialized_binary(lock->server,
+                            pkinfo,
+                            target);
+}
+
 auto transmit_image_info(NodeRegistrar::Node& node,
                          const ImageInfo& ii) -> void
 {
@@ -2551,7 +3288,8 @@ auto register_node_fsm(NodeRegistrar::Node& node,
     {
         auto fsm = std::make_shared<svm::NodeFSM>();
         fsm->start();
-        fsm->process_event(svm::start{node});
+        fsm->process_event(svm::start{node,
+                                      options.trace});
         svm_node_fsms.acquire()->emplace_back(fsm);
         break;
     }
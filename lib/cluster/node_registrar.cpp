@@ -67,6 +67,10 @@ auto NodeRegistrarDriver::operator()() -> void
 
 auto NodeRegistrarDriver::run() -> void
 {
+    // One acceptor for the lifetime of the driver, so the port is never rebound and
+    // there's no TIME_WAIT to sit out between registrations.
+    Server registrar_server{master_port_};
+
     while(!shutdown_)
     {
         std::cout << "[CRETE] Awaiting connection on '"
@@ -76,19 +80,14 @@ auto NodeRegistrarDriver::run() -> void
                   << "' ..."
                   << std::endl;
 
-        connect();
+        connect(registrar_server);
 
-        // The port may be in a TIME_WAIT state - waiting for TCP to relay back that it's
-        // closed the socket on the other side as well. *Guessing* 1s will be sufficient.
-        // Wait for the next connection attempt.
-        boost::this_thread::sleep_for(boost::chrono::seconds{1});
+        registrar_server.close_connection();
     }
 }
 
-auto NodeRegistrarDriver::connect() -> void
+auto NodeRegistrarDriver::connect(Server& registrar_server) -> void
 {
-    Server registrar_server{master_port_};
-
     registrar_server.open_connection_wait();
 
     auto pkinfo = registrar_server.read();
@@ -175,6 +174,37 @@ auto poll(NodeRegistrar::Node& node) -> NodeStatus
     return status;
 }
 
+auto poll_update(NodeRegistrar::Node& node,
+                 uint32_t timeout) -> NodeStatus
+{
+    Server* server = nullptr;
+    {
+        auto lock = node->acquire();
+
+        auto pkinfo = PacketInfo{lock->status.id,
+                                 0,
+                                 packet_type::cluster_status_update_request};
+
+        write_serialized_binary(lock->server,
+                                pkinfo,
+                                timeout);
+
+        server = &lock->server;
+    }
+
+    // The node may hold the reply back for up to 'timeout', so the reply is read without the lock;
+    // status displays and the like need the node in the meantime. Only the caller talks to the node
+    // until the reply arrives.
+    cluster::NodeStatus status;
+    read_serialized_binary(*server,
+                           status,
+                           packet_type::cluster_status);
+
+    node->acquire()->status = status;
+
+    return status;
+}
+
 } // namespace cluster
 } // namespace crete
 
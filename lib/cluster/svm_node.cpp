@@ -1,6 +1,7 @@
 #include <crete/cluster/svm_node.h>
 #include <crete/exception.h>
 #include <crete/cluster/common.h>
+#include <crete/cluster/chunk_store.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -23,7 +24,7 @@ namespace cluster
 SVMNode::SVMNode(node::option::SVMNode node_options)
     : Node(packet_type::cluster_request_svm_node)
     , node_options_(node_options)
-
+    , chunk_cache_(svm_chunk_cache_bytes)
 {
     if(node_options_.svm.count < 1)
     {
@@ -73,6 +74,11 @@ auto SVMNode::poll() -> void
             if(have_trace())
             {
                 auto t = pop_trace();
+
+                // Built from the chunk store only now, so queued traces cost no more than their manifests.
+                // The trace directory then holds its data: the chunks are only kept for later traces.
+                materialize(t);
+
                 svm->process_event(ev::next_trace{t});
 
                 std::ofstream ofs{"trace-seq.txt", std::ios::app};
@@ -101,6 +107,33 @@ auto SVMNode::traces_directory() const -> fs::path
     return fs::path{svm_working_dir_name};
 }
 
+auto SVMNode::retain_chunks(const TraceManifest& manifest) -> void
+{
+    chunk_cache_.retain(manifest);
+}
+
+/**
+ * @brief Unpins the chunks of 'manifest', and drops from the store those the cache evicts.
+ */
+auto SVMNode::release_chunks(const TraceManifest& manifest) -> void
+{
+    auto store = ChunkStore{traces_directory() / chunk_store_dir_name};
+
+    store.remove(chunk_cache_.release(manifest));
+}
+
+/**
+ * @brief Rebuilds 'trace' from the chunk store and releases its chunks.
+ */
+auto SVMNode::materialize(const boost::filesystem::path& trace) -> void
+{
+    auto store = ChunkStore{traces_directory() / chunk_store_dir_name};
+    auto manifest = read_manifest(trace);
+
+    store.materialize(trace);
+    release_chunks(manifest);
+}
+
 auto SVMNode::start_FSMs() -> void
 {
     using namespace node::svm;
@@ -159,6 +192,15 @@ auto SVMNode::reset() -> void
         svm->process_event(ev::terminate{});
     }
 
+    // Queued traces go with the reset. Their chunks stay cached, for traces still to come.
+    while(have_trace())
+    {
+        auto trace = pop_trace();
+
+        release_chunks(read_manifest(trace));
+        fs::remove(trace);
+    }
+
     Node::reset();
 
     svms_.clear();
@@ -197,35 +239,57 @@ auto receive_trace(AtomicGuard<SVMNode>& node,
 {
     node.acquire()->active(true);
 
-    auto trace_name = std::string{};
+    auto manifest = TraceManifest{};
 
     read_serialized_binary(sbuf,
-                           trace_name);
+                           manifest);
 
-    auto trace = node.acquire()->traces_directory() / trace_name;
+    auto traces_dir = node.acquire()->traces_directory();
+    auto store = ChunkStore{traces_dir / chunk_store_dir_name};
+    auto missing = std::vector<ChunkID>{};
 
     {
-        fs::ofstream ofs{trace,
-                         std::ios::out | std::ios::binary};
-
-        CRETE_EXCEPTION_ASSERT(ofs.good(),
-                               err::file_open_failed{trace.string()});
+        auto lock = node.acquire();
 
-        read(client,
-             ofs);
+        // Before looking, so what's found isn't dropped by the node in the meantime.
+        lock->retain_chunks(manifest);
+        missing = store.missing(manifest);
     }
 
+    auto trace = traces_dir / manifest.name_;
+
     try
     {
-        restore_directory(trace);
+        auto pkinfo = PacketInfo{node.acquire()->id(),
+                                 0,
+                                 packet_type::cluster_trace_chunks_request};
+
+        write_serialized_binary(client,
+                                pkinfo,
+                                missing);
+
+        if(!missing.empty())
+        {
+            auto bundle = fs::path{trace}.replace_extension("chunks");
+
+            receive_bundle(client,
+                           bundle);
+
+            store.absorb(bundle);
+        }
+
+        write_manifest(manifest,
+                       trace);
     }
-    catch(std::exception& e)
+    catch(...)
     {
-        std::cerr << boost::diagnostic_information(e) << std::endl;
-        assert(0 && "exception raised while restoring trace"); // TODO: properly propagate exception.
+        // The trace won't be queued, so nothing else will release what it retained.
+        node.acquire()->release_chunks(manifest);
+
+        throw;
     }
 
-    node.acquire()->push(trace);
+    node.acquire()->push(trace); // Materialized when popped for execution.
 }
 
 } // namespace cluster
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <limits>
 #include <stdexcept>
 
 #include <boost/filesystem.hpp>
@@ -16,7 +17,27 @@ namespace crete
 namespace cluster
 {
 
-const static uint64_t BASE_TEST_CACHE_SIZE = 200;
+// Budget for base tests held in memory; the rest are re-read from "test-case-base-cache" on demand.
+const static uint64_t BASE_TEST_CACHE_BYTES = 256 * 1024 * 1024;
+
+// Waiting this many issued tests is worth one new TB to a group of the COVERAGE strategy.
+const static double COVERAGE_AGING_TICKS = 64.0;
+
+// Non-patch tests (seeds and initial tests) have no base trace; they form one group, served first.
+const static TestCaseIssueIndex COVERAGE_SEED_GROUP = std::numeric_limits<TestCaseIssueIndex>::max();
+
+// Approximate memory held by a test case, dominated by its elements.
+static uint64_t estimate_tc_bytes(const TestCase& tc)
+{
+    uint64_t bytes = sizeof(TestCase);
+
+    for(const auto& e : tc.get_elements())
+    {
+        bytes += sizeof(TestCaseElement) + e.name.size() + e.data.size();
+    }
+
+    return bytes;
+}
 
 bool TestPriority::operator() (const TestCase& lhs, const TestCase& rhs) const
 {
@@ -38,11 +59,243 @@ bool TestPriority::operator() (const TestCase& lhs, const TestCase& rhs) const
   }
 }
 
-TestPool::TestPool(const fs::path& root)
+auto to_test_sched_strat(const std::string& name) -> TestSchedStrat
+{
+    if(name == "fifo")
+        return FIFO;
+    if(name == "bfs")
+        return BFS;
+    if(name == "coverage")
+        return COVERAGE;
+
+    BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{name}
+                                      << err::parse{"test.priority"});
+}
+
+auto CoverageQueue::group_of(const TestCase& tc) -> TestCaseIssueIndex
+{
+    return tc.is_test_patch() ? tc.get_base_tc_issue_index() : COVERAGE_SEED_GROUP;
+}
+
+auto CoverageQueue::push(const TestCase& tc) -> void
+{
+    TestCaseIssueIndex base = group_of(tc);
+
+    auto it = groups_.find(base);
+
+    if(it == groups_.end())
+    {
+        it = groups_.insert(std::make_pair(base, Group{})).first;
+        it->second.since = tick_;
+        it->second.heap_pos = heap_.size();
+
+        heap_.push_back(base);
+    }
+
+    it->second.tests.push(tc);
+    ++size_;
+
+    sift_up(it->second.heap_pos);
+}
+
+auto CoverageQueue::pop() -> TestCase
+{
+    assert(!heap_.empty());
+
+    TestCaseIssueIndex base = heap_.front();
+    Group& group = groups_.at(base);
+
+    TestCase tc = group.tests.top();
+    group.tests.pop();
+    --size_;
+    ++tick_;
+
+    if(group.tests.empty())
+    {
+        swap_at(0, heap_.size() - 1);
+        heap_.pop_back();
+        groups_.erase(base);
+
+        if(!heap_.empty())
+            sift_down(0);
+    }
+    else
+    {
+        ++group.issued;
+        group.since = tick_;
+
+        update(base);
+    }
+
+    return tc;
+}
+
+// Records the new TBs found by the trace of test 'base'; its patches, queued or not, are keyed by it.
+auto CoverageQueue::credit(TestCaseIssueIndex base, uint64_t new_tb_count) -> void
+{
+    new_tbs_[base] = new_tb_count;
+
+    if(groups_.find(base) != groups_.end())
+        update(base);
+}
+
+auto CoverageQueue::empty() const -> bool
+{
+    return size_ == 0;
+}
+
+auto CoverageQueue::size() const -> size_t
+{
+    return size_;
+}
+
+auto CoverageQueue::contents() const -> std::vector<TestCase>
+{
+    std::vector<TestCase> tcs;
+
+    for(boost::unordered_map<TestCaseIssueIndex, Group>::const_iterator it = groups_.begin();
+        it != groups_.end(); ++it)
+    {
+        Tests tests = it->second.tests;
+
+        for(; !tests.empty(); tests.pop())
+        {
+            tcs.push_back(tests.top());
+        }
+    }
+
+    return tcs;
+}
+
+auto CoverageQueue::credits() const -> std::vector<std::pair<uint64_t, uint64_t> >
+{
+    return std::vector<std::pair<uint64_t, uint64_t> >(new_tbs_.begin(), new_tbs_.end());
+}
+
+auto CoverageQueue::groups() const -> std::vector<CoverageGroupSnapshot>
+{
+    std::vector<CoverageGroupSnapshot> gs;
+
+    for(boost::unordered_map<TestCaseIssueIndex, Group>::const_iterator it = groups_.begin();
+        it != groups_.end(); ++it)
+    {
+        CoverageGroupSnapshot g;
+        g.base = it->first;
+        g.issued = it->second.issued;
+        g.since = it->second.since;
+
+        gs.push_back(g);
+    }
+
+    return gs;
+}
+
+auto CoverageQueue::tick() const -> uint64_t
+{
+    return tick_;
+}
+
+// Puts back the service and age of the queued groups, as of a checkpoint, then reorders the heap.
+auto CoverageQueue::restore(uint64_t tick,
+                            const boost::unordered_map<TestCaseIssueIndex, CoverageGroupSnapshot>& groups) -> void
+{
+    tick_ = tick;
+
+    for(boost::unordered_map<TestCaseIssueIndex, Group>::iterator it = groups_.begin();
+        it != groups_.end(); ++it)
+    {
+        boost::unordered_map<TestCaseIssueIndex, CoverageGroupSnapshot>::const_iterator g = groups.find(it->first);
+
+        if(g != groups.end())
+        {
+            it->second.issued = g->second.issued;
+            it->second.since = g->second.since;
+        } else {
+            it->second.issued = 0;
+            it->second.since = tick;
+        }
+    }
+
+    for(size_t pos = heap_.size() / 2; pos > 0; --pos)
+    {
+        sift_down(pos - 1);
+    }
+}
+
+auto CoverageQueue::key(TestCaseIssueIndex base) const -> double
+{
+    if(base == COVERAGE_SEED_GROUP)
+        return std::numeric_limits<double>::infinity();
+
+    const Group& group = groups_.at(base);
+
+    boost::unordered_map<TestCaseIssueIndex, uint64_t>::const_iterator it = new_tbs_.find(base);
+    double new_tbs = it == new_tbs_.end() ? 0.0 : static_cast<double>(it->second);
+
+    // Every group ages at the same rate, so comparing waits is comparing 'since'.
+    return new_tbs / (1 + group.issued) - group.since / COVERAGE_AGING_TICKS;
+}
+
+auto CoverageQueue::update(TestCaseIssueIndex base) -> void
+{
+    size_t pos = groups_.at(base).heap_pos;
+
+    sift_up(pos);
+    sift_down(groups_.at(base).heap_pos);
+}
+
+auto CoverageQueue::sift_up(size_t pos) -> void
+{
+    while(pos > 0)
+    {
+        size_t parent = (pos - 1) / 2;
+
+        if(!(key(heap_[parent]) < key(heap_[pos])))
+            break;
+
+        swap_at(parent, pos);
+        pos = parent;
+    }
+}
+
+auto CoverageQueue::sift_down(size_t pos) -> void
+{
+    for(;;)
+    {
+        size_t largest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+
+        if(left < heap_.size() && key(heap_[largest]) < key(heap_[left]))
+            largest = left;
+        if(right < heap_.size() && key(heap_[largest]) < key(heap_[right]))
+            largest = right;
+
+        if(largest == pos)
+            break;
+
+        swap_at(pos, largest);
+        pos = largest;
+    }
+}
+
+auto CoverageQueue::swap_at(size_t lhs, size_t rhs) -> void
+{
+    std::swap(heap_[lhs], heap_[rhs]);
+
+    groups_.at(heap_[lhs]).heap_pos = lhs;
+    groups_.at(heap_[rhs]).heap_pos = rhs;
+}
+
+TestPool::TestPool(const fs::path& root,
+                   TestSchedStrat strat)
     : root_(root)
     ,tc_count_(0)
-    ,next_(TestPriority(BFS))
-    ,m_duplicated_tc_count(0) {}
+    ,strat_(strat)
+    ,next_(TestPriority(strat == COVERAGE ? BFS : strat))
+    ,base_tc_cache_bytes_(0)
+    ,m_duplicated_tc_count(0)
+    ,checkpoint_(NULL) {}
 
 auto TestPool::next() -> boost::optional<TestCase>
 {
@@ -50,10 +303,29 @@ auto TestPool::next() -> boost::optional<TestCase>
     assert(!ret);
 
     // XXX: Iterate until a non-duplicate test case is found
-    while(!next_.empty() && !ret)
+    while(count_next() > 0 && !ret)
     {
-        ret = get_complete_tc(next_.top());
-        next_.pop();
+        TestCase tc;
+
+        if(strat_ == COVERAGE)
+        {
+            tc = coverage_next_.pop();
+        } else {
+            tc = next_.top();
+            next_.pop();
+        }
+
+        ret = get_complete_tc(tc);
+
+        if(checkpoint_)
+        {
+            CheckpointRecord r;
+            r.type = CheckpointRecord::test_popped;
+            r.fp = content_fingerprint(tc);
+            r.a = ret ? 0 : 1;
+
+            journal(r);
+        }
     }
 
     return ret;
@@ -64,16 +336,16 @@ auto TestPool::next() -> boost::optional<TestCase>
 // the target exec under test
 auto TestPool::insert_initial_tc_from_config(const TestCase& tc) -> bool
 {
-    assert(next_.empty());
+    assert(count_next() == 0);
     assert(tc_count_ == 0);
 
-    next_.push(tc);
+    enqueue(tc);
     return true;
 }
 
 auto TestPool::insert_initial_tcs(const std::vector<TestCase>& tcs) -> void
 {
-    assert(next_.empty());
+    assert(count_next() == 0);
     assert(tc_count_ == 0);
 
     for(const auto& tc : tcs)
@@ -88,7 +360,8 @@ auto TestPool::insert(const std::vector<TestCase>& tcs) -> void
     if(tc_count_ == 0)
     {
         assert(!tcs.front().is_test_patch());
-        write_test_case(tcs.front(), root_ / "test-case" / std::to_string(++tc_count_));
+        count_tc();
+        write_test_case(tcs.front(), root_ / "test-case" / std::to_string(tc_count_));
     }
 
     for(const auto& tc : tcs)
@@ -105,6 +378,23 @@ auto TestPool::insert(const std::vector<TestCase>& tcs) -> void
     }
 }
 
+// Number of TBs first covered by the trace of test 'tc_issue_index'; only the COVERAGE strategy uses it.
+auto TestPool::credit_coverage(TestCaseIssueIndex tc_issue_index,
+                               uint64_t new_tb_count) -> void
+{
+    if(strat_ == COVERAGE)
+    {
+        coverage_next_.credit(tc_issue_index, new_tb_count);
+
+        CheckpointRecord r;
+        r.type = CheckpointRecord::coverage_credited;
+        r.a = tc_issue_index;
+        r.b = new_tb_count;
+
+        journal(r);
+    }
+}
+
 auto TestPool::count_all() const -> size_t
 {
     return tc_count_;
@@ -112,7 +402,7 @@ auto TestPool::count_all() const -> size_t
 
 auto TestPool::count_next() const -> size_t
 {
-    return next_.size();
+    return strat_ == COVERAGE ? coverage_next_.size() : next_.size();
 }
 
 auto TestPool::write_log(std::ostream& os) -> void
@@ -120,39 +410,238 @@ auto TestPool::write_log(std::ostream& os) -> void
     os << "duplicated tc count from all_: " << m_duplicated_tc_count << endl;
 }
 
+auto TestPool::journal_to(Checkpoint* checkpoint) -> void
+{
+    checkpoint_ = checkpoint;
+}
+
+auto TestPool::snapshot() const -> TestPoolSnapshot
+{
+    TestPoolSnapshot s;
+
+    s.tc_count = tc_count_;
+    s.duplicated_tc_count = m_duplicated_tc_count;
+    s.issued.assign(issued_tc_hash_pool_.begin(), issued_tc_hash_pool_.end());
+    s.coverage_credits = coverage_next_.credits();
+    s.coverage_groups = coverage_next_.groups();
+    s.coverage_tick = coverage_next_.tick();
+
+    if(strat_ == COVERAGE)
+    {
+        s.next = coverage_next_.contents();
+    } else {
+        for(TestQueue q = next_; !q.empty(); q.pop())
+        {
+            s.next.push_back(q.top());
+        }
+    }
+
+    return s;
+}
+
+// Rebuilds the pool from a snapshot and the journal that follows it. Queued tests are matched
+// to later pops by content, so the queue needn't be rebuilt in its original order.
+auto TestPool::restore(const TestPoolSnapshot& snapshot,
+                       const std::vector<CheckpointRecord>& records) -> void
+{
+    assert(count_next() == 0);
+    assert(!checkpoint_);
+
+    boost::unordered_multimap<TestCaseFingerprint, TestCase> pending;
+
+    // COVERAGE groups as CoverageQueue::push() and pop() leave them, replayed alongside 'pending'.
+    boost::unordered_map<TestCaseIssueIndex, CoverageGroupSnapshot> groups;
+    boost::unordered_map<TestCaseIssueIndex, uint64_t> group_sizes;
+    uint64_t tick = snapshot.coverage_tick;
+
+    tc_count_ = snapshot.tc_count;
+    m_duplicated_tc_count = snapshot.duplicated_tc_count;
+    issued_tc_hash_pool_.insert(snapshot.issued.begin(), snapshot.issued.end());
+
+    for(const auto& c : snapshot.coverage_credits)
+    {
+        coverage_next_.credit(c.first, c.second);
+    }
+
+    for(const auto& g : snapshot.coverage_groups)
+    {
+        groups[g.base] = g;
+    }
+
+    for(const auto& tc : snapshot.next)
+    {
+        pending.insert(std::make_pair(content_fingerprint(tc), tc));
+        ++group_sizes[CoverageQueue::group_of(tc)];
+    }
+
+    for(const auto& r : records)
+    {
+        switch(r.type)
+        {
+        case CheckpointRecord::test_pushed:
+        {
+            TestCaseIssueIndex base = CoverageQueue::group_of(r.tc);
+
+            pending.insert(std::make_pair(content_fingerprint(r.tc), r.tc));
+
+            if(group_sizes[base]++ == 0)
+            {
+                CoverageGroupSnapshot g;
+                g.base = base;
+                g.since = tick;
+
+                groups[base] = g;
+            }
+            break;
+        }
+        case CheckpointRecord::test_popped:
+        {
+            auto it = pending.find(r.fp);
+
+            ++tick;
+
+            if(it != pending.end())
+            {
+                TestCaseIssueIndex base = CoverageQueue::group_of(it->second);
+
+                if(--group_sizes[base] == 0)
+                {
+                    groups.erase(base);
+                } else {
+                    ++groups[base].issued;
+                    groups[base].since = tick;
+                }
+
+                pending.erase(it);
+            }
+            if(r.a)
+                ++m_duplicated_tc_count;
+            break;
+        }
+        case CheckpointRecord::test_issued:
+            issued_tc_hash_pool_.insert(r.fp);
+            break;
+        case CheckpointRecord::test_counted:
+            tc_count_ = r.a;
+            break;
+        case CheckpointRecord::coverage_credited:
+            coverage_next_.credit(r.a, r.b);
+            break;
+        default:
+            break;
+        }
+    }
+
+    for(const auto& p : pending)
+    {
+        enqueue(p.second);
+    }
+
+    if(strat_ == COVERAGE)
+    {
+        coverage_next_.restore(tick, groups);
+    }
+}
+
 auto TestPool::insert_internal(const TestCase& tc) -> bool
 {
-    next_.push(tc);
+    enqueue(tc);
+    count_tc();
 
-    write_test_case(tc, root_ / "test-case" / std::to_string(++tc_count_));
+    write_test_case(tc, root_ / "test-case" / std::to_string(tc_count_));
 
     return true;
 }
 
-auto TestPool::insert_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator
+auto TestPool::enqueue(const TestCase& tc) -> void
 {
-    issued_tc_hash_pool_.insert(tc.get_elements());
+    if(strat_ == COVERAGE)
+    {
+        coverage_next_.push(tc);
+    } else {
+        next_.push(tc);
+    }
 
-    if(base_tc_cache_.size() >= BASE_TEST_CACHE_SIZE)
+    if(checkpoint_)
     {
-        base_tc_cache_.clear();
+        CheckpointRecord r;
+        r.type = CheckpointRecord::test_pushed;
+        r.tc = tc;
+
+        journal(r);
     }
+}
+
+auto TestPool::count_tc() -> void
+{
+    ++tc_count_;
 
-    std::pair<BaseTestCache_ty::const_iterator, bool> it =
-            base_tc_cache_.insert(std::make_pair(tc.get_issue_index(), tc));
+    CheckpointRecord r;
+    r.type = CheckpointRecord::test_counted;
+    r.a = tc_count_;
 
-    if(!it.second)
+    journal(r);
+}
+
+auto TestPool::journal(const CheckpointRecord& record) -> void
+{
+    if(checkpoint_)
+    {
+        checkpoint_->append(record);
+    }
+}
+
+auto TestPool::insert_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator
+{
+    if(issued_tc_hash_pool_.insert(fingerprint(tc.get_elements())).second)
+    {
+        CheckpointRecord r;
+        r.type = CheckpointRecord::test_issued;
+        r.fp = fingerprint(tc.get_elements());
+
+        journal(r);
+    }
+
+    BaseTestCache_ty::iterator existing = base_tc_cache_.find(tc.get_issue_index());
+
+    if(existing != base_tc_cache_.end())
     {
         fprintf(stderr, "TestPool::insert_base_tc() error: duplicate issue_index in base_tc_cache_ (issue index = %lu),\n",
-                it.first->first);
+                existing->first);
 
-        write_test_case(it.first->second, root_ / "test-case-base-error" / "existing_based_tc.bin" );
+        write_test_case(existing->second.tc, root_ / "test-case-base-error" / "existing_based_tc.bin" );
         write_test_case(tc, root_ / "test-case-base-error" / "duplicate_base_tc.bin" );
 
         assert(0);
+
+        return existing;
     }
 
-    return it.first;
+    uint64_t bytes = estimate_tc_bytes(tc);
+
+    evict_base_tc(bytes);
+
+    base_tc_lru_.push_front(tc.get_issue_index());
+    base_tc_cache_bytes_ += bytes;
+
+    BaseTestCacheEntry entry = {tc, bytes, base_tc_lru_.begin()};
+
+    return base_tc_cache_.insert(std::make_pair(tc.get_issue_index(), entry)).first;
+}
+
+// Drops least recently used base tests until 'incoming_bytes' more fit in the budget.
+auto TestPool::evict_base_tc(uint64_t incoming_bytes) -> void
+{
+    while(!base_tc_lru_.empty() &&
+          base_tc_cache_bytes_ + incoming_bytes > BASE_TEST_CACHE_BYTES)
+    {
+        BaseTestCache_ty::iterator it = base_tc_cache_.find(base_tc_lru_.back());
+        assert(it != base_tc_cache_.end());
+
+        base_tc_cache_bytes_ -= it->second.bytes;
+        base_tc_cache_.erase(it);
+        base_tc_lru_.pop_back();
+    }
 }
 
 auto TestPool::get_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator
@@ -171,6 +660,8 @@ auto TestPool::get_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterat
         assert(base_tc.get_issue_index() == tc_issue_index);
 
         base_tc_it = insert_base_tc(base_tc);
+    } else {
+        base_tc_lru_.splice(base_tc_lru_.begin(), base_tc_lru_, base_tc_it->second.lru_it);
     }
 
     return base_tc_it;
@@ -186,12 +677,20 @@ auto TestPool::get_complete_tc(const TestCase& patch_tc) -> boost::optional<Test
         BaseTestCache_ty::const_iterator base_tc = get_base_tc(patch_tc);
         assert(base_tc != base_tc_cache_.end());
 
-        complete_tc = generate_complete_tc_from_patch(patch_tc, base_tc->second);
+        complete_tc = generate_complete_tc_from_patch(patch_tc, base_tc->second.tc);
     }
 
     // check whether the new complete_tc duplicates with issued tcs
-    if(issued_tc_hash_pool_.insert(complete_tc.get_elements()).second)
+    TestCaseFingerprint fp = fingerprint(complete_tc.get_elements());
+
+    if(issued_tc_hash_pool_.insert(fp).second)
     {
+        CheckpointRecord r;
+        r.type = CheckpointRecord::test_issued;
+        r.fp = fp;
+
+        journal(r);
+
         complete_tc.set_issue_index(issued_tc_hash_pool_.size());
         return boost::optional<TestCase>{complete_tc};
     } else {
@@ -24,9 +24,13 @@ namespace cluster
 {
 
 TracePool::TracePool(const option::Dispatch& options)
-    : options_(options), trace_count_(0) {}
+    : options_(options), trace_count_(0), checkpoint_(nullptr) {}
 
-auto TracePool::insert(const TracePath& trace) -> bool
+/**
+ * @param cost estimated cost of replaying the trace; see estimate_replay_cost().
+ */
+auto TracePool::insert(const TracePath& trace,
+                       uint64_t cost) -> bool
 {
     // TODO: xxx disabled as a part of cleanup for transmitting traces
 //    if(options_.trace.print_elf_info)
@@ -35,22 +39,116 @@ auto TracePool::insert(const TracePath& trace) -> bool
 //    }
 
     ++trace_count_;
-    next_.push_front(trace);
+
+    if(checkpoint_)
+    {
+        auto r = CheckpointRecord{};
+        r.type = CheckpointRecord::trace_inserted;
+        r.path = trace.string();
+        r.a = cost;
+
+        checkpoint_->append(r);
+    }
+
+    auto entry = QueuedTrace{trace, cost};
+
+    if(node_queues_.empty())
+    {
+        next_.push_front(entry);
+
+        return true;
+    }
+
+    auto least = std::min_element(node_queues_.begin(),
+                                  node_queues_.end(),
+                                  [this](const std::pair<const NodeID, NodeQueue>& lhs,
+                                         const std::pair<const NodeID, NodeQueue>& rhs)
+    {
+        return load(lhs.second) < load(rhs.second);
+    });
+
+    least->second.local.push_back(entry);
 
     return true;
 }
 
-auto TracePool::next() -> optional<TracePath>
+/**
+ * @param node the SVM node asking for a trace.
+ * @param queued_on_node traces the node reports as queued, i.e., handed but not yet started.
+ * @param replaying whether the node reports a trace in progress.
+ */
+auto TracePool::next(NodeID node,
+                     uint32_t queued_on_node,
+                     bool replaying) -> optional<TracePath>
+{
+    auto& nq = node_queues_[node];
+
+    // Handed traces that the node has since finished no longer count against it. The one
+    // it started last is still being replayed while the node is active.
+    auto outstanding = static_cast<std::size_t>(queued_on_node) + (replaying ? 1 : 0);
+
+    if(nq.handed.size() > outstanding)
+    {
+        nq.handed.resize(outstanding);
+    }
+
+    auto entry = optional<QueuedTrace>{};
+
+    if(!nq.local.empty())
+    {
+        entry = nq.local.front();
+        nq.local.pop_front();
+    }
+    else if(!next_.empty())
+    {
+        entry = next_.back();
+        next_.pop_back();
+    }
+    else
+    {
+        entry = steal(node);
+    }
+
+    if(!entry)
+    {
+        return optional<TracePath>{};
+    }
+
+    nq.handed.push_front(entry->cost);
+
+    if(checkpoint_)
+    {
+        auto r = CheckpointRecord{};
+        r.type = CheckpointRecord::trace_taken;
+        r.path = entry->trace.string();
+
+        checkpoint_->append(r);
+    }
+
+    return optional<TracePath>(entry->trace);
+}
+
+/**
+ * @brief Forgets a node that left the campaign. Its placed traces go back to the unplaced queue,
+ *        oldest to be taken first, rather than waiting for other nodes to steal them.
+ */
+auto TracePool::remove_node(NodeID node) -> void
 {
-    if(next_.empty())
+    auto it = node_queues_.find(node);
+
+    if(it == node_queues_.end())
     {
-        return boost::optional<TracePath>{};
+        return;
     }
 
-    optional<TracePath> trace = optional<TracePath>(next_.back());
-    next_.pop_back();
+    const auto& local = it->second.local;
+
+    for(auto e = local.rbegin(); e != local.rend(); ++e)
+    {
+        next_.push_back(*e);
+    }
 
-    return trace;
+    node_queues_.erase(it);
 }
 
 auto TracePool::count_all_unique() const -> size_t
@@ -60,7 +158,130 @@ auto TracePool::count_all_unique() const -> size_t
 
 auto TracePool::count_next() const -> size_t
 {
-    return next_.size();
+    auto count = next_.size();
+
+    for(const auto& nq : node_queues_)
+    {
+        count += nq.second.local.size();
+    }
+
+    return count;
+}
+
+auto TracePool::journal_to(Checkpoint* checkpoint) -> void
+{
+    checkpoint_ = checkpoint;
+}
+
+auto TracePool::snapshot() const -> TracePoolSnapshot
+{
+    auto s = TracePoolSnapshot{};
+
+    s.trace_count = trace_count_;
+
+    for(const auto& e : next_)
+    {
+        s.next.emplace_back(e.trace.string(), e.cost);
+    }
+
+    for(const auto& nq : node_queues_)
+    {
+        for(const auto& e : nq.second.local)
+        {
+            s.next.emplace_back(e.trace.string(), e.cost);
+        }
+    }
+
+    return s;
+}
+
+/**
+ * @brief Rebuilds the pool from a snapshot and the journal that follows it. Node IDs don't
+ *        survive a restart, so every pending trace starts out unplaced.
+ */
+auto TracePool::restore(const TracePoolSnapshot& snapshot,
+                        const std::vector<CheckpointRecord>& records) -> void
+{
+    assert(!checkpoint_);
+
+    auto pending = snapshot.next;
+    auto taken = std::set<std::string>{};
+
+    trace_count_ = snapshot.trace_count;
+
+    for(const auto& r : records)
+    {
+        if(r.type == CheckpointRecord::trace_inserted)
+        {
+            ++trace_count_;
+            pending.emplace_back(r.path, r.a);
+        }
+        else if(r.type == CheckpointRecord::trace_taken)
+        {
+            taken.insert(r.path);
+        }
+    }
+
+    for(const auto& p : pending)
+    {
+        if(!taken.count(p.first) && fs::exists(p.first))
+        {
+            next_.push_front(QueuedTrace{p.first, p.second});
+        }
+    }
+}
+
+auto TracePool::load(const NodeQueue& nq) const -> uint64_t
+{
+    auto cost = uint64_t{0};
+
+    for(const auto& e : nq.local)
+    {
+        cost += e.cost;
+    }
+
+    for(const auto& c : nq.handed)
+    {
+        cost += c;
+    }
+
+    return cost;
+}
+
+/**
+ * @brief Takes the most recently placed trace of the node with the most queued work. The victim
+ *        keeps its oldest traces, which it will get to first.
+ */
+auto TracePool::steal(NodeID thief) -> optional<QueuedTrace>
+{
+    auto victim = node_queues_.end();
+    auto victim_load = uint64_t{0};
+
+    for(auto it = node_queues_.begin(); it != node_queues_.end(); ++it)
+    {
+        if(it->first == thief || it->second.local.empty())
+        {
+            continue;
+        }
+
+        auto l = load(it->second);
+
+        if(victim == node_queues_.end() || l > victim_load)
+        {
+            victim = it;
+            victim_load = l;
+        }
+    }
+
+    if(victim == node_queues_.end())
+    {
+        return optional<QueuedTrace>{};
+    }
+
+    auto entry = victim->second.local.back();
+    victim->second.local.pop_back();
+
+    return entry;
 }
 
 void TracePool::set(const std::map<AddressRange, Entry>& entries)
@@ -64,6 +64,9 @@ auto VMNode::poll() -> void
             using node::vm::fsm::QemuFSM;
 
             push(vm->error());
+            // Only current_test_ is dumped with the crash. The rest of its batch was already popped
+            // from the queue, and goes back there rather than being lost with the VM.
+            push(vm->unrun_tests());
 
             std::cerr << "pushing error!\n";
 
@@ -100,11 +103,19 @@ auto VMNode::poll() -> void
             {
                 using boost::msm::back::HANDLED_TRUE;
 
-                auto t = next_test();
+                // Whatever is queued, up to a batch, goes out at once rather than waiting to fill it.
+                auto batch = std::min<std::size_t>({master_options().test.batch,
+                                                    test_channel_slot_count,
+                                                    tests().size()});
+                auto ts = std::vector<TestCase>(tests().begin(),
+                                                tests().begin() + batch);
 
-                if(HANDLED_TRUE == vm->process_event(ev::next_test{t}))
+                if(HANDLED_TRUE == vm->process_event(ev::next_test{ts}))
                 {
-                    pop_test();
+                    for(auto i = 0u; i < batch; ++i)
+                    {
+                        pop_test();
+                    }
                 }
             }
         }
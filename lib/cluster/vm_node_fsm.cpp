@@ -7,6 +7,7 @@
 #include <crete/asio/server.h>
 #include <crete/run_config.h>
 #include <crete/serialize.h>
+#include <crete/test_channel.h>
 #include <crete/async_task.h>
 #include <crete/logger.h>
 #include <crete/guest_data_post_exec.hpp>
@@ -28,6 +29,7 @@
 #include <boost/process.hpp>
 
 #include <memory>
+#include <thread>
 
 #include <algorithm>
 
@@ -96,11 +98,11 @@ struct start // Basically, serves as constructor.
 
 struct next_test
 {
-    next_test(const TestCase& tc) :
-        tc_(tc)
+    next_test(const std::vector<TestCase>& tcs) :
+        tcs_(tcs)
     {}
 
-    TestCase tc_;
+    std::vector<TestCase> tcs_; // Run back to back by the guest, each traced in turn.
 };
 
 struct first
@@ -136,6 +138,7 @@ public:
     auto get_guest_data_post_exec() -> const GuestDataPostExec&;
     auto initial_test() -> const TestCase&;
     auto error() -> const log::NodeError&;
+    auto unrun_tests() const -> std::vector<TestCase>;
 
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
@@ -195,6 +198,7 @@ public:
     struct is_image_valid;
     struct is_first_vm;
     struct is_finished;
+    struct has_pending_tests;
     struct is_distributed;
     struct has_next_target;
     struct is_vm_terminated;
@@ -253,7 +257,8 @@ public:
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<StoreTrace        ,ev::poll          ,Finished          ,none                 ,is_prev_task_finished>,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<Finished          ,ev::trace_queued  ,NextTest          ,finish               ,none            >,
+      Row<Finished          ,ev::trace_queued  ,Testing           ,finish               ,has_pending_tests>,
+      Row<Finished          ,ev::trace_queued  ,NextTest          ,finish               ,Not_<has_pending_tests> >,
     // -- Orthogonal Region
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<Active            ,ev::terminate     ,Terminated        ,terminate            ,none            >,
@@ -286,6 +291,11 @@ private:
 
     std::shared_ptr<GuestDataPostExec> guest_data_post_exec_{std::make_shared<GuestDataPostExec>()};
 
+    std::shared_ptr<TestChannel> test_channel_{std::make_shared<TestChannel>()};
+    std::deque<TestCase> pending_tests_; // Handed to qemu, yet to be traced.
+    TestCase current_test_; // Dumped should the VM fail while running it.
+    bool test_started_{false};
+
     std::shared_ptr<AtomicGuard<pid_t> > translator_child_pid_ = std::make_shared<AtomicGuard<pid_t> >(-1);
 
     // Testing
@@ -313,21 +323,22 @@ void QemuFSM_::exception_caught(Event const&,FSM& fsm,std::exception& e)
     // Get the concrete input if a VM exception happened
     static uint64_t count_vm_exception = 0;
 
-    if(fs::exists(fsm.vm_dir_ / hostfile_dir_name / input_args_name)){
+    if(fsm.test_started_){
         std::stringstream crash_tc_ss;
         crash_tc_ss << "inputs_" << fs::path{fsm.target_}.filename().string()
                 << "_crash_" << count_vm_exception++ << ".bin";
-        fs::copy_file(fsm.vm_dir_ / hostfile_dir_name / input_args_name,
-                fsm.vm_dir_ / hostfile_dir_name/ crash_tc_ss.str(),
-                fs::copy_option::overwrite_if_exists);
+
+        fs::ofstream ofs{fsm.vm_dir_ / hostfile_dir_name / crash_tc_ss.str(),
+                         std::ios::out | std::ios::binary};
+        write_serialized(ofs, fsm.current_test_);
 
         ss << crash_tc_ss.str() << " being dumped\n" << std::endl;
 
         std::cerr << crash_tc_ss.str() << " being dumped\n" << std::endl;
     } else {
-        ss << (fsm.vm_dir_ / hostfile_dir_name / input_args_name) << " is missing. No concrete input is dumped.\n";
+        ss << "No test has been started. No concrete input is dumped.\n";
 
-        std::cerr << (fsm.vm_dir_ / hostfile_dir_name / input_args_name) << " is missing. No concrete input is dumped.\n";
+        std::cerr << "No test has been started. No concrete input is dumped.\n";
     }
 
     // TODO: I'd also like to send the current state's ID (ideally, even the recent state history), but that requires some work: http://stackoverflow.com/questions/14166800/boostmsm-a-way-to-get-a-string-representation-ie-getname-of-a-state
@@ -420,6 +431,21 @@ auto QemuFSM_::error() -> const log::NodeError&
     return error_log_;
 }
 
+/**
+ * @return the tests of the batch queued behind current_test_: handed to qemu, but not started.
+ */
+inline
+auto QemuFSM_::unrun_tests() const -> std::vector<TestCase>
+{
+    if(pending_tests_.empty())
+    {
+        return std::vector<TestCase>{};
+    }
+
+    return std::vector<TestCase>(pending_tests_.begin() + 1,
+                                 pending_tests_.end());
+}
+
 // +--------------------------------------------------+
 // + States                                           +
 // +--------------------------------------------------+
@@ -567,6 +593,8 @@ struct QemuFSM_::init
         fs::create_directories(fsm.vm_dir_);
         fs::create_directories(fsm.vm_dir_ / hostfile_dir_name);
 
+        fsm.test_channel_->create(fsm.vm_dir_ / hostfile_dir_name);
+
         fsm.exception_log_.add_sink(fsm.vm_dir_ / log_dir_name / exception_log_file_name);
         fsm.exception_log_.auto_flush(true);
     }
@@ -777,26 +805,28 @@ struct QemuFSM_::start_test
             fs::create_directories(hostfile);
         }
 
-        auto in_args_path = hostfile / input_args_name;
-
-        if(fs::exists(in_args_path))
+        for(const auto& tc : ev.tcs_)
         {
-            fs::remove(in_args_path);
+            ring_push(fsm.test_channel_->tests(),
+                      tc,
+                      fsm.test_channel_->test_spill());
         }
 
-        std::ofstream ofs{in_args_path.string().c_str()};
-
-        if(!ofs.good())
-        {
-            BOOST_THROW_EXCEPTION(Exception{} << err::file{in_args_path.string()});
-        }
-
-        write_serialized(ofs, ev.tc_);
+        fsm.pending_tests_.assign(ev.tcs_.begin(),
+                                  ev.tcs_.end());
+        fsm.current_test_ = ev.tcs_.front();
+        fsm.test_started_ = true;
 
         try
         {
-            fsm.server_->write(0,
-                               packet_type::cluster_next_test);
+            // The packet's id tells crete-run how many tests to run before it waits for the next packet.
+            // Once qemu restores the guest from a snapshot after each trace, the guest waits on the
+            // channel instead, and a packet would only land in a socket the snapshot knows nothing of.
+            if(!fsm.test_channel_->is_snapshot())
+            {
+                fsm.server_->write(ev.tcs_.size(),
+                                   packet_type::cluster_next_test);
+            }
             fsm.test_start_time_ = std::chrono::system_clock::now();
         }
         catch(std::exception& e)
@@ -807,6 +837,7 @@ struct QemuFSM_::start_test
 };
 
 static void translate_trace(const fs::path& trace_dir
+        ,const fs::path& vm_dir
         ,const cluster::option::Dispatch& dispatch_options
         ,const option::VMNode& node_options
         ,std::shared_ptr<AtomicGuard<pid_t>> child_pid)
@@ -859,6 +890,23 @@ static void translate_trace(const fs::path& trace_dir
 
         auto args = std::vector<std::string>{fs::absolute(exe).string()}; // It appears our modified QEMU requires full path in argv[0]...
 
+        auto jobs = node_options.translator.jobs;
+        if(jobs == 0)
+        {
+            jobs = std::max(1u, std::thread::hardware_concurrency() / node_options.vm.count);
+        }
+
+        if(jobs > 1)
+        {
+            args.emplace_back("-j");
+            args.emplace_back(std::to_string(jobs));
+        }
+
+        if(node_options.translator.cache)
+        {
+            args.emplace_back(fs::absolute(vm_dir / translation_cache_dir_name).string());
+        }
+
         auto proc = bp::launch(exe, args, ctx);
 
         child_pid->acquire() = proc.get_id();
@@ -901,18 +949,27 @@ struct QemuFSM_::store_trace
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState& ts) -> void
     {
+        // The rest of the batch, if any, is already running in the guest.
+        fsm.pending_tests_.pop_front();
+
+        if(!fsm.pending_tests_.empty())
+        {
+            fsm.current_test_ = fsm.pending_tests_.front();
+            fsm.test_start_time_ = std::chrono::system_clock::now();
+        }
+
         ts.async_task_.reset(new AsyncTask{[](const fs::path vm_dir,
                                               std::shared_ptr<fs::path> trace,
                                               std::shared_ptr<GuestDataPostExec> guest_data_post_exec,
                                               const cluster::option::Dispatch dispatch_options,
                                               const node::option::VMNode node_options,
-                                              std::shared_ptr<AtomicGuard<pid_t>> child_pid)
+                                              std::shared_ptr<AtomicGuard<pid_t>> child_pid,
+                                              std::shared_ptr<TestChannel> test_channel)
         {
-            auto trace_ready = vm_dir / hostfile_dir_name / trace_ready_name;
             auto trace_dir = vm_dir / trace_dir_name;
 
-            CRETE_EXCEPTION_ASSERT(fs::exists(trace_ready),
-                                   err::file_missing{trace_ready.string()});
+            CRETE_EXCEPTION_ASSERT(!ring_empty(test_channel->traces()),
+                                   err::msg{"no trace reported on the test channel"});
             CRETE_EXCEPTION_ASSERT(fs::exists(trace_dir),
                                    err::file_missing{trace_dir.string()});
             CRETE_EXCEPTION_ASSERT(fs::remove_all(trace_dir / "runtime-dump-last") == 1,
@@ -934,8 +991,18 @@ struct QemuFSM_::store_trace
 
             // FIXME: xxx should be redundant, as the test case can be directly written by qemu
             //            as a part of the trace
-            fs::copy_file(vm_dir / hostfile_dir_name / input_args_name,
-                          original_trace / "concrete_inputs.bin");
+            auto tc = ring_front(test_channel->traces(),
+                                 test_channel->trace_spill());
+
+            {
+                fs::ofstream ofs{original_trace / "concrete_inputs.bin",
+                                 std::ios::out | std::ios::binary};
+
+                CRETE_EXCEPTION_ASSERT(ofs.good(),
+                                       err::file_open_failed{(original_trace / "concrete_inputs.bin").string()});
+
+                write_serialized(ofs, tc);
+            }
 
 //            if(fs::exists("tb-ir.txt"))
 //            {
@@ -950,17 +1017,20 @@ struct QemuFSM_::store_trace
                        *trace);
 
             *guest_data_post_exec = read_serialized_guest_data_post_exec((*trace) / CRETE_FILENAME_GUEST_DATA_POST_EXEC);
+            guest_data_post_exec->m_tc_issue_index = tc.get_issue_index();
 
-            translate_trace(*trace, dispatch_options, node_options,child_pid);
+            // The trace is out of qemu's way: it may write the next one while this one is translated.
+            ring_pop(test_channel->traces());
 
-            fs::remove(trace_ready);
+            translate_trace(*trace, vm_dir, dispatch_options, node_options,child_pid);
         }
         , fsm.vm_dir_
         , fsm.trace_
         , fsm.guest_data_post_exec_
         , fsm.dispatch_options_
         , fsm.node_options_
-        , fsm.translator_child_pid_});
+        , fsm.translator_child_pid_
+        , fsm.test_channel_});
     }
 };
 
@@ -1169,9 +1239,16 @@ struct QemuFSM_::is_finished
                     err::msg{"timeout in vm-node-fsm for a test, likely to be crete-run crash"});
         }
 
-        auto trace_ready_sig = fsm.vm_dir_ / hostfile_dir_name / trace_ready_name;
+        return !ring_empty(fsm.test_channel_->traces());
+    }
+};
 
-        return fs::exists(trace_ready_sig);
+struct QemuFSM_::has_pending_tests
+{
+    template <class EVT,class FSM,class SourceState,class TargetState>
+    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
+    {
+        return !fsm.pending_tests_.empty();
     }
 };
 
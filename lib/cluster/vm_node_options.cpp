@@ -62,6 +62,8 @@ Translator::Translator(const pt::ptree& tree)
 
         path.x86 = trans.get<std::string>("path.x86", path.x86);
         path.x64 = trans.get<std::string>("path.x64", path.x64);
+        cache = trans.get<bool>("cache", cache);
+        jobs = trans.get<uint32_t>("jobs", jobs);
 
         auto proc = [](const std::string& p)
         {
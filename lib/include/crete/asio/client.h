@@ -30,9 +30,12 @@ public:
     void write(const uint64_t& id,
                const uint32_t& type);
     void write(const PacketInfo& pktinfo);
+    size_t write_raw(const char* data, size_t size); // Frame body only; header sent separately.
+    void write_file(const boost::filesystem::path& file, uint64_t size); // Frame body via sendfile.
     PacketInfo read(std::vector<char>& buf);
     PacketInfo read(boost::asio::streambuf& sbuf);
     PacketInfo read();
+    void read_raw(char* data, size_t size); // Frame body only; header read separately.
     PacketInfo read(boost::posix_time::time_duration timeout);
 
     void connect();
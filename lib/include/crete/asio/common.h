@@ -22,20 +22,27 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <crete/util/util.h>
 #include <crete/exception.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdint.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
 namespace crete
 {
 
 const size_t asio_max_msg_size = 32;
-const uint32_t default_chunk_size = 1024;
+const uint32_t default_chunk_size = 1024 * 1024; // Bytes staged per socket read/write of a streamed file.
 
 typedef unsigned short Port;
 typedef std::string IPAddress;
@@ -74,6 +81,8 @@ const uint32_t cluster_request_guest_data = 29;
 const uint32_t cluster_tx_guest_data = 30;
 const uint32_t cluster_request_guest_data_post_exec = 31;
 const uint32_t cluster_tx_guest_data_post_exec = 32;
+const uint32_t cluster_status_update_request = 33;
+const uint32_t cluster_trace_chunks_request = 34;
 }
 
 struct PacketInfo
@@ -175,14 +184,88 @@ void read_serialized_binary(boost::asio::streambuf& sbuf,
     ia >> t;
 }
 
+/**
+ * @brief Sends 'size' bytes of 'file' through 'socket' with sendfile(2), so the data goes from
+ *        the page cache to the socket without being copied through user space.
+ *
+ * @note The socket may have been left non-blocking by an earlier asynchronous operation, in which
+ *       case we wait for it to drain rather than fail.
+ */
+template<typename Socket>
+void send_file(Socket& socket,
+               const boost::filesystem::path& file,
+               uint64_t size)
+{
+    int fd = ::open(file.string().c_str(), O_RDONLY);
+
+    CRETE_EXCEPTION_ASSERT(fd >= 0, err::file_open_failed(file.string()));
+
+    off_t offset = 0;
+
+    while(static_cast<uint64_t>(offset) < size)
+    {
+        ssize_t nsent = ::sendfile(socket.native_handle(),
+                                   fd,
+                                   &offset,
+                                   static_cast<size_t>(size - offset));
+
+        if(nsent > 0)
+        {
+            continue;
+        }
+
+        if(nsent == 0)
+        {
+            ::close(fd);
+
+            BOOST_THROW_EXCEPTION(Exception() << err::network("sendfile failed: " + file.string() +
+                                                               " is shorter than " +
+                                                               boost::lexical_cast<std::string>(size) +
+                                                               " bytes"));
+        }
+
+        int e = errno;
+
+        if(e == EINTR)
+        {
+            continue;
+        }
+
+        if(e == EAGAIN || e == EWOULDBLOCK)
+        {
+            pollfd pfd = {socket.native_handle(), POLLOUT, 0};
+            int ready = ::poll(&pfd, 1, -1);
+
+            if(ready >= 0 && !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+            {
+                continue;
+            }
+
+            if(ready < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            e = ready < 0 ? errno : EPIPE;
+        }
+
+        ::close(fd);
+
+        BOOST_THROW_EXCEPTION(Exception() << err::network("sendfile failed: " + file.string())
+                                          << err::c_errno(e));
+    }
+
+    ::close(fd);
+}
+
 /**
  * @brief Writes entire contents of stream, is, to destination represented by 'connection'
- *        incrementally based on 'chunk_size.' Enables "streaming" of files across connections.
+ *        as a single frame: a file_stream header carrying the size, followed by the raw bytes.
+ *        Enables "streaming" of files across connections.
  *
  * @param connection represents a client or server connection
  * @param is stream with data to send
- * @param chunk_size amount of data to send at each increment. Pay careful attention here to avoid
- *        resource issues. Each packet can only be reasonably expected to send a certain amount of data.
+ * @param chunk_size amount of data staged in memory for each socket write.
  *
  * @pre connection represents a valid condition
  * @post is.tellg == std::ios::end
@@ -191,6 +274,7 @@ void read_serialized_binary(boost::asio::streambuf& sbuf,
  *          would be more efficient. It would be very simple to integrate with boost::iostreams compression.
  * @note 2. It would be nice if this took an optional logger to report on progress (% sent), for very large
  *          files that take an exceedingly long time (e.g., OS images).
+ * @note 3. Prefer the path overload for files on disk; it hands the copy to the kernel.
  */
 template<typename Connection>
 void write(Connection& connection,
@@ -198,7 +282,7 @@ void write(Connection& connection,
            std::size_t chunk_size)
 {
     std::vector<char> buf;
-    std::size_t count = 0;
+    uint64_t bytes_sent = 0;
     std::streamsize bytes_read = 0;
     std::istream::pos_type stream_size = util::stream_size(is);
 
@@ -227,20 +311,40 @@ void write(Connection& connection,
 
         if(bytes_read > 0)
         {
-            PacketInfo pkinfo;
-            pkinfo.id = count;
-            pkinfo.type = crete::packet_type::chunk;
-            pkinfo.size = static_cast<uint32_t>(bytes_read);
-
-            size_t bytes_written = connection.write(buf,
-                                                    pkinfo);
+            size_t bytes_written = connection.write_raw(buf.data(),
+                                                        static_cast<size_t>(bytes_read));
 
-            CRETE_EXCEPTION_ASSERT(bytes_written == static_cast<uint32_t>(bytes_read),
+            CRETE_EXCEPTION_ASSERT(bytes_written == static_cast<size_t>(bytes_read),
                                    err::network("failed to send requested number of bytes"));
 
-            ++count;
+            bytes_sent += bytes_written;
         }
     }while(bytes_read > 0);
+
+    CRETE_EXCEPTION_ASSERT(bytes_sent == static_cast<uint64_t>(stream_size),
+                           err::network("stream ended before its reported size was sent"));
+}
+
+/**
+ * @brief Writes the file at 'file' to destination represented by 'connection' in the same frame
+ *        format as the stream overload, letting the kernel copy the contents to the socket.
+ */
+template<typename Connection>
+void write(Connection& connection,
+           const boost::filesystem::path& file)
+{
+    uint64_t file_size = boost::filesystem::file_size(file);
+
+    CRETE_EXCEPTION_ASSERT(file_size > 0, err::stream_size(file_size));
+
+    PacketInfo pkinfo;
+    pkinfo.id = 0;
+    pkinfo.type = packet_type::file_stream;
+    pkinfo.size = file_size;
+
+    connection.write(pkinfo);
+    connection.write_file(file,
+                          file_size);
 }
 
 template<typename Connection>
@@ -252,31 +356,27 @@ void read(Connection& connection,
     CRETE_EXCEPTION_ASSERT(pkinfo.type == packet_type::file_stream, err::network_type_mismatch(pkinfo.type));
 
     uint64_t stream_size = pkinfo.size;
-    uint64_t bytes_written = 0;
+    uint64_t bytes_left = stream_size;
 
     CRETE_EXCEPTION_ASSERT(stream_size > 0, err::network("stream size expected must be larger than 0"));
 
+    // Allocated once for the whole stream.
+    std::vector<char> buf(static_cast<size_t>(std::min<uint64_t>(stream_size,
+                                                                 default_chunk_size)));
+
     do
     {
-        std::vector<char> buf;
-
-        pkinfo = connection.read(buf);
-
-        CRETE_EXCEPTION_ASSERT(pkinfo.size >= 0, err::network("zero bytes received"));
-
-        bytes_written += pkinfo.size;
-
-        CRETE_EXCEPTION_ASSERT(bytes_written <= stream_size, err::msg("number of bytes sent exceeds number expected for streamed file"));
+        size_t size = static_cast<size_t>(std::min<uint64_t>(bytes_left,
+                                                             buf.size()));
 
-        // TODO: C++11: numeric_limits<std::streamsize>::max() rather than INT_MAX
-        // FIXME: replace INT_MAX with UINT32_MAX
-        CRETE_EXCEPTION_ASSERT(buf.size() <= UINT_MAX, err::unsigned_to_signed_conversion(buf.size()));
+        connection.read_raw(buf.data(),
+                            size);
 
-        assert(buf.size() == pkinfo.size);
+        os.write(buf.data(), static_cast<std::streamsize>(size));
 
-        os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        bytes_left -= size;
 
-    }while(bytes_written != stream_size);
+    }while(bytes_left != 0);
 
     os.flush(); // Seems to be a bug in gcc-4.6. Destructor doesn't always call close/flush.
 }
@@ -32,17 +32,21 @@ public:
     void write(const uint64_t& id,
                const uint32_t& type);
     void write(const PacketInfo& pktinfo);
+    size_t write_raw(const char* data, size_t size); // Frame body only; header sent separately.
+    void write_file(const boost::filesystem::path& file, uint64_t size); // Frame body via sendfile.
 //    size_t write(const boost::asio::buffer& buf,
 //                 const PacketInfo& pktinfo);
     PacketInfo read(std::vector<char>& buf);
     PacketInfo read(boost::asio::streambuf& sbuf);
     PacketInfo read();
+    void read_raw(char* data, size_t size); // Frame body only; header read separately.
 
     /// Handler signature: void handler(const boost::system::error_code&);
     template <typename Handler>
     void open_connection_async(Handler handler);
     void open_connection_wait();
     void open_connection_wait(boost::posix_time::time_duration timeout);
+    void close_connection(); // Keeps the acceptor listening, so the next connection can be awaited on the same port.
     bool is_socket_open(); // Will return true even if connection has been closed.
 
     void update_directory(const boost::filesystem::path& from, const boost::filesystem::path& to);
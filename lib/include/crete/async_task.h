@@ -3,9 +3,13 @@
 
 #include <boost/thread.hpp>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <mutex>
 
+#include <stdint.h>
+
 namespace crete
 {
 
@@ -38,6 +42,23 @@ public:
     [[noreturn]] auto rethrow_exception() -> void;
     auto release_exception() -> std::exception_ptr;
 
+    // Number of tasks finished so far, process wide.
+    static auto finished_count() -> uint64_t;
+    // Blocks until a task finishes after finished_count() returned 'count', or the timeout expires.
+    static auto wait_for_finished(uint64_t count,
+                                  std::chrono::milliseconds timeout) -> void;
+
+private:
+    struct FinishedTasks
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        uint64_t count{0};
+    };
+
+    static auto finished_tasks() -> FinishedTasks&;
+    static auto notify_finished() -> void;
+
 private:
     boost::thread thread_;
     std::atomic<bool> finished_flag_{false};
@@ -65,6 +86,8 @@ AsyncTask::AsyncTask(Func f,
         }
 
         finished_flag_.exchange(true, std::memory_order_seq_cst);
+
+        notify_finished();
     };
 
     thread_ = boost::thread{wrapper, f};
@@ -118,6 +141,49 @@ auto AsyncTask::is_exception_thrown() const -> bool
     return static_cast<bool>(eptr_);
 }
 
+inline
+auto AsyncTask::finished_count() -> uint64_t
+{
+    auto& ft = finished_tasks();
+    std::lock_guard<std::mutex> lock{ft.mutex};
+
+    return ft.count;
+}
+
+inline
+auto AsyncTask::wait_for_finished(uint64_t count,
+                                  std::chrono::milliseconds timeout) -> void
+{
+    auto& ft = finished_tasks();
+    std::unique_lock<std::mutex> lock{ft.mutex};
+
+    ft.cond.wait_for(lock,
+                     timeout,
+                     [&ft, count] { return ft.count != count; });
+}
+
+inline
+auto AsyncTask::finished_tasks() -> FinishedTasks&
+{
+    static FinishedTasks ft;
+
+    return ft;
+}
+
+inline
+auto AsyncTask::notify_finished() -> void
+{
+    auto& ft = finished_tasks();
+
+    {
+        std::lock_guard<std::mutex> lock{ft.mutex};
+
+        ++ft.count;
+    }
+
+    ft.cond.notify_all();
+}
+
 inline
 auto AsyncTask::rethrow_exception() -> void
 {
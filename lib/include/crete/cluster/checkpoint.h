@@ -0,0 +1,199 @@
+#ifndef CRETE_CLUSTER_CHECKPOINT_H
+#define CRETE_CLUSTER_CHECKPOINT_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <crete/test_case.h>
+
+#include <stdint.h>
+
+namespace crete
+{
+namespace cluster
+{
+
+const auto dispatch_checkpoint_dir_name = std::string{"checkpoint"};
+const auto checkpoint_snapshot_file_name = std::string{"snapshot"};
+const auto checkpoint_journal_file_name = std::string{"journal"};
+const auto checkpoint_snapshot_interval = uint64_t{600}; // Seconds between snapshots.
+const auto checkpoint_elapsed_interval = uint64_t{10}; // Seconds between records of elapsed time.
+
+/**
+ * @brief One change to dispatch state, appended to the journal as it happens.
+ */
+struct CheckpointRecord
+{
+    enum Type : uint8_t
+    {
+        test_pushed,       // tc queued.
+        test_popped,       // Queued test 'fp' (content_fingerprint) taken; 'a' is 1 if it was a duplicate.
+        test_issued,       // 'fp' (fingerprint) added to the issued tests.
+        test_counted,      // Test count is now 'a'.
+        coverage_credited, // Trace of test 'a' covered 'b' new TBs.
+        trace_inserted,    // Trace at 'path' queued, at cost 'a'.
+        trace_taken,       // Trace at 'path' handed to a node.
+        tbs_explored,      // 'tbs' explored for the first time.
+        elapsed            // 'a' seconds spent on the target so far.
+    };
+
+    uint8_t type{test_pushed};
+    TestCase tc;
+    TestCaseFingerprint fp{0, 0};
+    uint64_t a{0};
+    uint64_t b{0};
+    std::string path;
+    std::vector<uint64_t> tbs;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & type;
+
+        switch(type)
+        {
+        case test_pushed:
+            ar & tc;
+            break;
+        case test_popped:
+        case test_issued:
+            ar & fp;
+            ar & a;
+            break;
+        case trace_inserted:
+        case trace_taken:
+            ar & path;
+            ar & a;
+            break;
+        case tbs_explored:
+            ar & tbs;
+            break;
+        default:
+            ar & a;
+            ar & b;
+            break;
+        }
+    }
+};
+
+/**
+ * @brief How long a group of the COVERAGE strategy has waited, and how much it has been served.
+ */
+struct CoverageGroupSnapshot
+{
+    uint64_t base{0};
+    uint64_t issued{0};
+    uint64_t since{0};
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & base;
+        ar & issued;
+        ar & since;
+    }
+};
+
+struct TestPoolSnapshot
+{
+    uint64_t tc_count{0};
+    uint64_t duplicated_tc_count{0};
+    std::vector<TestCase> next;
+    std::vector<TestCaseFingerprint> issued;
+    std::vector<std::pair<uint64_t, uint64_t> > coverage_credits;
+    std::vector<CoverageGroupSnapshot> coverage_groups;
+    uint64_t coverage_tick{0};
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & tc_count;
+        ar & duplicated_tc_count;
+        ar & next;
+        ar & issued;
+        ar & coverage_credits;
+        ar & coverage_groups;
+        ar & coverage_tick;
+    }
+};
+
+struct TracePoolSnapshot
+{
+    uint64_t trace_count{0};
+    std::vector<std::pair<std::string, uint64_t> > next; // Trace and its cost.
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & trace_count;
+        ar & next;
+    }
+};
+
+struct DispatchSnapshot
+{
+    uint64_t generation{0}; // Of the journal that continues this snapshot.
+    uint64_t elapsed{0};
+    TestPoolSnapshot test_pool;
+    TracePoolSnapshot trace_pool;
+    std::vector<uint64_t> explored_tbs;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & generation;
+        ar & elapsed;
+        ar & test_pool;
+        ar & trace_pool;
+        ar & explored_tbs;
+    }
+};
+
+/**
+ * @brief Persists dispatch state as a snapshot plus a journal of the changes made since.
+ *        Each snapshot starts a new journal generation, so a crash between writing the
+ *        snapshot and dropping the old journal can't replay changes twice.
+ *
+ * @note Records are flushed as they are appended; what the pools have acted upon survives
+ *       dispatch being killed, though not the host going down.
+ */
+class Checkpoint
+{
+public:
+    explicit Checkpoint(const boost::filesystem::path& dir);
+
+    auto append(const CheckpointRecord& record) -> void;
+    auto snapshot(DispatchSnapshot snapshot) -> void;
+    auto load(DispatchSnapshot& snapshot,
+              std::vector<CheckpointRecord>& records) -> bool;
+
+private:
+    auto journal_path(uint64_t generation) const -> boost::filesystem::path;
+    auto open_journal() -> void;
+
+    boost::filesystem::path dir_;
+    uint64_t generation_{0};
+    boost::filesystem::ofstream journal_;
+};
+
+} // namespace cluster
+} // namespace crete
+
+#endif // CRETE_CLUSTER_CHECKPOINT_H
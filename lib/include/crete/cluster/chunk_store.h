@@ -0,0 +1,179 @@
+#ifndef CRETE_CLUSTER_CHUNK_STORE_H
+#define CRETE_CLUSTER_CHUNK_STORE_H
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_serialize.hpp>
+
+#include <crete/asio/common.h>
+#include <crete/cluster/common.h>
+#include <crete/exception.h>
+
+#include <stdint.h>
+
+namespace crete
+{
+namespace cluster
+{
+
+const auto chunk_store_dir_name = std::string{"chunks"};
+const auto trace_chunk_size = uint32_t{256 * 1024}; // Bytes.
+
+using ChunkID = boost::uuids::uuid; // Name-based (SHA-1) UUID of the chunk's contents.
+
+struct ChunkedFile
+{
+    std::string path_; // Relative to the trace directory.
+    uint64_t size_{0};
+    std::vector<ChunkID> chunks_;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & path_;
+        ar & size_;
+        ar & chunks_;
+    }
+};
+
+/**
+ * @brief Chunk-by-chunk description of a trace directory. Sent ahead of a trace so the receiver
+ *        only asks for chunks it doesn't hold, and kept in place of the trace until it's needed.
+ */
+struct TraceManifest
+{
+    std::string name_; // Trace directory name.
+    std::vector<ChunkedFile> files_;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        (void)version;
+
+        ar & name_;
+        ar & files_;
+    }
+};
+
+/**
+ * @brief Content-addressed store of trace chunks. What traces of a target have in common
+ *        (initial CPU state, debug offsets, run.bc, ...) is held, and transferred, once.
+ *
+ * @note Holds no state but its directory, so concurrent transfers may share a root:
+ *       chunks are renamed into place, which is atomic.
+ */
+class ChunkStore
+{
+public:
+    explicit ChunkStore(const boost::filesystem::path& root);
+
+    auto missing(const TraceManifest& manifest) const -> std::vector<ChunkID>;
+    auto absorb(const boost::filesystem::path& bundle) -> void;
+    auto bundle(const std::vector<ChunkID>& ids,
+                const boost::filesystem::path& bundle) const -> void;
+    auto materialize(const boost::filesystem::path& trace) const -> void;
+    auto remove(const std::vector<ChunkID>& ids) const -> void;
+
+private:
+    auto chunk_path(const ChunkID& id) const -> boost::filesystem::path;
+
+    boost::filesystem::path root_;
+};
+
+/**
+ * @brief Tracks the chunks a receiver holds, so it can keep asking only for chunks it hasn't
+ *        seen. Chunks referenced by queued manifests are pinned. Once their last trace has been
+ *        materialized they stay, least recently released first out, until unreferenced chunks
+ *        exceed the capacity in bytes.
+ */
+class ChunkCache
+{
+public:
+    explicit ChunkCache(uint64_t capacity);
+
+    auto retain(const TraceManifest& manifest) -> void;
+    auto release(const TraceManifest& manifest) -> std::vector<ChunkID>;
+
+private:
+    // Unreferenced chunks, most recently released first.
+    using LRU = std::list<ChunkID>;
+
+    struct Entry
+    {
+        uint64_t refs;
+        uint64_t bytes;
+        LRU::iterator lru_it; // Valid while refs == 0.
+    };
+
+    auto evict() -> std::vector<ChunkID>;
+
+    boost::unordered_map<ChunkID, Entry> entries_;
+    LRU lru_;
+    uint64_t lru_bytes_{0};
+    uint64_t capacity_;
+};
+
+auto make_manifest(const boost::filesystem::path& trace) -> TraceManifest;
+auto write_bundle(const boost::filesystem::path& trace,
+                  const TraceManifest& manifest,
+                  const std::vector<ChunkID>& ids,
+                  const boost::filesystem::path& bundle) -> void;
+auto write_manifest(const TraceManifest& manifest,
+                    const boost::filesystem::path& file) -> void;
+auto read_manifest(const boost::filesystem::path& file) -> TraceManifest;
+
+/**
+ * @brief Sends a bundle directory as one archive, compressed as requested, then removes it.
+ */
+template <typename Connection>
+auto transmit_bundle(Connection& connection,
+                     const boost::filesystem::path& bundle,
+                     const std::string& compress_format,
+                     uint32_t compress_level) -> void
+{
+    archive_directory(bundle,
+                      compress_format,
+                      compress_level);
+
+    write(connection,
+          bundle);
+
+    boost::filesystem::remove(bundle);
+}
+
+/**
+ * @brief Receives a bundle sent by transmit_bundle() and unpacks it as the directory 'bundle'.
+ */
+template <typename Connection>
+auto receive_bundle(Connection& connection,
+                    const boost::filesystem::path& bundle) -> void
+{
+    {
+        boost::filesystem::ofstream ofs{bundle,
+                                        std::ios::out | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(ofs.good(),
+                               err::file_open_failed{bundle.string()});
+
+        read(connection,
+             ofs);
+    }
+
+    restore_directory(bundle);
+}
+
+} // namespace cluster
+} // namespace crete
+
+#endif // CRETE_CLUSTER_CHUNK_STORE_H
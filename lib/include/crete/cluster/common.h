@@ -35,8 +35,10 @@ const auto vm_port_file_name = std::string{"port"};
 const auto vm_pid_file_name = std::string{"pid"};
 const auto log_dir_name = std::string{"log"};
 const auto klee_dir_name = std::string{"klee-run"};
+const auto translation_cache_dir_name = std::string{"translation-cache"};
 const auto exception_log_file_name = std::string{"exception_caught.log"};
 const auto image_max_file_size = uint64_t{8000000000}; // 10 Gigabytes in bytes
+const auto status_update_timeout = uint32_t{1000}; // ms. Longest a node holds back a status update request.
 
 struct NodeStatus
 {
@@ -59,6 +61,24 @@ struct NodeStatus
     }
 };
 
+inline
+auto operator==(const NodeStatus& lhs,
+                const NodeStatus& rhs) -> bool
+{
+    return lhs.id == rhs.id
+        && lhs.test_case_count == rhs.test_case_count
+        && lhs.trace_count == rhs.trace_count
+        && lhs.error_count == rhs.error_count
+        && lhs.active == rhs.active;
+}
+
+inline
+auto operator!=(const NodeStatus& lhs,
+                const NodeStatus& rhs) -> bool
+{
+    return !(lhs == rhs);
+}
+
 struct ImageInfo
 {
     std::string file_name_;
@@ -146,7 +166,9 @@ struct Trace
     }
 };
 
-auto archive_directory(const boost::filesystem::path& dir) -> void;
+auto archive_directory(const boost::filesystem::path& dir,
+                       const std::string& compress_format = std::string{}, // Empty: tar only.
+                       uint32_t compress_level = 0) -> void;
 auto restore_directory(const boost::filesystem::path& dir) -> void;
 
 struct NodeRequest
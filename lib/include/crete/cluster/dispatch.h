@@ -36,8 +36,9 @@ const auto dispatch_node_error_log_file_name = std::string{"node_error.log"};
 const auto dispatch_last_root_symlink = std::string{"last"};
 const auto dispatch_config_file_name = std::string{"dispatch_config.xml"};
 
+const auto dispatch_status_interval = 1000u; // ms between status display refreshes.
 const auto vm_test_multiplier = 5u;
-const auto vm_trace_multiplier = 20u;
+const auto svm_trace_queue_size = 2u; // Beyond this, traces wait in the TracePool, where idle nodes can steal them.
 
 namespace vm
 {
@@ -55,6 +55,9 @@ struct Test
     Interval interval;
     Items items;
     Seeds seeds;
+    std::string priority{"bfs"}; // Order in which tests are issued: fifo, bfs or coverage.
+    uint32_t concurrent_targets{1}; // Items tested at once; nodes are shared out among them.
+    uint32_t batch{1}; // Tests a VM is handed at once, run back to back by its guest.
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -64,6 +67,9 @@ struct Test
         ar & interval;
         ar & items;
         ar & seeds;
+        ar & priority;
+        ar & concurrent_targets;
+        ar & batch;
     }
 };
 
@@ -137,6 +143,8 @@ struct Trace
     bool print_graph_only_branches{false}; // TODO: Now redundant. We only dump 'branches.'
     bool print_elf_info{false};
     bool compress{false};
+    std::string compress_format{"zstd"}; // zstd or lz4.
+    uint32_t compress_level{3};
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -149,6 +157,8 @@ struct Trace
         ar & print_graph_only_branches;
         ar & print_elf_info;
         ar & compress;
+        ar & compress_format;
+        ar & compress_level;
     }
 };
 
@@ -188,6 +198,7 @@ struct Dispatch
     Profile profile;
     Coverage coverage;
     std::string file_path;
+    std::string resume; // Root of the run to resume; empty to start afresh.
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -202,6 +213,7 @@ struct Dispatch
         ar & profile;
         ar & coverage;
         ar & file_path;
+        ar & resume;
     }
 };
 
@@ -2,6 +2,7 @@
 #define CRETE_CLUSTER_NODE_DRIVER_H
 
 #include <crete/atomic_guard.h>
+#include <crete/cluster/chunk_store.h>
 #include <crete/cluster/common.h>
 #include <crete/asio/common.h>
 #include <crete/asio/client.h>
@@ -16,6 +17,9 @@
 #include <boost/move/make_unique.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 namespace crete
@@ -23,6 +27,23 @@ namespace crete
 namespace cluster
 {
 
+/**
+ * @brief Lets a status update request be held back until the node's status changes,
+ *        so Dispatch hears of new traces, tests and errors as they are produced.
+ */
+class StatusMonitor
+{
+public:
+    auto update(const NodeStatus& status) -> void;
+    auto wait_for_change(const NodeStatus& known,
+                         std::chrono::milliseconds timeout) -> void;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    NodeStatus status_;
+};
+
 template <typename Node>
 class NodeDriver : public ExceptionPropagator
 {
@@ -40,6 +61,7 @@ public:
 private:
     using AtomicFlag = std::atomic<bool>;
     using AtomicFlagPtr = boost::movelib::unique_ptr<AtomicFlag>; // Ptr because atomic is not movable.
+    using StatusMonitorPtr = boost::movelib::unique_ptr<StatusMonitor>;
 
     AtomicGuard<Node>& node_;
     ID node_id_;
@@ -48,6 +70,8 @@ private:
     bool shutdown_ = false;
     AtomicFlagPtr transmission_pending_
         = boost::movelib::make_unique<AtomicFlag>(false);
+    StatusMonitorPtr status_monitor_
+        = boost::movelib::make_unique<StatusMonitor>();
 };
 
 template <typename Node>
@@ -55,7 +79,7 @@ auto process_default(Node& node,
                      NodeRequest& request) -> bool;
 template <typename Node>
 auto send_status(Node& node,
-                 Client& client) -> void;
+                 Client& client) -> NodeStatus;
 template <typename Node>
 auto receive_tests(Node& node,
                    boost::asio::streambuf& sbuf) -> void;
@@ -69,6 +93,34 @@ template <typename Node>
 auto transmit_errors(Node& node,
                      Client& client) -> void;
 
+inline
+auto StatusMonitor::update(const NodeStatus& status) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        if(status_ == status)
+        {
+            return;
+        }
+
+        status_ = status;
+    }
+
+    cond_.notify_all();
+}
+
+inline
+auto StatusMonitor::wait_for_change(const NodeStatus& known,
+                                    std::chrono::milliseconds timeout) -> void
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    cond_.wait_for(lock,
+                   timeout,
+                   [this, &known] { return status_ != known; });
+}
+
 template <typename Node>
 NodeDriver<Node>::NodeDriver(const IPAddress& master_ipa,
                              const Port& master_port,
@@ -121,7 +173,11 @@ auto NodeDriver<Node>::run_node(AsyncTask& async_task) -> void
                 std::this_thread::yield();
             }
 
-            node_.acquire()->run();
+            auto lock = node_.acquire();
+
+            lock->run();
+
+            status_monitor_->update(lock->status());
         }
         catch(boost::exception& e)
         {
@@ -148,6 +204,8 @@ auto NodeDriver<Node>::run_listener() -> void
 
     client.connect();
 
+    auto sent_status = NodeStatus{};
+
     while(!shutdown_)
     {
         boost::asio::streambuf sbuf;
@@ -163,17 +221,38 @@ auto NodeDriver<Node>::run_listener() -> void
                 sbuf,
                 client};
 
+        // Replied once the status differs from the one last sent, or on timeout.
+        if(pkinfo.type == packet_type::cluster_status_update_request)
+        {
+            auto timeout = uint32_t{0};
+
+            read_serialized_binary(sbuf,
+                                   timeout);
+
+            status_monitor_->wait_for_change(sent_status,
+                                             std::chrono::milliseconds{timeout});
+        }
+
         try
         {
             *transmission_pending_ = true;
 
-            auto processed = process(node_,
-                                     request);
-
-            if(!processed)
+            if(pkinfo.type == packet_type::cluster_status_request ||
+               pkinfo.type == packet_type::cluster_status_update_request)
             {
-                shutdown_ = process_default(node_,
-                                            request);
+                sent_status = send_status(node_,
+                                          client);
+            }
+            else
+            {
+                auto processed = process(node_,
+                                         request);
+
+                if(!processed)
+                {
+                    shutdown_ = process_default(node_,
+                                                request);
+                }
             }
 
             *transmission_pending_ = false;
@@ -236,6 +315,7 @@ auto process_default(Node& node,
     switch(request.pkinfo_.type)
     {
     case packet_type::cluster_status_request:
+    case packet_type::cluster_status_update_request:
         send_status(node,
                     request.client_);
         break;
@@ -278,7 +358,7 @@ auto process_default(Node& node,
 
 template <typename Node>
 auto send_status(Node& node,
-                 Client& client) -> void
+                 Client& client) -> NodeStatus
 {
     auto pkinfo = PacketInfo{node.acquire()->id(),
                              0,
@@ -289,6 +369,8 @@ auto send_status(Node& node,
     write_serialized_binary(client,
                             pkinfo,
                             status);
+
+    return status;
 }
 
 template <typename Node>
@@ -329,26 +411,37 @@ auto transmit_trace(Node& node,
 
     auto lock = node.acquire();
     auto trace = lock->pop_trace();
+    const auto& options = lock->master_options().trace;
 
-    archive_directory(trace);
+    // Dispatch answers the manifest with the chunks it has yet to see; only those are sent.
+    auto manifest = make_manifest(trace);
 
-    {
-        fs::ifstream ifs{trace,
-                         std::ios::in | std::ios::binary};
+    write_serialized_binary(client,
+                            pkinfo,
+                            manifest);
+
+    auto missing = std::vector<ChunkID>{};
 
-        CRETE_EXCEPTION_ASSERT(ifs.good(),
-                               err::file_open_failed{trace.string()});
+    read_serialized_binary(client,
+                           missing,
+                           packet_type::cluster_trace_chunks_request);
+
+    if(!missing.empty())
+    {
+        auto bundle = fs::path{trace}.replace_extension("chunks");
 
-        write_serialized_binary(client,
-                                pkinfo,
-                                trace.filename().string());
+        write_bundle(trace,
+                     manifest,
+                     missing,
+                     bundle);
 
-        write(client,
-              ifs,
-              default_chunk_size);
+        transmit_bundle(client,
+                        bundle,
+                        options.compress ? options.compress_format : std::string{},
+                        options.compress_level);
     }
 
-    fs::remove(trace);
+    fs::remove_all(trace);
 }
 
 template <typename Node>
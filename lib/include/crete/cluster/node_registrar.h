@@ -71,7 +71,7 @@ public:
                         const Callback& cb);
 
     auto run() -> void;
-    auto connect() -> void;
+    auto connect(Server& registrar_server) -> void;
     auto register_callback(const Callback& cb) -> void;
     auto call_back(NodeRegistrar::Node& node) -> void;
 
@@ -85,6 +85,8 @@ private:
 };
 
 auto poll(NodeRegistrar::Node& node) -> NodeStatus;
+auto poll_update(NodeRegistrar::Node& node,
+                 uint32_t timeout) -> NodeStatus; // Returns once the node's status changes, or after timeout ms.
 
 } // namespace cluster
 } // namespace crete
@@ -2,6 +2,7 @@
 #define CRETE_CLUSTER_SVM_NODE_H
 
 #include <crete/cluster/node.h>
+#include <crete/cluster/chunk_store.h>
 #include <crete/cluster/svm_node_fsm.h>
 #include <crete/cluster/svm_node_options.h>
 #include <crete/cluster/dispatch_options.h>
@@ -20,6 +21,7 @@ namespace cluster
 {
 
 const auto svm_working_dir_name = std::string{"svm"};
+const auto svm_chunk_cache_bytes = uint64_t{1024} * 1024 * 1024; // Of chunks no queued trace needs.
 
 class CRETE_DLL_EXPORT SVMNode : public Node
 {
@@ -39,10 +41,15 @@ public:
     auto reset() -> void;
     auto poll() -> void;
     auto traces_directory() const -> boost::filesystem::path;
+    auto retain_chunks(const TraceManifest& manifest) -> void;
+    auto release_chunks(const TraceManifest& manifest) -> void;
 
 private:
+    auto materialize(const boost::filesystem::path& trace) -> void;
+
     SVMs svms_;
     node::option::SVMNode node_options_;
+    ChunkCache chunk_cache_; // Of the chunk store: pinned by traces queued as manifests.
 };
 
 auto process(AtomicGuard<SVMNode>& node,
@@ -1,6 +1,7 @@
 #ifndef CRETE_TEST_POOL_H_
 #define CRETE_TEST_POOL_H_
 
+#include <list>
 #include <set>
 #include <string>
 #include <vector>
@@ -14,6 +15,7 @@
 #include <boost/unordered_set.hpp>
 
 #include <crete/test_case.h>
+#include <crete/cluster/checkpoint.h>
 
 namespace fs = boost::filesystem;
 
@@ -30,7 +32,9 @@ struct TestCaseTreeNode
     TestCaseTreeNode() {m_tc_index = -1;}
 };
 
-enum TestSchedStrat {FIFO, BFS};
+enum TestSchedStrat {FIFO, BFS, COVERAGE};
+
+auto to_test_sched_strat(const std::string& name) -> TestSchedStrat;
 
 class TestPriority
 {
@@ -42,28 +46,92 @@ public:
     bool operator() (const TestCase& lhs, const TestCase& rhs) const;
 };
 
+/**
+ * @brief Tests grouped by the base test whose trace produced them. Groups are ordered by the new TBs
+ *        that trace contributed, divided among the tests already issued from the group, and aged by
+ *        how long the group has waited. An indexed heap lets a group's key change in place.
+ */
+class CoverageQueue
+{
+public:
+    auto push(const TestCase& tc) -> void;
+    auto pop() -> TestCase;
+    auto credit(TestCaseIssueIndex base, uint64_t new_tb_count) -> void;
+
+    auto empty() const -> bool;
+    auto size() const -> size_t;
+    auto contents() const -> std::vector<TestCase>;
+    auto credits() const -> std::vector<std::pair<uint64_t, uint64_t> >;
+    auto groups() const -> std::vector<CoverageGroupSnapshot>;
+    auto tick() const -> uint64_t;
+    auto restore(uint64_t tick,
+                 const boost::unordered_map<TestCaseIssueIndex, CoverageGroupSnapshot>& groups) -> void;
+
+    static auto group_of(const TestCase& tc) -> TestCaseIssueIndex;
+
+private:
+    using Tests = std::priority_queue<TestCase, vector<TestCase>, TestPriority>;
+
+    struct Group
+    {
+        Tests tests{TestPriority(BFS)};
+        uint64_t issued{0};
+        uint64_t since{0}; // Tick at which the group was created or last served.
+        size_t heap_pos{0};
+    };
+
+    auto key(TestCaseIssueIndex base) const -> double;
+    auto update(TestCaseIssueIndex base) -> void;
+    auto sift_up(size_t pos) -> void;
+    auto sift_down(size_t pos) -> void;
+    auto swap_at(size_t lhs, size_t rhs) -> void;
+
+    boost::unordered_map<TestCaseIssueIndex, Group> groups_;
+    boost::unordered_map<TestCaseIssueIndex, uint64_t> new_tbs_;
+    std::vector<TestCaseIssueIndex> heap_; // Max-heap of group bases, by key().
+    uint64_t tick_{0};
+    size_t size_{0};
+};
+
 class TestPool
 {
 public:
     using TestQueue = std::priority_queue<TestCase, vector<TestCase>, TestPriority>;
+    // Most recently used first
+    using BaseTestLRU_ty = std::list<TestCaseIssueIndex>;
+
+    struct BaseTestCacheEntry
+    {
+        TestCase tc;
+        uint64_t bytes;
+        BaseTestLRU_ty::iterator lru_it;
+    };
+
     // Needs to be a map b/c the tc issued first is not necessary going to finish symbolic replay first
-    using BaseTestCache_ty = boost::unordered_map<TestCaseIssueIndex, TestCase>;
-    using UniqueTestIdentifier = TestCaseElements;
+    using BaseTestCache_ty = boost::unordered_map<TestCaseIssueIndex, BaseTestCacheEntry>;
+    using UniqueTestIdentifier = TestCaseFingerprint;
 
 private:
     fs::path root_;
 
     uint64_t tc_count_;
 
+    TestSchedStrat strat_;
     TestQueue next_;
+    CoverageQueue coverage_next_;
     boost::unordered_set<UniqueTestIdentifier> issued_tc_hash_pool_;
     BaseTestCache_ty base_tc_cache_;
+    BaseTestLRU_ty base_tc_lru_;
+    uint64_t base_tc_cache_bytes_;
 
     // debug
     uint64_t m_duplicated_tc_count;
 
+    Checkpoint* checkpoint_;
+
 public:
-    TestPool(const fs::path& root);
+    TestPool(const fs::path& root,
+             TestSchedStrat strat = BFS);
 
     auto next() -> boost::optional<TestCase>;
 
@@ -71,16 +139,27 @@ public:
     auto insert_initial_tcs(const std::vector<TestCase>& tcs) -> void;
 
     auto insert(const std::vector<TestCase>& tcs) -> void;
+    auto credit_coverage(TestCaseIssueIndex tc_issue_index,
+                         uint64_t new_tb_count) -> void;
 
     auto count_all() const -> size_t;
     auto count_next() const -> size_t;
 
     auto write_log(std::ostream& os) -> void;
 
+    auto journal_to(Checkpoint* checkpoint) -> void;
+    auto snapshot() const -> TestPoolSnapshot;
+    auto restore(const TestPoolSnapshot& snapshot,
+                 const std::vector<CheckpointRecord>& records) -> void;
+
 private:
     auto insert_internal(const TestCase& tc) -> bool;
+    auto enqueue(const TestCase& tc) -> void;
+    auto journal(const CheckpointRecord& record) -> void;
+    auto count_tc() -> void;
 
     auto insert_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator;
+    auto evict_base_tc(uint64_t incoming_bytes) -> void;
     auto get_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator;
     auto get_complete_tc(const TestCase& patch_tc) -> boost::optional<TestCase> const;
     auto write_test_case(const TestCase& tc, const fs::path out_path) -> void;
@@ -3,6 +3,7 @@
 
 #include <set>
 #include <deque>
+#include <map>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -12,35 +13,68 @@
 #include <crete/addr_range.h>
 #include <crete/proc_reader.h>
 #include <crete/cluster/dispatch_options.h>
+#include <crete/cluster/checkpoint.h>
 
 namespace crete
 {
 namespace cluster
 {
+    /**
+     * @brief Traces waiting for an SVM node. Each node has a local queue, filled so that the
+     *        estimated cost of its work stays even with the others; a node whose queue runs dry
+     *        takes unplaced traces, then steals from the most loaded node.
+     */
     class TracePool
     {
     public:
-        using TracePath = boost::filesystem::path;
-        using TraceQueue = std::deque<TracePath>;
+        using TracePath = boost::filesystem::path; // Manifest of the trace; contents live in the ChunkStore.
+        using NodeID = uint64_t;
+
+        struct QueuedTrace
+        {
+            TracePath trace;
+            uint64_t cost;
+        };
+
+        using TraceQueue = std::deque<QueuedTrace>;
+
+        struct NodeQueue
+        {
+            TraceQueue local;
+            std::deque<uint64_t> handed; // Costs of traces handed to the node and not yet done, newest first.
+        };
 
     public:
         TracePool(const option::Dispatch& options);
 
-        auto insert(const TracePath& tace) -> bool;
-        auto next() -> boost::optional<TracePath>;
+        auto insert(const TracePath& tace,
+                    uint64_t cost) -> bool;
+        auto next(NodeID node,
+                  uint32_t queued_on_node,
+                  bool replaying) -> boost::optional<TracePath>;
+        auto remove_node(NodeID node) -> void;
         auto count_all_unique() const -> size_t;
         auto count_next() const -> size_t;
 
+        auto journal_to(Checkpoint* checkpoint) -> void;
+        auto snapshot() const -> TracePoolSnapshot;
+        auto restore(const TracePoolSnapshot& snapshot,
+                     const std::vector<CheckpointRecord>& records) -> void;
+
         // TODO: xxx unused?
         auto set(const std::map<AddressRange, Entry>& entries) -> void;
 
     protected:
         void print_elf_info(const boost::filesystem::path& trace_path);
+        auto load(const NodeQueue& nq) const -> uint64_t;
+        auto steal(NodeID thief) -> boost::optional<QueuedTrace>;
 
     private:
         uint64_t trace_count_;
-        TraceQueue next_;
+        TraceQueue next_; // Not yet placed with a node.
+        std::map<NodeID, NodeQueue> node_queues_;
         option::Dispatch options_;
+        Checkpoint* checkpoint_;
 
         // TODO: xxx cleanup
         std::map<AddressRange, Entry> elf_entries_;
@@ -27,6 +27,8 @@ struct Translator
         std::string x86;
         std::string x64;
     } path;
+    bool cache{true}; // Share translated TBs between traces of the same VM.
+    uint32_t jobs{0}; // Processes translating a trace. 0: the cores are shared among the VMs.
 };
 
 struct VM
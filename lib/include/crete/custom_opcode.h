@@ -22,6 +22,9 @@
 #define CRETE_INSTR_DUMP_VALUE 0x050000
 #define CRETE_INSTR_DUMP() CRETE_INSTR_GENERATE(00, 05)
 
+#define CRETE_INSTR_SNAPSHOT_VALUE 0x100000
+#define CRETE_INSTR_SNAPSHOT() CRETE_INSTR_GENERATE(00, 10)
+
 // For program under test
 #define CRETE_INSTR_MAKE_CONCOLIC_INTERNAL_VALUE 0x060000
 #define CRETE_INSTR_MAKE_CONCOLIC_INTERNAL() CRETE_INSTR_GENERATE(00, 06)
@@ -26,8 +26,9 @@ namespace crete
 struct GuestDataPostExec
 {
     vector<uint64_t> m_new_captured_tbs;
+    uint64_t m_tc_issue_index; // Of the test whose execution this was; set by vm-node
 
-    GuestDataPostExec() {};
+    GuestDataPostExec() : m_tc_issue_index(0) {};
     ~GuestDataPostExec() {};
 
     template <typename Archive>
@@ -36,6 +37,7 @@ struct GuestDataPostExec
         (void)version;
 
         ar & m_new_captured_tbs;
+        ar & m_tc_issue_index;
     }
 
     void add_new_tb_pc(const uint64_t pc)
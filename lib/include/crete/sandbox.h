@@ -0,0 +1,215 @@
+#ifndef CRETE_SANDBOX_H
+#define CRETE_SANDBOX_H
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int) // <linux/fs.h>, which clashes with <sys/mount.h>.
+#endif
+
+namespace crete
+{
+namespace sandbox
+{
+
+namespace fs = boost::filesystem;
+
+inline void reset_permission_recursively(const fs::path& root)
+{
+    if(!fs::exists(root) || fs::is_symlink(root))
+    {
+        return;
+    }
+
+    fs::permissions(root, fs::owner_all);
+
+    if(!fs::is_directory(root))
+    {
+        return;
+    }
+
+    for(fs::recursive_directory_iterator it(root), endit;
+            it != endit; ++it) {
+        if(!fs::is_symlink(*it)){
+            fs::permissions(*it, fs::owner_all);
+        }
+    }
+}
+
+// Shares the data blocks of 'src' with 'dst' where the file system can (btrfs, xfs, ...).
+inline void reflink_or_copy_file(const fs::path& src, const fs::path& dst)
+{
+    int in = open(src.string().c_str(), O_RDONLY);
+    if(in >= 0)
+    {
+        int out = open(dst.string().c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if(out >= 0)
+        {
+            bool cloned = ioctl(out, FICLONE, in) == 0;
+
+            close(out);
+            close(in);
+
+            if(cloned)
+            {
+                fs::permissions(dst, fs::status(src).permissions());
+                return;
+            }
+
+            fs::remove(dst);
+        }
+        else
+        {
+            close(in);
+        }
+    }
+
+    fs::copy_file(src, dst);
+}
+
+// In-process equivalent of "cp -r src dst".
+inline void copy_recursively(const fs::path& src, const fs::path& dst)
+{
+    fs::create_directory(dst);
+    fs::permissions(dst, fs::status(src).permissions());
+
+    for(fs::recursive_directory_iterator it(src), endit;
+            it != endit; ++it) {
+        const fs::path& from = it->path();
+        const fs::path to = dst / from.string().substr(src.string().size());
+
+        if(fs::is_symlink(from))
+        {
+            fs::copy_symlink(from, to);
+        }
+        else if(fs::is_directory(from))
+        {
+            fs::create_directory(to);
+            fs::permissions(to, fs::status(from).permissions());
+        }
+        else if(fs::is_regular_file(from))
+        {
+            reflink_or_copy_file(from, to);
+        }
+    }
+}
+
+/**
+ * Keeps 'target' a pristine copy of the read-only directory 'lower', reset between tests.
+ *
+ * 'target' is preferably an overlayfs over 'lower' whose upper dir is kept on a tmpfs
+ * at 'scratch'. A reset then unmounts it, drops what the upper dir holds and remounts,
+ * so it costs what the last test wrote. Without overlayfs (or CAP_SYS_ADMIN), a reset
+ * copies 'lower' in-process, sharing file data by reflink where the file system allows.
+ */
+class PristineDir
+{
+public:
+    PristineDir(const fs::path& lower,
+                const fs::path& target,
+                const fs::path& scratch) :
+        m_lower(fs::canonical(lower)),
+        m_target(target),
+        m_scratch(scratch),
+        m_overlay(true),
+        m_mounted(false)
+    {
+        release_stale();
+    }
+
+    ~PristineDir()
+    {
+        if(m_mounted)
+        {
+            umount2(m_target.string().c_str(), MNT_DETACH);
+        }
+
+        umount2(m_scratch.string().c_str(), MNT_DETACH);
+    }
+
+    void reset()
+    {
+        if(m_overlay)
+        {
+            if(m_mounted)
+            {
+                umount2(m_target.string().c_str(), MNT_DETACH);
+                m_mounted = false;
+            }
+
+            fs::path upper = m_scratch / "upper";
+            reset_permission_recursively(upper);
+            fs::remove_all(upper);
+            fs::create_directory(upper);
+
+            fs::create_directories(m_target);
+            std::string opts = "lowerdir=" + m_lower.string() +
+                               ",upperdir=" + upper.string() +
+                               ",workdir=" + (m_scratch / "work").string();
+
+            if(mount("overlay", m_target.string().c_str(), "overlay", 0, opts.c_str()) == 0)
+            {
+                m_mounted = true;
+                return;
+            }
+
+            fprintf(stderr, "[crete-sandbox] overlay mount failed (%s): "
+                    "falling back to copying %s\n",
+                    strerror(errno), m_lower.string().c_str());
+
+            m_overlay = false;
+        }
+
+        reset_permission_recursively(m_target);
+        fs::remove_all(m_target);
+        copy_recursively(m_lower, m_target);
+    }
+
+private:
+    PristineDir(const PristineDir&);
+    PristineDir& operator=(const PristineDir&);
+
+    // Left behind by a run that didn't exit cleanly.
+    void release_stale()
+    {
+        umount2(m_target.string().c_str(), MNT_DETACH);
+        umount2(m_scratch.string().c_str(), MNT_DETACH);
+
+        reset_permission_recursively(m_target);
+        fs::remove_all(m_target);
+        reset_permission_recursively(m_scratch);
+        fs::remove_all(m_scratch);
+
+        fs::create_directories(m_scratch);
+
+        // Upper dirs can't be on an overlayfs, which /tmp may well be.
+        if(mount("tmpfs", m_scratch.string().c_str(), "tmpfs", 0, NULL) != 0)
+        {
+            fprintf(stderr, "[crete-sandbox] tmpfs mount failed on %s (%s)\n",
+                    m_scratch.string().c_str(), strerror(errno));
+        }
+
+        fs::create_directory(m_scratch / "work");
+    }
+
+    fs::path m_lower;
+    fs::path m_target;
+    fs::path m_scratch;
+    bool m_overlay;
+    bool m_mounted;
+};
+
+} // namespace sandbox
+} // namespace crete
+
+#endif // CRETE_SANDBOX_H
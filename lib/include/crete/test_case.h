@@ -42,8 +42,10 @@ namespace crete
 
         friend std::size_t hash_value(TestCaseElement const& i)
         {
-            return boost::hash_value(string(i.name.begin(), i.name.end())  +
-                                     string(i.data.begin(), i.data.end()));
+            std::size_t seed = boost::hash_range(i.name.begin(), i.name.end());
+            boost::hash_range(seed, i.data.begin(), i.data.end());
+
+            return seed;
         }
 
         void print() const;
@@ -51,6 +53,34 @@ namespace crete
 
     typedef std::vector<TestCaseElement> TestCaseElements;
     typedef uint64_t TestCaseIssueIndex;
+
+    // 128-bit FNV-1a digest of test case elements, kept in place of the elements to spot duplicates
+    struct TestCaseFingerprint
+    {
+        uint64_t hi;
+        uint64_t lo;
+
+        bool operator==(TestCaseFingerprint const& other) const
+        {
+            return hi == other.hi && lo == other.lo;
+        }
+
+        friend std::size_t hash_value(TestCaseFingerprint const& i)
+        {
+            return static_cast<std::size_t>(i.lo);
+        }
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int version)
+        {
+            (void)version;
+
+            ar & hi;
+            ar & lo;
+        }
+    };
+
+    TestCaseFingerprint fingerprint(const TestCaseElements& elems);
     // <index of trace-tag node to negate, index of branch within a tt node to negate>
     typedef std::pair<uint32_t, uint32_t> TestCasePatchTraceTag_ty;
     // <index within an tc element, value>
@@ -173,6 +203,7 @@ namespace crete
     TestCase read_serialized(istream& is);
 
     TestCase retrieve_test_serialized(const std::string& tc_path);
+    TestCaseFingerprint content_fingerprint(const TestCase& tc);
     vector<TestCase> retrieve_tests_serialized(const string& tc_dir);
 }
 
@@ -0,0 +1,336 @@
+#ifndef CRETE_TEST_CHANNEL_H
+#define CRETE_TEST_CHANNEL_H
+
+#include <crete/test_case.h>
+#include <crete/exception.h>
+
+#include <string>
+#include <sstream>
+#include <cstring>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace crete
+{
+
+const char* const test_channel_name_file = "test_channel"; // Within hostfile/: names the shared memory object.
+const char* const test_channel_test_spill_file = "input_arguments.bin"; // Within hostfile/, suffixed by slot: a test too large for its slot.
+const char* const test_channel_trace_spill_file = "concrete_inputs.bin"; // Likewise, for the traces ring.
+const uint32_t test_channel_magic = 0x43525443;
+const uint32_t test_channel_slot_count = 8;
+const uint32_t test_channel_slot_size = 1024 * 1024; // Bytes. Pages are only backed once touched.
+
+struct TestChannelSlot
+{
+    uint32_t size;
+    uint32_t spilled; // Too large for the slot: it's in the slot's spill file instead.
+    char data[test_channel_slot_size];
+};
+
+/**
+ * Single-producer, single-consumer ring of serialized test cases.
+ */
+struct TestChannelRing
+{
+    uint32_t head; // Written by the producer only.
+    uint32_t tail; // Written by the consumer only.
+    TestChannelSlot slots[test_channel_slot_count];
+};
+
+struct TestChannelLayout
+{
+    uint32_t magic;
+    uint32_t closed; // Set by the vm-node once it stops serving the channel.
+    uint32_t snapshot; // Set by qemu once it restores the guest to wait on 'tests' after each trace.
+    TestChannelRing tests; // vm-node -> qemu: test cases, in the order they are to run.
+    TestChannelRing traces; // qemu -> vm-node: one per trace written, with its (completed) test case.
+};
+
+inline uint32_t ring_size(const TestChannelRing& ring)
+{
+    return __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+}
+
+inline bool ring_empty(const TestChannelRing& ring)
+{
+    return ring_size(ring) == 0;
+}
+
+inline bool ring_full(const TestChannelRing& ring)
+{
+    return ring_size(ring) == test_channel_slot_count;
+}
+
+inline boost::filesystem::path spill_path(const boost::filesystem::path& spill,
+                                          uint32_t index)
+{
+    return spill.string() + "." + boost::lexical_cast<std::string>(index % test_channel_slot_count);
+}
+
+inline void ring_push(TestChannelRing& ring,
+                      const TestCase& tc,
+                      const boost::filesystem::path& spill)
+{
+    if(ring_full(ring))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::msg("test channel ring is full"));
+    }
+
+    TestChannelSlot& slot = ring.slots[ring.head % test_channel_slot_count];
+
+    std::ostringstream os;
+    write_serialized(os, tc);
+    const std::string& s = os.str();
+
+    if(s.size() <= test_channel_slot_size)
+    {
+        std::memcpy(slot.data, s.data(), s.size());
+        slot.size = static_cast<uint32_t>(s.size());
+        slot.spilled = 0;
+    }
+    else
+    {
+        const boost::filesystem::path path = spill_path(spill, ring.head);
+        boost::filesystem::ofstream ofs(path, std::ios_base::out | std::ios_base::binary);
+
+        if(!ofs.good())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::file_open_failed(path.string()));
+        }
+
+        ofs.write(s.data(), s.size());
+
+        slot.size = 0;
+        slot.spilled = 1;
+    }
+
+    __atomic_store_n(&ring.head, ring.head + 1, __ATOMIC_RELEASE);
+}
+
+inline TestCase ring_front(const TestChannelRing& ring,
+                           const boost::filesystem::path& spill)
+{
+    if(ring_empty(ring))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::msg("test channel ring is empty"));
+    }
+
+    const TestChannelSlot& slot = ring.slots[ring.tail % test_channel_slot_count];
+
+    if(slot.spilled)
+    {
+        const boost::filesystem::path path = spill_path(spill, ring.tail);
+        boost::filesystem::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+
+        if(!ifs.good())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::file_open_failed(path.string()));
+        }
+
+        return read_serialized(ifs);
+    }
+
+    std::istringstream is(std::string(slot.data, slot.size));
+
+    return read_serialized(is);
+}
+
+inline void ring_pop(TestChannelRing& ring)
+{
+    __atomic_store_n(&ring.tail, ring.tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Shared memory through which the vm-node hands test cases to qemu, and qemu reports
+ * the traces it has written, in place of files polled under hostfile/.
+ *
+ * The vm-node creates the channel and names it in hostfile/test_channel, which qemu
+ * (running in the vm-node's directory) attaches to on first use.
+ */
+class TestChannel
+{
+public:
+    TestChannel() :
+        m_layout(NULL),
+        m_owner(false)
+    {}
+
+    ~TestChannel()
+    {
+        detach();
+    }
+
+    // vm-node side.
+    void create(const boost::filesystem::path& hostfile_dir)
+    {
+        detach();
+
+        static uint32_t count = 0;
+        m_name = "/crete-test-channel-" +
+                 boost::lexical_cast<std::string>(getpid()) + "-" +
+                 boost::lexical_cast<std::string>(count++);
+        m_hostfile_dir = hostfile_dir;
+
+        int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+        if(fd < 0 || ftruncate(fd, sizeof(TestChannelLayout)) != 0)
+        {
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+
+            BOOST_THROW_EXCEPTION(Exception() << err::file_create(m_name) << err::c_errno(errno));
+        }
+
+        map(fd);
+
+        m_owner = true;
+        m_layout->magic = test_channel_magic;
+
+        boost::filesystem::path name_file = hostfile_dir / test_channel_name_file;
+        boost::filesystem::ofstream ofs(name_file);
+
+        if(!ofs.good())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::file_open_failed(name_file.string()));
+        }
+
+        ofs << m_name;
+    }
+
+    // qemu side. Returns false if no vm-node has created a channel.
+    bool attach(const boost::filesystem::path& hostfile_dir)
+    {
+        detach();
+
+        boost::filesystem::path name_file = hostfile_dir / test_channel_name_file;
+
+        if(!boost::filesystem::exists(name_file))
+        {
+            return false;
+        }
+
+        boost::filesystem::ifstream ifs(name_file);
+        std::string name;
+
+        if(!(ifs >> name))
+        {
+            return false;
+        }
+
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+
+        if(fd < 0)
+        {
+            return false;
+        }
+
+        map(fd);
+
+        if(m_layout->magic != test_channel_magic)
+        {
+            detach();
+
+            return false;
+        }
+
+        m_name = name;
+        m_hostfile_dir = hostfile_dir;
+
+        return true;
+    }
+
+    bool is_attached() const
+    {
+        return m_layout != NULL && !__atomic_load_n(&m_layout->closed, __ATOMIC_ACQUIRE);
+    }
+
+    // Once set, the guest takes its tests off the channel alone: no next_test packet is needed.
+    void set_snapshot()
+    {
+        __atomic_store_n(&m_layout->snapshot, 1, __ATOMIC_RELEASE);
+    }
+
+    bool is_snapshot() const
+    {
+        return __atomic_load_n(&m_layout->snapshot, __ATOMIC_ACQUIRE);
+    }
+
+    TestChannelRing& tests()
+    {
+        return m_layout->tests;
+    }
+
+    TestChannelRing& traces()
+    {
+        return m_layout->traces;
+    }
+
+    boost::filesystem::path test_spill() const
+    {
+        return m_hostfile_dir / test_channel_test_spill_file;
+    }
+
+    boost::filesystem::path trace_spill() const
+    {
+        return m_hostfile_dir / test_channel_trace_spill_file;
+    }
+
+private:
+    TestChannel(const TestChannel&);
+    TestChannel& operator=(const TestChannel&);
+
+    void map(int fd)
+    {
+        void* p = mmap(NULL, sizeof(TestChannelLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        close(fd);
+
+        if(p == MAP_FAILED)
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::msg("mmap() of test channel failed") << err::c_errno(errno));
+        }
+
+        m_layout = static_cast<TestChannelLayout*>(p);
+    }
+
+    void detach()
+    {
+        if(m_layout == NULL)
+        {
+            return;
+        }
+
+        if(m_owner)
+        {
+            __atomic_store_n(&m_layout->closed, 1, __ATOMIC_RELEASE);
+            shm_unlink(m_name.c_str());
+        }
+
+        munmap(m_layout, sizeof(TestChannelLayout));
+
+        m_layout = NULL;
+        m_owner = false;
+    }
+
+    TestChannelLayout* m_layout;
+    bool m_owner;
+    std::string m_name;
+    boost::filesystem::path m_hostfile_dir;
+};
+
+} // namespace crete
+
+#endif // CRETE_TEST_CHANNEL_H
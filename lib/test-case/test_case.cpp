@@ -11,6 +11,7 @@
 
 #include <cassert>
 #include <iomanip>
+#include <sstream>
 
 using namespace std;
 
@@ -43,6 +44,64 @@ namespace crete
         return os;
     }
 
+    typedef unsigned __int128 fnv128_ty;
+
+    // FNV 128-bit offset basis
+    static const fnv128_ty fnv128_offset = (fnv128_ty(0x6c62272e07bb0142ULL) << 64) | 0x62b821756295c58dULL;
+
+    static fnv128_ty fnv1a_128(fnv128_ty h, const uint8_t* p, size_t n)
+    {
+        // FNV 128-bit prime: 2^88 + 2^8 + 0x3b
+        const fnv128_ty prime = (fnv128_ty(1) << 88) | 0x13b;
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            h ^= p[i];
+            h *= prime;
+        }
+
+        return h;
+    }
+
+    // Each field is length-prefixed, so different splits of the same bytes don't collide.
+    TestCaseFingerprint fingerprint(const TestCaseElements& elems)
+    {
+        fnv128_ty h = fnv128_offset;
+
+        for(TestCaseElements::const_iterator it = elems.begin(); it != elems.end(); ++it)
+        {
+            uint32_t name_size = it->name.size();
+            uint32_t data_size = it->data.size();
+
+            h = fnv1a_128(h, reinterpret_cast<const uint8_t*>(&name_size), sizeof(name_size));
+            h = fnv1a_128(h, it->name.data(), it->name.size());
+            h = fnv1a_128(h, reinterpret_cast<const uint8_t*>(&data_size), sizeof(data_size));
+            h = fnv1a_128(h, it->data.data(), it->data.size());
+        }
+
+        TestCaseFingerprint fp;
+        fp.hi = static_cast<uint64_t>(h >> 64);
+        fp.lo = static_cast<uint64_t>(h);
+
+        return fp;
+    }
+
+    // Fingerprint of the whole test as serialized, patch and trace tags included
+    TestCaseFingerprint content_fingerprint(const TestCase& tc)
+    {
+        ostringstream os;
+        write_serialized(os, tc);
+
+        const string& s = os.str();
+        fnv128_ty h = fnv1a_128(fnv128_offset, reinterpret_cast<const uint8_t*>(s.data()), s.size());
+
+        TestCaseFingerprint fp;
+        fp.hi = static_cast<uint64_t>(h >> 64);
+        fp.lo = static_cast<uint64_t>(h);
+
+        return fp;
+    }
+
     void write(ostream& os, const TestCaseElement& elem)
     {
         os.write(reinterpret_cast<const char*>(&elem.name_size), sizeof(uint32_t));
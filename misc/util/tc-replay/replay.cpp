@@ -232,20 +232,10 @@ static inline void rdonly_bind_mount(const fs::path src, const fs::path dst)
     }
 }
 
-static void reset_folder_permission_recursively(const fs::path& root)
-{
-    for(fs::recursive_directory_iterator it(root), endit;
-            it != endit; ++it) {
-        if(!fs::is_symlink(*it)){
-            fs::permissions(*it, fs::owner_all);
-        }
-    }
-}
-
 // make sure the folder has the right permission within sandbox:
 // 1. "/": the root of sandbox
 // 2. "/tmp"
-// 3. "/tmp/launch-directory"
+// ("/tmp/launch-directory" is seen to by m_sandbox_exec)
 void CreteReplay::reset_sandbox_folder_permission()
 {
     {
@@ -263,15 +253,6 @@ void CreteReplay::reset_sandbox_folder_permission()
             fs::permissions(p, fs::perms_mask);
         }
     }
-
-    {
-        fs::path p = fs::path(CRETE_SANDBOX_PATH) / m_launch_directory;
-        if(fs::exists(p))
-        {
-            fs::permissions(p, fs::perms_mask);
-            reset_folder_permission_recursively(p);
-        }
-    }
 }
 
 // Mount folders to sandbox dir:
@@ -279,6 +260,9 @@ void CreteReplay::reset_sandbox_folder_permission()
 // require: "sudo setcap CAP_SYS_ADMIN+ep ./crete-run"
 void CreteReplay::init_sandbox()
 {
+    // Also unmounts and removes the launch directory left by a previous run.
+    init_sandbox_exec();
+
     reset_sandbox_folder_permission();
 
     // delete the sandbox folder if it existed
@@ -363,27 +347,20 @@ void CreteReplay::reset_sandbox()
     reset_sandbox_folder_permission();
 
     // 2. reset "sandbox-exec folder" within sandbox
-    fs::path crete_sandbox_exec_path = fs::path(CRETE_SANDBOX_PATH) / m_launch_directory;
-    fs::remove_all(crete_sandbox_exec_path);
-    assert(fs::exists(fs::path(crete_sandbox_exec_path).parent_path()));
-
-    bp::context ctx;
-    ctx.stdout_behavior = bp::capture_stream();
-    ctx.environment = bp::self::get_environment();
-
-    std::string exec = bp::find_executable_in_path("cp");
-    std::vector<std::string> args;
-    args.push_back(exec);
-    args.push_back("-r");
-    args.push_back(m_input_sandbox.string());
-    args.push_back(crete_sandbox_exec_path.string());
-
-    bp::child c = bp::launch(exec, args, ctx);
+    if(!m_sandbox_exec)
+    {
+        init_sandbox_exec();
+    }
+    assert(fs::exists(fs::path(CRETE_SANDBOX_PATH) / m_launch_directory.parent_path()));
 
-    bp::pistream &is = c.get_stdout();
+    m_sandbox_exec->reset();
+}
 
-    // TODO: xxx should check the return status to make sure the "cp" completed successfully
-    bp::status s = c.wait();
+void CreteReplay::init_sandbox_exec()
+{
+    m_sandbox_exec.reset(new sandbox::PristineDir(m_input_sandbox,
+                                                  fs::path(CRETE_SANDBOX_PATH) / m_launch_directory,
+                                                  CRETE_SANDBOX_OVERLAY_PATH));
 }
 
 void CreteReplay::reset_launch_dir()
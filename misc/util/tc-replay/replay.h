@@ -4,8 +4,10 @@
 #include <crete/executor.h>
 #include <crete/test_case.h>
 #include <crete/harness_config.h>
+#include <crete/sandbox.h>
 
 #include <boost/process.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/options_description.hpp>
 
@@ -39,6 +41,7 @@ private:
     vector<string> m_secondary_cmds;
 
     fs::path m_input_sandbox;
+    boost::shared_ptr<sandbox::PristineDir> m_sandbox_exec;
     fs::path m_input_launch;
 
     fs::path m_environment;
@@ -59,6 +62,7 @@ private:
     void setup_launch();
 
     void init_sandbox();
+    void init_sandbox_exec();
     void reset_sandbox();
     void reset_sandbox_folder_permission();
 